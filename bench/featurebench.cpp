@@ -0,0 +1,176 @@
+/**
+ *
+ * @file featurebench.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Microbenchmark of the EMG feature extractor
+ *
+ * Compares the incremental extractor of src/features.hpp with a scalar
+ * reference that recomputes the features over the whole window at every hop
+ * (as a patch does with vexpr and zl objects), on random EMG signals. The
+ * features of both implementations are checked to be equal.
+ *
+ * Build:
+ *   c++ -std=c++11 -O2 -Isrc bench/featurebench.cpp -o featurebench
+ *
+ * Usage: featurebench [--samples n] [--windows 20,40,100,200] [--hop h]
+ * Results are printed as JSON on the standard output: for each window size,
+ * the time per sample (ns) of both implementations.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "features.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+const int kChannels = EmgFeatures::kChannels;
+
+/// Scalar reference: features of the last window samples of the signal
+void referenceFeatures(int8_t const *signal, int end, int window,
+                       float *features) {
+    int begin = end - window;
+    for (int c = 0; c < kChannels; c++) {
+        double sq = 0., abs = 0., wl = 0., zc = 0., ssc = 0.;
+        for (int i = begin; i < end; i++) {
+            int x = signal[i * kChannels + c];
+            sq += x * x;
+            abs += std::abs(x);
+            if (i > begin) {
+                int x1 = signal[(i - 1) * kChannels + c];
+                wl += std::abs(x - x1);
+                if (x * x1 < 0) zc += 1.;
+            }
+            if (i > begin + 1) {
+                int x1 = signal[(i - 1) * kChannels + c];
+                int x2 = signal[(i - 2) * kChannels + c];
+                if ((x1 - x2) * (x1 - x) > 0) ssc += 1.;
+            }
+        }
+        features[EmgFeatures::Rms * kChannels + c] =
+            static_cast<float>(std::sqrt(sq / window) / 127.);
+        features[EmgFeatures::Mav * kChannels + c] =
+            static_cast<float>(abs / window / 127.);
+        features[EmgFeatures::WaveformLength * kChannels + c] =
+            static_cast<float>(wl / 127.);
+        features[EmgFeatures::ZeroCrossings * kChannels + c] =
+            static_cast<float>(zc);
+        features[EmgFeatures::SlopeSignChanges * kChannels + c] =
+            static_cast<float>(ssc);
+    }
+}
+
+double elapsedNs(Clock::time_point start) {
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count());
+}
+
+std::string argument(int argc, char **argv, const char *name,
+                     const char *fallback) {
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    return fallback;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int samples = std::atoi(argument(argc, argv, "--samples", "1000000").c_str());
+    int hop = std::atoi(argument(argc, argv, "--hop", "10").c_str());
+    std::string windows = argument(argc, argv, "--windows", "20,40,100,200");
+    if (samples < 1000) samples = 1000;
+    if (hop < 1) hop = 1;
+
+    // random signal with some low-frequency content, as raw EMG
+    std::vector<int8_t> signal(static_cast<std::size_t>(samples) * kChannels);
+    std::srand(1);
+    for (int i = 0; i < samples; i++) {
+        for (int c = 0; c < kChannels; c++) {
+            int noise = std::rand() % 64 - 32;
+            int drift = static_cast<int>(40. * std::sin(0.01 * i + c));
+            signal[i * kChannels + c] = static_cast<int8_t>(noise + drift);
+        }
+    }
+
+    std::printf("{\n  \"samples\": %d,\n  \"hop\": %d,\n  \"results\": [", samples,
+                hop);
+    std::stringstream list(windows);
+    std::string item;
+    bool first = true;
+    int errors = 0;
+    while (std::getline(list, item, ',')) {
+        int window = std::atoi(item.c_str());
+        if (window < 3) continue;
+        float features[EmgFeatures::kSize];
+        float reference[EmgFeatures::kSize];
+        volatile float sink = 0.f;
+
+        // incremental extractor
+        EmgFeatures extractor(window, hop);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            if (extractor.push(&signal[i * kChannels])) {
+                extractor.compute(features);
+                sink = sink + features[0];
+            }
+        }
+        double incremental_ns = elapsedNs(start) / samples;
+
+        // scalar reference, with the same hops
+        int countdown = hop;
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            if (--countdown > 0) continue;
+            countdown = hop;
+            if (i + 1 < window) continue;
+            referenceFeatures(&signal[0], i + 1, window, reference);
+            sink = sink + reference[0];
+        }
+        double reference_ns = elapsedNs(start) / samples;
+
+        // check the features of both implementations at every hop
+        extractor.reset();
+        countdown = hop;
+        for (int i = 0; i < samples; i++) {
+            bool ready = extractor.push(&signal[i * kChannels]);
+            if (--countdown > 0) continue;
+            countdown = hop;
+            if (i + 1 < window) continue;
+            if (!ready) {
+                errors++;
+                continue;
+            }
+            extractor.compute(features);
+            referenceFeatures(&signal[0], i + 1, window, reference);
+            for (int j = 0; j < EmgFeatures::kSize; j++) {
+                if (std::fabs(features[j] - reference[j]) >
+                    1e-4f * (1.f + std::fabs(reference[j])))
+                    errors++;
+            }
+        }
+
+        std::printf("%s\n    {\"window\": %d, \"incremental_ns_per_sample\": "
+                    "%.1f, \"reference_ns_per_sample\": %.1f, \"speedup\": "
+                    "%.1f}",
+                    first ? "" : ",", window, incremental_ns, reference_ns,
+                    reference_ns / incremental_ns);
+        first = false;
+    }
+    std::printf("\n  ],\n  \"errors\": %d\n}\n", errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+/**
+ *
+ * @file ext.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Minimal stand-in for the Max API used by the external (benchmarks)
+ *
+ * Only the subset of the Max SDK used by src/myo.cpp is provided, so that the
+ * external can be compiled and driven outside of Max. Outlets call a hook set
+ * with maxstub_set_outlet_hook(), and clocks are executed by a single
+ * scheduler thread (see maxstub.h).
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_MAXSTUB_EXT_H
+#define MAXMYO_MAXSTUB_EXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define C74_EXPORT
+
+typedef long t_max_err;
+typedef long t_atom_long;
+typedef double t_atom_float;
+
+enum { MAX_ERR_NONE = 0, MAX_ERR_GENERIC = -1, MAX_ERR_OUT_OF_MEM = -3 };
+
+enum e_max_atomtypes {
+    A_NOTHING = 0,
+    A_LONG,
+    A_FLOAT,
+    A_SYM,
+    A_OBJ,
+    A_DEFLONG,
+    A_DEFFLOAT,
+    A_DEFSYM,
+    A_GIMME,
+    A_CANT
+};
+
+enum { ASSIST_INLET = 1, ASSIST_OUTLET = 2 };
+
+enum {
+    MAX_PATH_CHARS = 2048,
+    PATH_STYLE_MAX = 0,
+    PATH_STYLE_NATIVE = 4,
+    PATH_TYPE_ABSOLUTE = 1,
+    PATH_TYPE_BOOT = 3
+};
+
+typedef struct _symbol {
+    const char *s_name;
+    void *s_thing;
+} t_symbol;
+
+typedef struct _object {
+    void *o_magic;
+} t_object;
+
+union word {
+    t_atom_long w_long;
+    t_atom_float w_float;
+    t_symbol *w_sym;
+    t_object *w_obj;
+};
+
+typedef struct atom {
+    short a_type;
+    union word a_w;
+} t_atom;
+
+typedef void *(*method)(void *, ...);
+typedef struct _class t_class;
+typedef void t_clock;
+
+#define CLASS_BOX gensym("box")
+
+t_symbol *gensym(const char *name);
+
+t_class *class_new(const char *name, method mnew, method mfree, long size,
+                   method mmenu, short type, ...);
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...);
+t_max_err class_register(t_symbol *name_space, t_class *c);
+t_max_err class_alias(t_class *c, t_symbol *aliasname);
+void *object_alloc(t_class *c);
+void object_free(void *x);
+void *object_method(void *x, t_symbol *s, ...);
+
+void *outlet_new(void *x, const char *type);
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b);
+t_max_err atom_setfloat(t_atom *a, double b);
+t_max_err atom_setsym(t_atom *a, t_symbol *b);
+t_atom_long atom_getlong(const t_atom *a);
+t_atom_float atom_getfloat(const t_atom *a);
+t_symbol *atom_getsym(const t_atom *a);
+
+long attr_args_offset(short ac, t_atom *av);
+void attr_args_process(void *x, short ac, t_atom *av);
+
+void post(const char *fmt, ...);
+void object_post(t_object *x, const char *fmt, ...);
+void object_warn(t_object *x, const char *fmt, ...);
+void object_error(t_object *x, const char *fmt, ...);
+
+char *getbytes(long size);
+void freebytes(void *b, long size);
+
+t_clock *clock_new(void *x, method fn);
+void clock_delay(t_clock *c, long ms);
+void clock_unset(t_clock *c);
+
+short path_nameconform(const char *src, char *dst, long style, long type);
+
+#endif
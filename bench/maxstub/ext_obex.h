@@ -0,0 +1,50 @@
+/**
+ *
+ * @file ext_obex.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Minimal stand-in for the Max attribute API (benchmarks)
+ *
+ * Attributes are registered with their storage and setter, so that
+ * attr_args_process() applies the @attributes of the object box. Other
+ * properties (filters, labels, styles) are ignored.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_MAXSTUB_EXT_OBEX_H
+#define MAXMYO_MAXSTUB_EXT_OBEX_H
+
+#include "ext.h"
+
+#define calcoffset(x, y) ((long)(&(((x *)0L)->y)))
+
+void maxstub_class_attr(t_class *c, const char *name, char type, long offset);
+void maxstub_class_attr_accessors(t_class *c, const char *name, method get,
+                                  method set);
+
+#define CLASS_ATTR_LONG(c, name, flags, structname, member) \
+    maxstub_class_attr((c), (name), 'l', calcoffset(structname, member))
+#define CLASS_ATTR_DOUBLE(c, name, flags, structname, member) \
+    maxstub_class_attr((c), (name), 'd', calcoffset(structname, member))
+#define CLASS_ATTR_SYM(c, name, flags, structname, member) \
+    maxstub_class_attr((c), (name), 's', calcoffset(structname, member))
+#define CLASS_ATTR_ATOM(c, name, flags, structname, member) \
+    maxstub_class_attr((c), (name), 'a', calcoffset(structname, member))
+#define CLASS_ATTR_ACCESSORS(c, name, get, set) \
+    maxstub_class_attr_accessors((c), (name), (get), (set))
+
+#define CLASS_ATTR_FILTER_MIN(c, name, value) ((void)0)
+#define CLASS_ATTR_FILTER_MAX(c, name, value) ((void)0)
+#define CLASS_ATTR_FILTER_CLIP(c, name, min, max) ((void)0)
+#define CLASS_ATTR_LABEL(c, name, flags, label) ((void)0)
+#define CLASS_ATTR_STYLE(c, name, flags, style) ((void)0)
+#define CLASS_ATTR_STYLE_LABEL(c, name, flags, style, label) ((void)0)
+#define CLASS_ATTR_ENUM(c, name, flags, parsestr) ((void)0)
+
+#endif
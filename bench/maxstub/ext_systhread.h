@@ -0,0 +1,23 @@
+/**
+ *
+ * @file ext_systhread.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Minimal stand-in for the Max thread API (benchmarks)
+ *
+ * The external uses the C++11 thread library, nothing is needed here.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_MAXSTUB_EXT_SYSTHREAD_H
+#define MAXMYO_MAXSTUB_EXT_SYSTHREAD_H
+
+#include "ext.h"
+
+#endif
@@ -0,0 +1,555 @@
+/**
+ *
+ * @file maxstub.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Minimal stand-in for the Max API used by the external (benchmarks)
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "maxstub.h"
+#include "ext_obex.h"
+#include "z_dsp.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct _class {
+    struct Attribute {
+        std::string name;
+        char type;  // 'l': long, 'd': double, 's': symbol, 'a': atom
+        long offset;
+        method set;
+    };
+
+    std::string name;
+    method mnew;
+    method mfree;
+    long size;
+    std::map<std::string, std::pair<method, short> > methods;
+    std::vector<Attribute> attributes;
+};
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Attribute object passed to attribute setters
+struct AttributeObject {
+    t_object ob;
+    t_symbol *name;
+};
+
+struct Outlet {
+    void *owner;
+    int index;
+};
+
+typedef void (*perform64)(void *x, t_object *dsp64, double **ins,
+                          long numins, double **outs, long numouts,
+                          long frames, long flags, void *userparam);
+
+struct Instance {
+    t_class *c;
+    std::vector<Outlet *> outlets;
+    perform64 perform;
+    void *userparam;
+};
+
+/// DSP chain passed to dsp64 methods
+struct DspChain {
+    t_object ob;
+};
+
+struct ClockObject {
+    void *owner;
+    method fn;
+    bool scheduled;
+    Clock::time_point time;
+};
+
+/// Executes the clocks on a single thread, like the Max scheduler
+class Scheduler {
+  public:
+    Scheduler() : running_(NULL), quit_(false) {}
+
+    ~Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        condition_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void schedule(ClockObject *c, long ms) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!thread_.joinable())
+                thread_ = std::thread(&Scheduler::run, this);
+            c->scheduled = true;
+            c->time = Clock::now() + std::chrono::milliseconds(ms);
+            if (std::find(clocks_.begin(), clocks_.end(), c) == clocks_.end())
+                clocks_.push_back(c);
+        }
+        condition_.notify_all();
+    }
+
+    void unset(ClockObject *c) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        c->scheduled = false;
+    }
+
+    /// Removes a clock, waiting for its callback if it is running
+    void remove(ClockObject *c) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        c->scheduled = false;
+        clocks_.erase(std::remove(clocks_.begin(), clocks_.end(), c),
+                      clocks_.end());
+        if (std::this_thread::get_id() == thread_.get_id()) return;
+        condition_.wait(lock, [this, c] { return running_ != c; });
+    }
+
+  private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!quit_) {
+            ClockObject *next = NULL;
+            for (std::size_t i = 0; i < clocks_.size(); i++) {
+                if (clocks_[i]->scheduled &&
+                    (!next || clocks_[i]->time < next->time))
+                    next = clocks_[i];
+            }
+            if (!next) {
+                condition_.wait(lock);
+                continue;
+            }
+            if (next->time > Clock::now()) {
+                condition_.wait_until(lock, next->time);
+                continue;
+            }
+            next->scheduled = false;
+            running_ = next;
+            lock.unlock();
+            next->fn(next->owner);
+            lock.lock();
+            running_ = NULL;
+            condition_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread thread_;
+    std::vector<ClockObject *> clocks_;
+    ClockObject *running_;
+    bool quit_;
+};
+
+std::mutex registryMutex;
+std::map<std::string, t_class *> classes;
+std::map<void *, Instance> instances;
+std::map<void *, ClockObject *> clocks;
+
+maxstub_outlet_hook outletHook = NULL;
+void *outletHookData = NULL;
+bool verbose = false;
+
+Scheduler &scheduler() {
+    static Scheduler instance;
+    return instance;
+}
+
+void print(char const *prefix, const char *fmt, va_list args) {
+    char buffer[1024];
+    std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+    std::fprintf(stderr, "%s%s\n", prefix, buffer);
+}
+
+/// Splits arguments separated by spaces into atoms
+std::vector<t_atom> parse(const char *args) {
+    std::vector<t_atom> atoms;
+    std::istringstream stream(args ? args : "");
+    std::string word;
+    while (stream >> word) {
+        t_atom a;
+        char *end;
+        long l = std::strtol(word.c_str(), &end, 10);
+        if (*end == '\0') {
+            atom_setlong(&a, l);
+        } else {
+            double f = std::strtod(word.c_str(), &end);
+            if (*end == '\0')
+                atom_setfloat(&a, f);
+            else
+                atom_setsym(&a, gensym(word.c_str()));
+        }
+        atoms.push_back(a);
+    }
+    return atoms;
+}
+
+}  // namespace
+
+t_symbol *gensym(const char *name) {
+    static std::mutex *mutex = new std::mutex;
+    static std::map<std::string, t_symbol *> *symbols =
+        new std::map<std::string, t_symbol *>;
+    std::lock_guard<std::mutex> lock(*mutex);
+    std::map<std::string, t_symbol *>::iterator it = symbols->find(name);
+    if (it != symbols->end()) return it->second;
+    t_symbol *s = new t_symbol;
+    s->s_name = strdup(name);
+    s->s_thing = NULL;
+    (*symbols)[name] = s;
+    return s;
+}
+
+t_class *class_new(const char *name, method mnew, method mfree, long size,
+                   method mmenu, short type, ...) {
+    t_class *c = new t_class;
+    c->name = name;
+    c->mnew = mnew;
+    c->mfree = mfree;
+    c->size = size;
+    return c;
+}
+
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...) {
+    va_list args;
+    va_start(args, name);
+    int type = va_arg(args, int);
+    va_end(args);
+    c->methods[name] = std::make_pair(m, static_cast<short>(type));
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_register(t_symbol *name_space, t_class *c) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    classes[c->name] = c;
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_alias(t_class *c, t_symbol *aliasname) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    classes[aliasname->s_name] = c;
+    return MAX_ERR_NONE;
+}
+
+void maxstub_class_attr(t_class *c, const char *name, char type, long offset) {
+    t_class::Attribute attribute = {name, type, offset, NULL};
+    c->attributes.push_back(attribute);
+}
+
+void maxstub_class_attr_accessors(t_class *c, const char *name, method get,
+                                  method set) {
+    for (std::size_t i = 0; i < c->attributes.size(); i++) {
+        if (c->attributes[i].name == name) c->attributes[i].set = set;
+    }
+}
+
+void *object_alloc(t_class *c) {
+    void *x = std::calloc(1, c->size);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    instances[x].c = c;
+    return x;
+}
+
+void object_free(void *x) {
+    if (!x) return;
+    ClockObject *c = NULL;
+    Instance instance = {NULL, std::vector<Outlet *>(), NULL, NULL};
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::map<void *, ClockObject *>::iterator clock = clocks.find(x);
+        if (clock != clocks.end()) {
+            c = clock->second;
+            clocks.erase(clock);
+        } else {
+            std::map<void *, Instance>::iterator it = instances.find(x);
+            if (it == instances.end()) return;
+            instance = it->second;
+        }
+    }
+    if (c) {
+        scheduler().remove(c);
+        delete c;
+        return;
+    }
+    if (instance.c->mfree) instance.c->mfree(x);
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        instances.erase(x);
+    }
+    for (std::size_t i = 0; i < instance.outlets.size(); i++)
+        delete instance.outlets[i];
+    std::free(x);
+}
+
+void *object_method(void *x, t_symbol *s, ...) {
+    if (s == gensym("getname"))
+        return static_cast<AttributeObject *>(x)->name;
+    if (s == gensym("dsp_add64")) {
+        va_list args;
+        va_start(args, s);
+        void *object = va_arg(args, void *);
+        perform64 perform = reinterpret_cast<perform64>(va_arg(args, method));
+        va_arg(args, long);
+        void *userparam = va_arg(args, void *);
+        va_end(args);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        instances[object].perform = perform;
+        instances[object].userparam = userparam;
+    }
+    return NULL;
+}
+
+void *outlet_new(void *x, const char *type) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Instance &instance = instances[x];
+    Outlet *outlet = new Outlet;
+    outlet->owner = x;
+    outlet->index = static_cast<int>(instance.outlets.size());
+    instance.outlets.push_back(outlet);
+    return outlet;
+}
+
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av) {
+    Outlet *outlet = static_cast<Outlet *>(o);
+    if (outletHook)
+        outletHook(outletHookData, outlet->owner, outlet->index, ac, av);
+    return NULL;
+}
+
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av) {
+    return outlet_list(o, s, ac, av);
+}
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b) {
+    a->a_type = A_LONG;
+    a->a_w.w_long = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setfloat(t_atom *a, double b) {
+    a->a_type = A_FLOAT;
+    a->a_w.w_float = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setsym(t_atom *a, t_symbol *b) {
+    a->a_type = A_SYM;
+    a->a_w.w_sym = b;
+    return MAX_ERR_NONE;
+}
+
+t_atom_long atom_getlong(const t_atom *a) {
+    if (a->a_type == A_LONG) return a->a_w.w_long;
+    if (a->a_type == A_FLOAT) return static_cast<t_atom_long>(a->a_w.w_float);
+    return 0;
+}
+
+t_atom_float atom_getfloat(const t_atom *a) {
+    if (a->a_type == A_FLOAT) return a->a_w.w_float;
+    if (a->a_type == A_LONG) return static_cast<t_atom_float>(a->a_w.w_long);
+    return 0.;
+}
+
+t_symbol *atom_getsym(const t_atom *a) {
+    return a->a_type == A_SYM ? a->a_w.w_sym : gensym("");
+}
+
+long attr_args_offset(short ac, t_atom *av) {
+    for (short i = 0; i < ac; i++) {
+        if (av[i].a_type == A_SYM && av[i].a_w.w_sym->s_name[0] == '@')
+            return i;
+    }
+    return ac;
+}
+
+void attr_args_process(void *x, short ac, t_atom *av) {
+    t_class *c;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        c = instances[x].c;
+    }
+    for (long i = attr_args_offset(ac, av); i < ac;) {
+        std::string name = av[i].a_w.w_sym->s_name + 1;
+        long first = ++i;
+        while (i < ac && attr_args_offset(1, av + i) != 0) i++;
+        long count = i - first;
+        for (std::size_t j = 0; j < c->attributes.size(); j++) {
+            t_class::Attribute const &attribute = c->attributes[j];
+            if (attribute.name != name || count == 0) continue;
+            if (attribute.set) {
+                AttributeObject attr = {{NULL}, gensym(name.c_str())};
+                attribute.set(x, &attr, count, av + first);
+                continue;
+            }
+            char *field = static_cast<char *>(x) + attribute.offset;
+            if (attribute.type == 'l')
+                *reinterpret_cast<t_atom_long *>(field) =
+                    atom_getlong(av + first);
+            else if (attribute.type == 'd')
+                *reinterpret_cast<double *>(field) = atom_getfloat(av + first);
+            else if (attribute.type == 's')
+                *reinterpret_cast<t_symbol **>(field) = atom_getsym(av + first);
+            else
+                *reinterpret_cast<t_atom *>(field) = av[first];
+        }
+    }
+}
+
+void post(const char *fmt, ...) {
+    if (!verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    print("", fmt, args);
+    va_end(args);
+}
+
+void object_post(t_object *x, const char *fmt, ...) {
+    if (!verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    print("", fmt, args);
+    va_end(args);
+}
+
+void object_warn(t_object *x, const char *fmt, ...) {
+    if (!verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    print("warning: ", fmt, args);
+    va_end(args);
+}
+
+void object_error(t_object *x, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    print("error: ", fmt, args);
+    va_end(args);
+}
+
+char *getbytes(long size) { return static_cast<char *>(std::malloc(size)); }
+
+void freebytes(void *b, long size) { std::free(b); }
+
+t_clock *clock_new(void *x, method fn) {
+    ClockObject *c = new ClockObject;
+    c->owner = x;
+    c->fn = fn;
+    c->scheduled = false;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    clocks[c] = c;
+    return c;
+}
+
+void clock_delay(t_clock *c, long ms) {
+    scheduler().schedule(static_cast<ClockObject *>(c), ms);
+}
+
+void clock_unset(t_clock *c) {
+    scheduler().unset(static_cast<ClockObject *>(c));
+}
+
+void class_dspinit(t_class *c) {}
+
+void dsp_setup(t_pxobject *x, long nsignals) {}
+
+void dsp_free(t_pxobject *x) {}
+
+short path_nameconform(const char *src, char *dst, long style, long type) {
+    std::strncpy(dst, src, MAX_PATH_CHARS - 1);
+    dst[MAX_PATH_CHARS - 1] = '\0';
+    return 0;
+}
+
+void maxstub_set_outlet_hook(maxstub_outlet_hook hook, void *user_data) {
+    outletHook = hook;
+    outletHookData = user_data;
+}
+
+void maxstub_set_verbose(bool v) { verbose = v; }
+
+void *maxstub_new(const char *classname, const char *args) {
+    t_class *c;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::map<std::string, t_class *>::iterator it = classes.find(classname);
+        if (it == classes.end()) return NULL;
+        c = it->second;
+    }
+    std::vector<t_atom> atoms = parse(args);
+    typedef void *(*gimme_new)(t_symbol *, long, t_atom *);
+    return reinterpret_cast<gimme_new>(c->mnew)(
+        gensym(classname), static_cast<long>(atoms.size()),
+        atoms.empty() ? NULL : &atoms[0]);
+}
+
+void maxstub_dsp(void *x, double samplerate, long vectorsize) {
+    t_class *c;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        c = instances[x].c;
+    }
+    std::map<std::string, std::pair<method, short> >::iterator it =
+        c->methods.find("dsp64");
+    if (it == c->methods.end()) return;
+    typedef void (*dsp64)(void *, t_object *, short *, double, long, long);
+    DspChain chain = {{NULL}};
+    short count[1] = {0};
+    reinterpret_cast<dsp64>(it->second.first)(x, &chain.ob, count, samplerate,
+                                              vectorsize, 0);
+}
+
+void maxstub_perform(void *x, double **outs, long numouts, long frames) {
+    Instance instance;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        instance = instances[x];
+    }
+    if (!instance.perform) return;
+    DspChain chain = {{NULL}};
+    instance.perform(x, &chain.ob, NULL, 0, outs, numouts, frames, 0,
+                     instance.userparam);
+}
+
+void maxstub_send(void *x, const char *message, const char *args) {
+    t_class *c;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        c = instances[x].c;
+    }
+    std::map<std::string, std::pair<method, short> >::iterator it =
+        c->methods.find(message);
+    if (it == c->methods.end()) {
+        object_error(NULL, "%s: no method for %s", c->name.c_str(), message);
+        return;
+    }
+    std::vector<t_atom> atoms = parse(args);
+    if (it->second.second == A_GIMME) {
+        typedef void (*gimme)(void *, t_symbol *, long, t_atom *);
+        reinterpret_cast<gimme>(it->second.first)(
+            x, gensym(message), static_cast<long>(atoms.size()),
+            atoms.empty() ? NULL : &atoms[0]);
+    } else {
+        it->second.first(x);
+    }
+}
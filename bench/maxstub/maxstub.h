@@ -0,0 +1,47 @@
+/**
+ *
+ * @file maxstub.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Control of the Max API stand-in: objects, messages and outlets
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_MAXSTUB_H
+#define MAXMYO_MAXSTUB_H
+
+#include "ext.h"
+
+/// Called for every list sent to an outlet, with the object and the index of
+/// the outlet (in order of creation), on the thread that sends the list
+typedef void (*maxstub_outlet_hook)(void *user_data, void *object, int outlet,
+                                    short ac, t_atom *av);
+
+/// Sets the outlet hook (NULL to discard outlet messages)
+void maxstub_set_outlet_hook(maxstub_outlet_hook hook, void *user_data);
+
+/// Prints posts and warnings to stderr (errors are always printed)
+void maxstub_set_verbose(bool verbose);
+
+/// Creates an object of a registered class, as with an object box
+/// (arguments separated by spaces, e.g. "@multi all @stream 1")
+void *maxstub_new(const char *classname, const char *args);
+
+/// Sends a message with arguments to an object (from the calling thread)
+void maxstub_send(void *x, const char *message, const char *args);
+
+/// Starts the DSP of a signal object: calls its dsp64 method, which adds its
+/// perform routine
+void maxstub_dsp(void *x, double samplerate, long vectorsize);
+
+/// Runs the perform routine of a signal object for one signal vector (from
+/// the calling thread, as the audio thread)
+void maxstub_perform(void *x, double **outs, long numouts, long frames);
+
+#endif
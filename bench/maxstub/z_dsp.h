@@ -0,0 +1,34 @@
+/**
+ *
+ * @file z_dsp.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Minimal stand-in for the MSP API used by the signal external
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_MAXSTUB_Z_DSP_H
+#define MAXMYO_MAXSTUB_Z_DSP_H
+
+#include "ext.h"
+
+typedef struct _pxobject {
+    t_object z_ob;
+    long z_disabled;
+    short z_count;
+    short z_misc;
+} t_pxobject;
+
+enum { Z_NO_INPLACE = 1, Z_PUT_LAST = 2, Z_PUT_FIRST = 4 };
+
+void class_dspinit(t_class *c);
+void dsp_setup(t_pxobject *x, long nsignals);
+void dsp_free(t_pxobject *x);
+
+#endif
@@ -0,0 +1,433 @@
+/**
+ *
+ * @file myobench.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief End-to-end latency and throughput benchmark of the external
+ *
+ * Events generated by the simulated libmyo (lib/sim) go through the real
+ * path of the external: myo::Hub::onDeviceEvent, SharedHub, MaxMyoListener,
+ * the queues and drain clock in deferred mode, and the formatting of the
+ * output lists. The Max API is replaced by the stand-in of bench/maxstub,
+ * whose outlets report every list to the benchmark.
+ *
+ * Build (Linux or Mac, no Max or Myo SDK needed):
+ *   c++ -std=gnu++11 -O2 -Isrc -Ilib/win/include -Ilib/sim -Ibench/maxstub \
+ *       bench/myobench.cpp bench/maxstub/maxstub.cpp lib/sim/libmyo_sim.cpp \
+ *       -o myobench -lpthread
+ *
+ * Usage: myobench [--seconds s] [--speed x] [--devices 1,2,4,8]
+ *                 [--listeners 1,4,16] [--defer 0,1] [--control n]
+ *                 [--slice 1,5]
+ * Every combination of devices, listeners (objects with @multi all) and
+ * output mode is run for the given duration, at the given speed of the
+ * simulated devices (1: real time, 0: as fast as possible). Results are
+ * printed as JSON on the standard output:
+ * - cpu_ns_per_event: process CPU time per libmyo event, and
+ *   sim_cpu_ns_per_event the part spent generating the events (only
+ *   representative with --speed 0: in real time, the simulated devices
+ *   mostly wait for the next event)
+ * - for each stream, the number of lists output by all objects, the frames
+ *   they dropped because a buffer was full (deferred mode), and the
+ *   percentiles of the latency from the dispatch of the libmyo event by the
+ *   hub to the output of the list (us)
+ * - control: for each @slice, with no device (the event loop is idle) and
+ *   with 2 streaming devices, the percentiles of the latency of n
+ *   disconnections and n device switches of an object while another object
+ *   keeps the hub running (ms, see the latency message)
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "libmyo_sim.h"
+#include "maxstub.h"
+
+// the external, with its Max entry point renamed
+#define main myo_main
+#include "myo.cpp"
+#undef main
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int kDevices = 8;
+const int kSlots = 1 << 14;  // dispatch times kept per device and stream
+const std::size_t kSamples = 1 << 21;  // latencies kept per stream
+
+enum Stream { streamEmg, streamQuat, streamGyro, streamAccel, numStreams };
+const char *streamNames[numStreams] = {"emg", "quat", "gyro", "accel"};
+const ListenerStats::Queue streamQueues[numStreams] = {
+    ListenerStats::EmgQueue, ListenerStats::QuatQueue,
+    ListenerStats::GyroQueue, ListenerStats::AccelQueue};
+
+/// Dispatch time of the event of a device with the given timestamp
+struct Slot {
+    std::atomic<uint64_t> timestamp;
+    std::atomic<int64_t> time_ns;
+};
+
+struct Latencies {
+    std::atomic<uint64_t> outputs;
+    std::atomic<std::size_t> count;
+    std::vector<float> samples_us;
+};
+
+/// State shared by the dispatch hook (hub thread) and the outlet hook
+/// (hub thread, or scheduler thread in deferred mode)
+struct Bench {
+    std::atomic<bool> measuring;
+    std::atomic<int> num_devices;
+    libmyo_myo_t devices[kDevices];
+    uint64_t connection[kDevices];
+    Slot slots[kDevices][2][kSlots];  // EMG packets, IMU packets
+    uint64_t events;                  // hub thread only
+    Latencies latencies[numStreams];
+};
+
+Bench *bench;
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
+double cpuSeconds() { return static_cast<double>(std::clock()) / CLOCKS_PER_SEC; }
+
+int deviceSlot(libmyo_myo_t myo) {
+    int count = bench->num_devices;
+    for (int i = 0; i < count; i++) {
+        if (bench->devices[i] == myo) return i;
+    }
+    return -1;
+}
+
+uint64_t period(int packet) { return packet ? 20000 : 10000; }
+
+void dispatchHook(void *user_data, libmyo_event_t event) {
+    uint32_t type = libmyo_event_get_type(event);
+    if (bench->measuring) bench->events++;
+    if (type != libmyo_event_emg && type != libmyo_event_orientation &&
+        type != libmyo_event_connected)
+        return;
+    libmyo_myo_t myo = libmyo_event_get_myo(event);
+    uint64_t timestamp = libmyo_event_get_timestamp(event);
+    int d = deviceSlot(myo);
+    if (type == libmyo_event_connected) {
+        if (d < 0 && bench->num_devices < kDevices) {
+            d = bench->num_devices;
+            bench->devices[d] = myo;
+            bench->num_devices++;
+        }
+        if (d >= 0) bench->connection[d] = timestamp;
+        return;
+    }
+    if (d < 0) return;
+    int packet = type == libmyo_event_emg ? 0 : 1;
+    uint64_t k = (timestamp - bench->connection[d]) / period(packet);
+    Slot &slot = bench->slots[d][packet][k % kSlots];
+    // EMG samples come in pairs: the packet arrives with the first one
+    if (slot.timestamp.load(std::memory_order_relaxed) == timestamp) return;
+    slot.time_ns.store(nowNs(), std::memory_order_relaxed);
+    slot.timestamp.store(timestamp, std::memory_order_release);
+}
+
+void outletHook(void *user_data, void *object, int outlet, short ac,
+                t_atom *av) {
+    int64_t now = nowNs();
+    t_myo *self = static_cast<t_myo *>(object);
+    Stream stream;
+    if (outlet == 2)
+        stream = streamEmg;
+    else if (outlet == 3)
+        stream = streamQuat;
+    else if (outlet == 4)
+        stream = streamGyro;
+    else if (outlet == 5)
+        stream = streamAccel;
+    else
+        return;
+    if (!bench->measuring || ac < 2) return;
+
+    // lists start with the device index and the timestamp since connection
+    DeviceState const &device =
+        self->myoListener->devices[atom_getlong(av)];
+    int d = device.myo ? deviceSlot(device.myo->libmyoObject()) : -1;
+    if (d < 0) return;
+    uint64_t timestamp = device.connection_timestamp +
+                         static_cast<uint64_t>(
+                             std::floor(atom_getfloat(av + 1) * 1000. + 0.5));
+    int packet = stream == streamEmg ? 0 : 1;
+    uint64_t k = (timestamp - bench->connection[d]) / period(packet);
+    Slot &slot = bench->slots[d][packet][k % kSlots];
+    if (slot.timestamp.load(std::memory_order_acquire) != timestamp) return;
+    int64_t dispatched = slot.time_ns.load(std::memory_order_relaxed);
+
+    Latencies &latencies = bench->latencies[stream];
+    latencies.outputs++;
+    std::size_t index = latencies.count++;
+    if (index < kSamples)
+        latencies.samples_us[index] =
+            static_cast<float>((now - dispatched) / 1000.);
+}
+
+libmyo_handler_result_t enableEmg(void *user_data, libmyo_event_t event) {
+    if (libmyo_event_get_type(event) == libmyo_event_paired)
+        libmyo_set_stream_emg(libmyo_event_get_myo(event),
+                              libmyo_stream_emg_enabled, NULL);
+    return libmyo_handler_continue;
+}
+
+/// CPU time per event spent by the simulated libmyo alone
+double simulatorCost(int devices) {
+    libmyo_sim_config_t config;
+    libmyo_sim_default_config(&config);
+    config.devices = devices;
+    config.speed = 0.;
+    libmyo_sim_configure(&config);
+    libmyo_hub_t hub;
+    libmyo_init_hub(&hub, "", NULL);
+    libmyo_run(hub, 100, enableEmg, NULL, NULL);
+    libmyo_sim_stats_t before, after;
+    libmyo_sim_get_stats(hub, &before);
+    double start = cpuSeconds();
+    for (int i = 0; i < 1000; i++) libmyo_run(hub, 100, enableEmg, NULL, NULL);
+    double cpu = cpuSeconds() - start;
+    libmyo_sim_get_stats(hub, &after);
+    libmyo_shutdown_hub(hub, NULL);
+    uint64_t events = after.events - before.events;
+    return events ? cpu * 1e9 / events : 0.;
+}
+
+double percentile(std::vector<float> const &sorted, double q) {
+    if (sorted.empty()) return 0.;
+    std::size_t i = static_cast<std::size_t>(q * sorted.size());
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+std::vector<int> parseList(const char *arg) {
+    std::vector<int> values;
+    std::stringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ',')) values.push_back(std::atoi(item.c_str()));
+    return values;
+}
+
+/// Runs one configuration and prints its JSON object
+void run(int devices, int listeners, int defer, double seconds, double speed,
+         bool first) {
+    libmyo_sim_config_t config;
+    libmyo_sim_default_config(&config);
+    config.devices = devices;
+    config.speed = speed;
+    libmyo_sim_configure(&config);
+
+    bench->measuring = false;
+    bench->num_devices = 0;
+    bench->events = 0;
+    for (int d = 0; d < kDevices; d++) {
+        for (int p = 0; p < 2; p++) {
+            for (int k = 0; k < kSlots; k++) bench->slots[d][p][k].timestamp = 0;
+        }
+    }
+    for (int s = 0; s < numStreams; s++) {
+        bench->latencies[s].outputs = 0;
+        bench->latencies[s].count = 0;
+    }
+
+    std::ostringstream args;
+    args << "@multi all @stream 1 @timestamp 1 @defer " << defer;
+    std::vector<void *> objects;
+    for (int i = 0; i < listeners; i++) {
+        objects.push_back(maxstub_new("myo", args.str().c_str()));
+        maxstub_send(objects.back(), "connect", "");
+    }
+
+    // wait for the connection of all devices
+    Clock::time_point timeout = Clock::now() + std::chrono::seconds(5);
+    while (bench->num_devices < devices && Clock::now() < timeout)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    double cpu = cpuSeconds();
+    bench->measuring = true;
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(static_cast<long>(seconds * 1000.)));
+    bench->measuring = false;
+    cpu = cpuSeconds() - cpu;
+    uint64_t events = bench->events;
+
+    uint64_t dropped[numStreams] = {0};
+    for (int i = 0; i < listeners; i++) {
+        ListenerStats &stats = static_cast<t_myo *>(objects[i])
+                                   ->myoListener->stats;
+        for (int s = 0; s < numStreams; s++)
+            dropped[s] += stats.dropped[streamQueues[s]].get();
+        object_free(objects[i]);
+    }
+
+    std::printf("%s\n    {\"devices\": %d, \"listeners\": %d, \"defer\": %d, "
+                "\"events\": %llu, \"cpu_ns_per_event\": %.1f, "
+                "\"sim_cpu_ns_per_event\": %.1f,\n     \"streams\": {",
+                first ? "" : ",", devices, listeners, defer,
+                static_cast<unsigned long long>(events),
+                events ? cpu * 1e9 / events : 0., simulatorCost(devices));
+    for (int s = 0; s < numStreams; s++) {
+        Latencies &latencies = bench->latencies[s];
+        std::size_t count = std::min<std::size_t>(latencies.count, kSamples);
+        std::vector<float> sorted(latencies.samples_us.begin(),
+                                  latencies.samples_us.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        std::printf("%s\n       \"%s\": {\"outputs\": %llu, \"dropped\": %llu, "
+                    "\"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, "
+                    "\"max_us\": %.1f}",
+                    s ? "," : "", streamNames[s],
+                    static_cast<unsigned long long>(latencies.outputs),
+                    static_cast<unsigned long long>(dropped[s]),
+                    percentile(sorted, 0.5), percentile(sorted, 0.99),
+                    percentile(sorted, 0.999),
+                    sorted.empty() ? 0. : sorted.back());
+    }
+    std::printf("}}");
+    std::fflush(stdout);
+}
+
+void printLatencies(const char *name, std::vector<double> &latencies_ms) {
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    std::vector<float> sorted(latencies_ms.begin(), latencies_ms.end());
+    std::printf("\"%s\": {\"p50_ms\": %.3f, \"p99_ms\": %.3f, "
+                "\"max_ms\": %.3f}",
+                name, percentile(sorted, 0.5), percentile(sorted, 0.99),
+                sorted.empty() ? 0. : sorted.back());
+}
+
+/// Measures the latency of control operations and prints its JSON object
+void runControl(int devices, int slice, int count, double speed, bool first) {
+    libmyo_sim_config_t config;
+    libmyo_sim_default_config(&config);
+    config.devices = devices;
+    config.speed = speed;
+    libmyo_sim_configure(&config);
+    bench->measuring = false;
+    bench->num_devices = 0;
+
+    std::ostringstream args;
+    args << "@stream 1 @slice " << slice;
+    void *background = maxstub_new("myo", args.str().c_str());
+    maxstub_send(background, "connect", "");
+    void *object = maxstub_new("myo", args.str().c_str());
+    maxstub_send(object, "connect", "");
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // operations at random phases of the slices and of the streams
+    t_myo *self = static_cast<t_myo *>(object);
+    std::vector<double> disconnect, device;
+    t_atom name;
+    for (int i = 0; i < count; i++) {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(2000 + std::rand() % 10000));
+        maxstub_send(object, "disconnect", "");
+        disconnect.push_back(self->latencyDisconnect);
+        maxstub_send(object, "connect", "");
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(2000 + std::rand() % 10000));
+        atom_setsym(&name, gensym(i % 2 ? "sim-1" : "sim-2"));
+        myoSetDeviceAttr(self, NULL, 1, &name);
+        device.push_back(self->latencyDevice);
+    }
+    object_free(object);
+    object_free(background);
+
+    std::printf("%s\n    {\"slice\": %d, \"devices\": %d, ",
+                first ? "" : ",", slice, devices);
+    printLatencies("disconnect", disconnect);
+    std::printf(", ");
+    printLatencies("device", device);
+    std::printf("}");
+    std::fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = 2.;
+    double speed = 1.;
+    std::vector<int> devices = parseList("1,2,4,8");
+    std::vector<int> listeners = parseList("1,4,16");
+    std::vector<int> defer = parseList("0,1");
+    int control = 200;
+    std::vector<int> slices = parseList("1,5");
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--seconds")
+            seconds = std::atof(argv[i + 1]);
+        else if (option == "--speed")
+            speed = std::atof(argv[i + 1]);
+        else if (option == "--devices")
+            devices = parseList(argv[i + 1]);
+        else if (option == "--listeners")
+            listeners = parseList(argv[i + 1]);
+        else if (option == "--defer")
+            defer = parseList(argv[i + 1]);
+        else if (option == "--control")
+            control = std::atoi(argv[i + 1]);
+        else if (option == "--slice")
+            slices = parseList(argv[i + 1]);
+        else {
+            std::fprintf(stderr,
+                         "usage: %s [--seconds s] [--speed x] "
+                         "[--devices 1,2,4,8] [--listeners 1,4,16] "
+                         "[--defer 0,1] [--control n] [--slice 1,5]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    bench = new Bench;
+    for (int s = 0; s < numStreams; s++)
+        bench->latencies[s].samples_us.resize(kSamples);
+    libmyo_sim_set_hook(dispatchHook, NULL);
+    maxstub_set_outlet_hook(outletHook, NULL);
+    myo_main();
+
+    std::printf("{\"benchmark\": \"myobench\", \"seconds\": %g, "
+                "\"speed\": %g,\n  \"results\": [",
+                seconds, speed);
+    bool first = true;
+    for (std::size_t d = 0; d < devices.size(); d++) {
+        for (std::size_t l = 0; l < listeners.size(); l++) {
+            for (std::size_t m = 0; m < defer.size(); m++) {
+                int n = std::max(1, std::min(devices[d], kDevices));
+                std::fprintf(stderr, "devices %d listeners %d defer %d\n", n,
+                             listeners[l], defer[m]);
+                run(n, std::max(1, listeners[l]), defer[m] ? 1 : 0, seconds,
+                    speed, first);
+                first = false;
+            }
+        }
+    }
+    std::printf("\n  ],\n  \"control\": [");
+    first = true;
+    for (std::size_t s = 0; control > 0 && s < slices.size(); s++) {
+        for (int n = 0; n <= 2; n += 2) {
+            std::fprintf(stderr, "control slice %d devices %d\n", slices[s],
+                         n);
+            runControl(n, std::max(1, slices[s]), control, speed, first);
+            first = false;
+        }
+    }
+    std::printf("\n  ]}\n");
+    return 0;
+}
@@ -4,6 +4,11 @@
 
 #include <vector>
 
+// @CHANGED
+// O(1) lookup of Myo instances by libmyo handle, interruptible event loop
+#include <atomic>
+#include <unordered_map>
+
 #include <myo/libmyo.h>
 
 namespace myo {
@@ -52,12 +57,36 @@ public:
     /// Set the locking policy for Myos connected to the Hub.
     void setLockingPolicy(LockingPolicy lockingPolicy);
 
+    // @CHANGED
+    // Data streams can be disabled to skip their decoding and dispatch
+    // --------------- begin ----------------
+    /// Data streams decoded and dispatched to listeners.
+    enum EventMask {
+        eventMaskOrientation   = 1 << 0,
+        eventMaskAccelerometer = 1 << 1,
+        eventMaskGyroscope     = 1 << 2,
+        eventMaskPose          = 1 << 3,
+        eventMaskEmg           = 1 << 4,
+        eventMaskAll           = (1 << 5) - 1
+    };
+
+    /// Set the data streams (combination of EventMask values) dispatched to listeners. Other events are always
+    /// dispatched.
+    void setEventMask(unsigned int mask);
+    // --------------- end ----------------
+
     /// Run the event loop for the specified duration (in milliseconds).
     void run(unsigned int duration_ms);
 
     /// Run the event loop until a single event occurs, or the specified duration (in milliseconds) has elapsed.
     void runOnce(unsigned int duration_ms);
 
+    // @CHANGED
+    // Interruptible event loop
+    /// Run the event loop for the specified duration (in milliseconds), or until \a interrupt becomes non-zero. The
+    /// flag is checked after each event.
+    void run(unsigned int duration_ms, const std::atomic<int>& interrupt);
+
     /// @cond MYO_INTERNALS
 
     /// Return the internal libmyo object corresponding to this hub.
@@ -74,6 +103,16 @@ protected:
     std::vector<Myo*> _myos;
     std::vector<DeviceListener*> _listeners;
 
+    // @CHANGED
+    // Index of _myos by libmyo handle, and last device looked up (events
+    // usually come in bursts from the same device)
+    std::unordered_map<libmyo_myo_t, Myo*> _myoIndex;
+    mutable Myo* _lastMyo;
+
+    // @CHANGED
+    // Data streams dispatched to listeners
+    unsigned int _eventMask;
+
     /// @endcond
 
 private:
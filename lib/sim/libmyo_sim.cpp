@@ -0,0 +1,773 @@
+/**
+ *
+ * @file libmyo_sim.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Simulated libmyo implementing the libmyo C API
+ *
+ * Build as a static or shared library in place of the Myo SDK library, with
+ * the libmyo headers of the SDK:
+ *   c++ -std=c++11 -fPIC -shared -Ilib/win/include -Ilib/sim \
+ *       lib/sim/libmyo_sim.cpp -o libmyo.so -lpthread
+ * See libmyo_sim.h for the configuration of the generated traffic.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "libmyo_sim.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint64_t kNever = std::numeric_limits<uint64_t>::max();
+const uint64_t kEmgPeriod = 10000;   // EMG packets (2 samples) at 100 Hz
+const uint64_t kImuPeriod = 20000;   // IMU packets at 50 Hz
+const uint64_t kUnlockTime = 2000000;  // timed unlock (us)
+const uint64_t kConnectDelay = 50000;  // delay between initial connections
+const double kPi = 3.14159265358979323846;
+
+struct Device;
+
+struct Error {
+    libmyo_result_t kind;
+    std::string message;
+};
+
+/// Event passed to the handler (libmyo_event_t)
+struct Event {
+    uint32_t type;
+    uint64_t timestamp;
+    Device *myo;
+    float orientation[4];
+    float accelerometer[3];
+    float gyroscope[3];
+    uint32_t pose;
+    uint32_t arm;
+    uint32_t xDirection;
+    uint32_t warmupState;
+    uint32_t warmupResult;
+    float rotation;
+    int8_t rssi;
+    uint8_t battery;
+    int8_t emg[8];
+};
+
+/// Requests of the application, executed by the hub at the next run
+enum Request {
+    requestRssi = 1,
+    requestBattery = 2,
+    requestUnlockTimed = 4,
+    requestUnlockHold = 8,
+    requestLock = 16
+};
+
+struct Device {
+    unsigned int index;
+    uint64_t mac;
+    std::string name;
+
+    std::atomic<bool> streamEmg;
+    std::atomic<unsigned int> requests;
+
+    bool paired;
+    bool connected;
+    bool emg;  // EMG streaming as seen by the generator
+    bool locked;
+    uint64_t lockAt;
+    uint64_t nextChange;  // next connection or disconnection
+    uint64_t downTime;    // time disconnected during the current storm
+    uint64_t nextEmg;
+    uint64_t nextImu;
+    uint64_t nextPose;
+    uint32_t pose;
+    double phase;
+};
+
+struct Hub {
+    libmyo_sim_config_t config;
+    std::vector<Device *> devices;
+    std::atomic<int> lockingPolicy;
+
+    std::mutex mutex;  // serializes libmyo_run()
+    std::deque<Event> pending;
+    uint64_t origin;  // simulated time at creation (us)
+    uint64_t now;     // simulated time up to which events were generated
+    uint64_t nextStorm;
+    Clock::time_point start;
+    uint32_t random;
+
+    std::atomic<uint64_t> events;
+    std::atomic<uint64_t> emgSamples;
+    std::atomic<uint64_t> emgLost;
+    std::atomic<uint64_t> imuSamples;
+    std::atomic<uint64_t> imuLost;
+    std::atomic<uint64_t> connections;
+    std::atomic<uint64_t> disconnections;
+};
+
+std::mutex configMutex;
+bool configured = false;
+libmyo_sim_config_t configuration;
+
+libmyo_sim_hook_t dispatchHook = NULL;
+void *dispatchHookData = NULL;
+
+libmyo_result_t fail(libmyo_error_details_t *out_error, libmyo_result_t kind,
+                     char const *message) {
+    if (out_error) {
+        Error *error = new Error;
+        error->kind = kind;
+        error->message = message;
+        *out_error = error;
+    }
+    return kind;
+}
+
+libmyo_result_t succeed(libmyo_error_details_t *out_error) {
+    if (out_error) *out_error = NULL;
+    return libmyo_success;
+}
+
+/// xorshift32
+uint32_t nextRandom(Hub &hub) {
+    uint32_t x = hub.random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    hub.random = x;
+    return x;
+}
+
+/// Uniform in [0, 1)
+double uniform(Hub &hub) { return (nextRandom(hub) >> 8) / 16777216.; }
+
+/// Uniform in [0, range)
+uint64_t uniform(Hub &hub, uint64_t range) {
+    return range ? static_cast<uint64_t>(uniform(hub) * range) : 0;
+}
+
+Event makeEvent(libmyo_event_type_t type, uint64_t timestamp, Device *myo) {
+    Event event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.timestamp = timestamp;
+    event.myo = myo;
+    return event;
+}
+
+/// Connects or disconnects a device
+void toggleConnection(Hub &hub, Device &device, uint64_t t,
+                      std::vector<Event> &out) {
+    if (device.connected) {
+        out.push_back(makeEvent(libmyo_event_disconnected, t, &device));
+        if (hub.config.storm_unpair) {
+            out.push_back(makeEvent(libmyo_event_unpaired, t, &device));
+            device.paired = false;
+        }
+        device.connected = false;
+        device.nextChange = t + device.downTime;
+        hub.disconnections++;
+        return;
+    }
+    if (!device.paired) {
+        out.push_back(makeEvent(libmyo_event_paired, t, &device));
+        device.paired = true;
+    }
+    out.push_back(makeEvent(libmyo_event_connected, t, &device));
+    Event sync = makeEvent(libmyo_event_arm_synced, t, &device);
+    sync.arm = device.index % 2 ? libmyo_arm_left : libmyo_arm_right;
+    sync.xDirection = libmyo_x_direction_toward_wrist;
+    sync.warmupState = libmyo_warmup_state_warm;
+    sync.rotation = 0.f;
+    out.push_back(sync);
+    device.connected = true;
+    device.locked = hub.lockingPolicy == libmyo_locking_policy_standard;
+    device.lockAt = kNever;
+    device.nextChange = kNever;
+    device.nextEmg = t;
+    device.nextImu = t;
+    device.nextPose = t + 1000000 + uniform(hub, 2000000);
+    hub.connections++;
+}
+
+void emitEmg(Hub &hub, Device &device, uint64_t t, std::vector<Event> &out) {
+    hub.emgSamples += 2;
+    if (uniform(hub) < hub.config.emg_loss) {
+        hub.emgLost += 2;
+        return;
+    }
+    // noise modulated by a slow contraction envelope
+    double seconds = (t - hub.origin) * 1e-6;
+    double envelope =
+        10. + 50. * (0.5 + 0.5 * std::sin(2. * kPi * 0.5 * seconds +
+                                          device.phase));
+    for (int sample = 0; sample < 2; sample++) {
+        Event event = makeEvent(libmyo_event_emg, t, &device);
+        for (int i = 0; i < 8; i++) {
+            double noise = uniform(hub) + uniform(hub) + uniform(hub) - 1.5;
+            double value = std::floor(noise * envelope + 0.5);
+            event.emg[i] = static_cast<int8_t>(
+                std::max(-128., std::min(127., value)));
+        }
+        out.push_back(event);
+    }
+}
+
+void emitImu(Hub &hub, Device &device, uint64_t t, std::vector<Event> &out) {
+    hub.imuSamples++;
+    if (uniform(hub) < hub.config.imu_loss) {
+        hub.imuLost++;
+        return;
+    }
+    // slow oscillation around the vertical axis
+    double seconds = (t - hub.origin) * 1e-6;
+    double w = 2. * kPi * 0.2;
+    double yaw = 0.5 * std::sin(w * seconds + device.phase);
+    double yawRate = 0.5 * w * std::cos(w * seconds + device.phase);
+    Event event = makeEvent(libmyo_event_orientation, t, &device);
+    event.orientation[libmyo_orientation_z] =
+        static_cast<float>(std::sin(yaw / 2.));
+    event.orientation[libmyo_orientation_w] =
+        static_cast<float>(std::cos(yaw / 2.));
+    for (int i = 0; i < 3; i++) {
+        event.accelerometer[i] = static_cast<float>(
+            (i == 2 ? 1. : 0.) + 0.01 * (uniform(hub) - 0.5));
+        event.gyroscope[i] = static_cast<float>(
+            (i == 2 ? yawRate * 180. / kPi : 0.) + 0.5 * (uniform(hub) - 0.5));
+    }
+    out.push_back(event);
+}
+
+/// Executes the pending requests of the application for a device
+void handleRequests(Hub &hub, Device &device, uint64_t t,
+                    std::vector<Event> &out) {
+    unsigned int requests = device.requests.exchange(0);
+    if (!device.connected) return;
+    if (requests & requestRssi) {
+        Event event = makeEvent(libmyo_event_rssi, t, &device);
+        event.rssi = static_cast<int8_t>(-50 - uniform(hub, 30));
+        out.push_back(event);
+    }
+    if (requests & requestBattery) {
+        Event event = makeEvent(libmyo_event_battery_level, t, &device);
+        event.battery = static_cast<uint8_t>(100 - device.index % 50);
+        out.push_back(event);
+    }
+    if (requests & requestLock) {
+        if (!device.locked)
+            out.push_back(makeEvent(libmyo_event_locked, t, &device));
+        device.locked = true;
+        device.lockAt = kNever;
+    } else if (requests & (requestUnlockTimed | requestUnlockHold)) {
+        if (device.locked)
+            out.push_back(makeEvent(libmyo_event_unlocked, t, &device));
+        device.locked = false;
+        device.lockAt = (requests & requestUnlockHold) ? kNever
+                                                       : t + kUnlockTime;
+    }
+}
+
+/// Generates the events of a device up to the given time
+void generate(Hub &hub, Device &device, uint64_t until,
+              std::vector<Event> &out) {
+    handleRequests(hub, device, hub.now, out);
+    bool emg = device.streamEmg;
+    if (emg && !device.emg) device.nextEmg = hub.now;
+    device.emg = emg;
+    for (;;) {
+        uint64_t t = device.nextChange;
+        if (device.connected) {
+            t = std::min(t, std::min(device.nextImu, device.nextPose));
+            t = std::min(t, device.lockAt);
+            if (device.emg) t = std::min(t, device.nextEmg);
+        }
+        if (t > until) break;
+        if (t == device.nextChange) {
+            toggleConnection(hub, device, t, out);
+        } else if (device.emg && t == device.nextEmg) {
+            emitEmg(hub, device, t, out);
+            device.nextEmg += kEmgPeriod;
+        } else if (t == device.nextImu) {
+            emitImu(hub, device, t, out);
+            device.nextImu += kImuPeriod;
+        } else if (t == device.lockAt) {
+            out.push_back(makeEvent(libmyo_event_locked, t, &device));
+            device.locked = true;
+            device.lockAt = kNever;
+        } else {
+            uint32_t pose = static_cast<uint32_t>(uniform(hub, 5));
+            if (pose != device.pose &&
+                (!device.locked ||
+                 hub.lockingPolicy == libmyo_locking_policy_none)) {
+                Event event = makeEvent(libmyo_event_pose, t, &device);
+                event.pose = pose;
+                out.push_back(event);
+                device.pose = pose;
+            }
+            device.nextPose = t + 1000000 + uniform(hub, 2000000);
+        }
+    }
+}
+
+bool earlier(Event const &a, Event const &b) {
+    return a.timestamp < b.timestamp;
+}
+
+/// Generates the events of all devices up to the given time
+void advance(Hub &hub, uint64_t until) {
+    if (until <= hub.now) return;
+    // storms: all connected devices drop within a few ms and come back after
+    // a random delay
+    while (hub.nextStorm <= until) {
+        for (std::size_t i = 0; i < hub.devices.size(); i++) {
+            Device &device = *hub.devices[i];
+            if (!device.connected || device.nextChange != kNever) continue;
+            device.nextChange = std::max(hub.now + 1, hub.nextStorm) +
+                                uniform(hub, 5000);
+            device.downTime =
+                1 + uniform(hub, hub.config.storm_duration_ms * 1000ull);
+        }
+        hub.nextStorm += hub.config.storm_interval_ms * 1000ull;
+    }
+    std::vector<Event> batch;
+    for (std::size_t i = 0; i < hub.devices.size(); i++)
+        generate(hub, *hub.devices[i], until, batch);
+    std::stable_sort(batch.begin(), batch.end(), earlier);
+    hub.now = until;
+    hub.events += batch.size();
+    hub.pending.insert(hub.pending.end(), batch.begin(), batch.end());
+}
+
+/// Time of the next event of the hub, assuming no request
+uint64_t nextEvent(Hub const &hub) {
+    uint64_t t = hub.nextStorm;
+    for (std::size_t i = 0; i < hub.devices.size(); i++) {
+        Device const &device = *hub.devices[i];
+        t = std::min(t, device.nextChange);
+        if (device.connected) {
+            t = std::min(t, std::min(device.nextImu, device.nextPose));
+            t = std::min(t, device.lockAt);
+            if (device.streamEmg) t = std::min(t, device.nextEmg);
+        }
+    }
+    return t;
+}
+
+/// Simulated time corresponding to the current real time
+uint64_t simulatedNow(Hub const &hub) {
+    double elapsed =
+        std::chrono::duration<double, std::micro>(Clock::now() - hub.start)
+            .count();
+    return hub.origin + static_cast<uint64_t>(elapsed * hub.config.speed);
+}
+
+double environment(char const *name, double value) {
+    char const *env = std::getenv(name);
+    return (env && *env) ? std::atof(env) : value;
+}
+
+/// Passes the oldest pending event to the handler
+libmyo_handler_result_t dispatch(Hub &hub, libmyo_handler_t handler,
+                                 void *user_data) {
+    Event const *event = &hub.pending.front();
+    if (dispatchHook) dispatchHook(dispatchHookData, event);
+    libmyo_handler_result_t result = handler(user_data, event);
+    hub.pending.pop_front();
+    return result;
+}
+
+Hub *toHub(libmyo_hub_t hub) { return static_cast<Hub *>(hub); }
+
+Event const *toEvent(libmyo_event_t event) {
+    return static_cast<Event const *>(event);
+}
+
+}  // namespace
+
+extern "C" {
+
+void libmyo_sim_default_config(libmyo_sim_config_t *config) {
+    if (!config) return;
+    config->devices =
+        static_cast<unsigned int>(environment("MYO_SIM_DEVICES", 1));
+    config->speed = environment("MYO_SIM_SPEED", 1.);
+    config->emg_loss = environment("MYO_SIM_EMG_LOSS", 0.);
+    config->imu_loss = environment("MYO_SIM_IMU_LOSS", 0.);
+    config->storm_interval_ms =
+        static_cast<unsigned int>(environment("MYO_SIM_STORM_INTERVAL", 0));
+    config->storm_duration_ms =
+        static_cast<unsigned int>(environment("MYO_SIM_STORM_DURATION", 500));
+    config->storm_unpair =
+        static_cast<int>(environment("MYO_SIM_STORM_UNPAIR", 0));
+    config->seed = static_cast<unsigned int>(environment("MYO_SIM_SEED", 1));
+}
+
+void libmyo_sim_configure(const libmyo_sim_config_t *config) {
+    std::lock_guard<std::mutex> lock(configMutex);
+    configured = config != NULL;
+    if (config) configuration = *config;
+}
+
+libmyo_result_t libmyo_sim_get_stats(libmyo_hub_t hub_opq,
+                                     libmyo_sim_stats_t *stats) {
+    Hub *hub = toHub(hub_opq);
+    if (!hub || !stats) return libmyo_error_invalid_argument;
+    stats->events = hub->events;
+    stats->emg_samples = hub->emgSamples;
+    stats->emg_lost = hub->emgLost;
+    stats->imu_samples = hub->imuSamples;
+    stats->imu_lost = hub->imuLost;
+    stats->connections = hub->connections;
+    stats->disconnections = hub->disconnections;
+    return libmyo_success;
+}
+
+void libmyo_sim_set_hook(libmyo_sim_hook_t hook, void *user_data) {
+    dispatchHook = hook;
+    dispatchHookData = user_data;
+}
+
+const char *libmyo_error_cstring(libmyo_error_details_t details) {
+    return details ? static_cast<Error *>(details)->message.c_str() : "";
+}
+
+libmyo_result_t libmyo_error_kind(libmyo_error_details_t details) {
+    return details ? static_cast<Error *>(details)->kind : libmyo_success;
+}
+
+void libmyo_free_error_details(libmyo_error_details_t details) {
+    delete static_cast<Error *>(details);
+}
+
+const char *libmyo_string_c_str(libmyo_string_t string) {
+    return static_cast<std::string *>(string)->c_str();
+}
+
+void libmyo_string_free(libmyo_string_t string) {
+    delete static_cast<std::string *>(string);
+}
+
+libmyo_string_t libmyo_mac_address_to_string(uint64_t mac) {
+    char buffer[18];
+    std::snprintf(buffer, sizeof(buffer), "%02x-%02x-%02x-%02x-%02x-%02x",
+                  static_cast<unsigned int>((mac >> 40) & 0xff),
+                  static_cast<unsigned int>((mac >> 32) & 0xff),
+                  static_cast<unsigned int>((mac >> 24) & 0xff),
+                  static_cast<unsigned int>((mac >> 16) & 0xff),
+                  static_cast<unsigned int>((mac >> 8) & 0xff),
+                  static_cast<unsigned int>(mac & 0xff));
+    return new std::string(buffer);
+}
+
+uint64_t libmyo_string_to_mac_address(const char *string) {
+    uint64_t mac = 0;
+    for (; string && *string; string++) {
+        char c = *string;
+        int digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            continue;
+        mac = (mac << 4) | static_cast<uint64_t>(digit);
+    }
+    return mac;
+}
+
+libmyo_result_t libmyo_init_hub(libmyo_hub_t *out_hub,
+                                const char *application_identifier,
+                                libmyo_error_details_t *out_error) {
+    if (!out_hub)
+        return fail(out_error, libmyo_error_invalid_argument,
+                    "out_hub is null");
+    if (application_identifier && std::strlen(application_identifier) > 255)
+        return fail(out_error, libmyo_error_invalid_argument,
+                    "application identifier is too long");
+
+    Hub *hub = new Hub;
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        if (configured)
+            hub->config = configuration;
+        else
+            libmyo_sim_default_config(&hub->config);
+    }
+    if (hub->config.speed < 0.) hub->config.speed = 0.;
+    hub->lockingPolicy = libmyo_locking_policy_standard;
+    hub->origin = 1000000000ull;  // timestamps are never 0
+    hub->now = hub->origin;
+    hub->nextStorm = hub->config.storm_interval_ms
+                         ? hub->origin + hub->config.storm_interval_ms * 1000ull
+                         : kNever;
+    hub->start = Clock::now();
+    hub->random = hub->config.seed ? hub->config.seed : 1;
+    hub->events = 0;
+    hub->emgSamples = 0;
+    hub->emgLost = 0;
+    hub->imuSamples = 0;
+    hub->imuLost = 0;
+    hub->connections = 0;
+    hub->disconnections = 0;
+
+    for (unsigned int i = 0; i < hub->config.devices; i++) {
+        Device *device = new Device;
+        device->index = i;
+        device->mac = 0xc0ffee000000ull + i;
+        char name[32];
+        std::snprintf(name, sizeof(name), "sim-%u", i + 1);
+        device->name = name;
+        device->streamEmg = false;
+        device->requests = 0;
+        device->paired = false;
+        device->connected = false;
+        device->emg = false;
+        device->locked = true;
+        device->lockAt = kNever;
+        device->nextChange = hub->origin + i * kConnectDelay;
+        device->downTime = 0;
+        device->nextEmg = kNever;
+        device->nextImu = kNever;
+        device->nextPose = kNever;
+        device->pose = libmyo_pose_rest;
+        device->phase = uniform(*hub) * 2. * kPi;
+        hub->devices.push_back(device);
+    }
+    *out_hub = hub;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_shutdown_hub(libmyo_hub_t hub_opq,
+                                    libmyo_error_details_t *out_error) {
+    Hub *hub = toHub(hub_opq);
+    if (!hub)
+        return fail(out_error, libmyo_error_invalid_argument, "hub is null");
+    for (std::size_t i = 0; i < hub->devices.size(); i++)
+        delete hub->devices[i];
+    delete hub;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_set_locking_policy(
+    libmyo_hub_t hub_opq, libmyo_locking_policy_t locking_policy,
+    libmyo_error_details_t *out_error) {
+    Hub *hub = toHub(hub_opq);
+    if (!hub)
+        return fail(out_error, libmyo_error_invalid_argument, "hub is null");
+    hub->lockingPolicy = locking_policy;
+    return succeed(out_error);
+}
+
+uint64_t libmyo_get_mac_address(libmyo_myo_t myo) {
+    return myo ? static_cast<Device *>(myo)->mac : 0;
+}
+
+libmyo_result_t libmyo_vibrate(libmyo_myo_t myo, libmyo_vibration_type_t type,
+                               libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_request_rssi(libmyo_myo_t myo,
+                                    libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    static_cast<Device *>(myo)->requests |= requestRssi;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_request_battery_level(libmyo_myo_t myo_opq,
+                                             libmyo_error_details_t *out_error) {
+    if (!myo_opq)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    static_cast<Device *>(myo_opq)->requests |= requestBattery;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_set_stream_emg(libmyo_myo_t myo,
+                                      libmyo_stream_emg_t emg,
+                                      libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    static_cast<Device *>(myo)->streamEmg = emg == libmyo_stream_emg_enabled;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_myo_unlock(libmyo_myo_t myo, libmyo_unlock_type_t type,
+                                  libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    static_cast<Device *>(myo)->requests |=
+        type == libmyo_unlock_hold ? requestUnlockHold : requestUnlockTimed;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_myo_lock(libmyo_myo_t myo,
+                                libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    static_cast<Device *>(myo)->requests |= requestLock;
+    return succeed(out_error);
+}
+
+libmyo_result_t libmyo_myo_notify_user_action(
+    libmyo_myo_t myo, libmyo_user_action_type_t type,
+    libmyo_error_details_t *out_error) {
+    if (!myo)
+        return fail(out_error, libmyo_error_invalid_argument, "myo is null");
+    return succeed(out_error);
+}
+
+uint32_t libmyo_event_get_type(libmyo_event_t event) {
+    return toEvent(event)->type;
+}
+
+uint64_t libmyo_event_get_timestamp(libmyo_event_t event) {
+    return toEvent(event)->timestamp;
+}
+
+libmyo_myo_t libmyo_event_get_myo(libmyo_event_t event) {
+    return toEvent(event)->myo;
+}
+
+uint64_t libmyo_event_get_mac_address(libmyo_event_t event_opq) {
+    return toEvent(event_opq)->myo->mac;
+}
+
+libmyo_string_t libmyo_event_get_myo_name(libmyo_event_t event) {
+    return new std::string(toEvent(event)->myo->name);
+}
+
+unsigned int libmyo_event_get_firmware_version(
+    libmyo_event_t event, libmyo_version_component_t component) {
+    switch (component) {
+        case libmyo_version_major:
+            return 1;
+        case libmyo_version_minor:
+            return 5;
+        case libmyo_version_patch:
+            return 1970;
+        case libmyo_version_hardware_rev:
+            return libmyo_hardware_rev_d;
+    }
+    return 0;
+}
+
+libmyo_arm_t libmyo_event_get_arm(libmyo_event_t event) {
+    return static_cast<libmyo_arm_t>(toEvent(event)->arm);
+}
+
+libmyo_x_direction_t libmyo_event_get_x_direction(libmyo_event_t event) {
+    return static_cast<libmyo_x_direction_t>(toEvent(event)->xDirection);
+}
+
+libmyo_warmup_state_t libmyo_event_get_warmup_state(libmyo_event_t event) {
+    return static_cast<libmyo_warmup_state_t>(toEvent(event)->warmupState);
+}
+
+libmyo_warmup_result_t libmyo_event_get_warmup_result(libmyo_event_t event) {
+    return static_cast<libmyo_warmup_result_t>(toEvent(event)->warmupResult);
+}
+
+float libmyo_event_get_rotation_on_arm(libmyo_event_t event) {
+    return toEvent(event)->rotation;
+}
+
+float libmyo_event_get_orientation(libmyo_event_t event,
+                                   libmyo_orientation_index index) {
+    return index < 4 ? toEvent(event)->orientation[index] : 0.f;
+}
+
+float libmyo_event_get_accelerometer(libmyo_event_t event,
+                                     unsigned int index) {
+    return index < 3 ? toEvent(event)->accelerometer[index] : 0.f;
+}
+
+float libmyo_event_get_gyroscope(libmyo_event_t event, unsigned int index) {
+    return index < 3 ? toEvent(event)->gyroscope[index] : 0.f;
+}
+
+libmyo_pose_t libmyo_event_get_pose(libmyo_event_t event) {
+    return static_cast<libmyo_pose_t>(toEvent(event)->pose);
+}
+
+int8_t libmyo_event_get_rssi(libmyo_event_t event) {
+    return toEvent(event)->rssi;
+}
+
+uint8_t libmyo_event_get_battery_level(libmyo_event_t event) {
+    return toEvent(event)->battery;
+}
+
+int8_t libmyo_event_get_emg(libmyo_event_t event, unsigned int sensor) {
+    return sensor < 8 ? toEvent(event)->emg[sensor] : 0;
+}
+
+libmyo_result_t libmyo_run(libmyo_hub_t hub_opq, unsigned int duration_ms,
+                           libmyo_handler_t handler, void *user_data,
+                           libmyo_error_details_t *out_error) {
+    Hub *hub = toHub(hub_opq);
+    if (!hub || !handler)
+        return fail(out_error, libmyo_error_invalid_argument,
+                    "hub or handler is null");
+    std::lock_guard<std::mutex> lock(hub->mutex);
+
+    // as fast as possible: duration_ms of traffic at once
+    if (hub->config.speed <= 0.) {
+        advance(*hub, hub->now + duration_ms * 1000ull);
+        while (!hub->pending.empty()) {
+            if (dispatch(*hub, handler, user_data) == libmyo_handler_stop)
+                break;
+        }
+        return succeed(out_error);
+    }
+
+    // paced by the real time: events are queued while the hub is not run
+    Clock::time_point deadline =
+        Clock::now() + std::chrono::milliseconds(duration_ms);
+    for (;;) {
+        advance(*hub, simulatedNow(*hub));
+        while (!hub->pending.empty()) {
+            if (dispatch(*hub, handler, user_data) == libmyo_handler_stop)
+                return succeed(out_error);
+        }
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) break;
+        uint64_t next = nextEvent(*hub);
+        Clock::time_point wake = deadline;
+        if (next != kNever && next > hub->now) {
+            wake = std::min(
+                wake, now + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double, std::micro>(
+                                    (next - hub->now) / hub->config.speed)));
+        }
+        // requests are answered within a millisecond
+        wake = std::min(wake, now + std::chrono::milliseconds(1));
+        std::this_thread::sleep_until(wake);
+    }
+    return succeed(out_error);
+}
+
+}  // extern "C"
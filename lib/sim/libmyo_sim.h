@@ -0,0 +1,97 @@
+/**
+ *
+ * @file libmyo_sim.h
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Simulated libmyo: configuration of the generated traffic
+ *
+ * libmyo_sim.cpp implements the libmyo C API (myo/libmyo.h) without Myo
+ * Connect or any armband, so that the myo::Hub wrapper, the shared hub and
+ * the listener can be run and benchmarked on any platform. Simulated devices
+ * stream 200 Hz EMG (in packets of two samples with the same timestamp) and
+ * 50 Hz IMU data, change poses, and can go through disconnection storms and
+ * packet loss.
+ *
+ * The traffic is configured with libmyo_sim_configure() before the hub is
+ * created, or with environment variables read by libmyo_sim_default_config():
+ *   MYO_SIM_DEVICES         number of devices (default 1)
+ *   MYO_SIM_SPEED           simulated time per real time (default 1, 0: as
+ *                           fast as possible, each libmyo_run() call then
+ *                           generates duration_ms of traffic immediately)
+ *   MYO_SIM_EMG_LOSS        probability of losing an EMG packet (default 0)
+ *   MYO_SIM_IMU_LOSS        probability of losing an IMU packet (default 0)
+ *   MYO_SIM_STORM_INTERVAL  interval between disconnection storms in ms
+ *                           (default 0: no storm)
+ *   MYO_SIM_STORM_DURATION  maximum time a device stays disconnected during
+ *                           a storm in ms (default 500)
+ *   MYO_SIM_STORM_UNPAIR    devices are also unpaired during storms (0/1)
+ *   MYO_SIM_SEED            seed of the random generator (default 1)
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_LIBMYO_SIM_H
+#define MAXMYO_LIBMYO_SIM_H
+
+#include <myo/libmyo.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Traffic generated by a simulated hub
+typedef struct {
+    unsigned int devices;
+    double speed;
+    double emg_loss;
+    double imu_loss;
+    unsigned int storm_interval_ms;
+    unsigned int storm_duration_ms;
+    int storm_unpair;
+    unsigned int seed;
+} libmyo_sim_config_t;
+
+/// Events generated by a simulated hub since its creation
+typedef struct {
+    uint64_t events;
+    uint64_t emg_samples;
+    uint64_t emg_lost;
+    uint64_t imu_samples;
+    uint64_t imu_lost;
+    uint64_t connections;
+    uint64_t disconnections;
+} libmyo_sim_stats_t;
+
+/// Fills the configuration with the defaults, overridden by the environment
+LIBMYO_EXPORT
+void libmyo_sim_default_config(libmyo_sim_config_t *config);
+
+/// Sets the configuration of the hubs created afterwards (the default
+/// configuration is used until this is called)
+LIBMYO_EXPORT
+void libmyo_sim_configure(const libmyo_sim_config_t *config);
+
+/// Copies the statistics of a hub (can be called while the hub runs)
+LIBMYO_EXPORT
+libmyo_result_t libmyo_sim_get_stats(libmyo_hub_t hub,
+                                     libmyo_sim_stats_t *stats);
+
+/// Function called on the hub thread just before each event is passed to the
+/// handler of libmyo_run() (e.g. to timestamp events in benchmarks)
+typedef void (*libmyo_sim_hook_t)(void *user_data, libmyo_event_t event);
+
+/// Sets the dispatch hook of all hubs (NULL to remove it). Must not be called
+/// while a hub runs.
+LIBMYO_EXPORT
+void libmyo_sim_set_hook(libmyo_sim_hook_t hook, void *user_data);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif
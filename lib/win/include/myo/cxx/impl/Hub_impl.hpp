@@ -14,11 +14,99 @@
 
 namespace myo {
 
+// @CHANGED
+// Events are decoded once into a plain struct shared by all listeners instead
+// of being decoded again for every listener
+// --------------- begin ----------------
+namespace detail {
+
+struct DecodedEvent {
+    uint32_t type;
+    uint64_t timestamp;
+    FirmwareVersion firmwareVersion;
+    uint32_t arm;
+    uint32_t xDirection;
+    float rotationOnArm;
+    uint32_t warmupState;
+    uint32_t warmupResult;
+    float orientation[4];
+    float accelerometer[3];
+    float gyroscope[3];
+    uint32_t pose;
+    int8_t rssi;
+    uint8_t batteryLevel;
+    int8_t emg[8];
+};
+
+inline
+void decodeEvent(libmyo_event_t event, DecodedEvent& decoded, unsigned int mask)
+{
+    decoded.type = libmyo_event_get_type(event);
+    decoded.timestamp = libmyo_event_get_timestamp(event);
+
+    switch (decoded.type) {
+    case libmyo_event_paired:
+    case libmyo_event_connected:
+        decoded.firmwareVersion.firmwareVersionMajor = libmyo_event_get_firmware_version(event, libmyo_version_major);
+        decoded.firmwareVersion.firmwareVersionMinor = libmyo_event_get_firmware_version(event, libmyo_version_minor);
+        decoded.firmwareVersion.firmwareVersionPatch = libmyo_event_get_firmware_version(event, libmyo_version_patch);
+        decoded.firmwareVersion.firmwareVersionHardwareRev = libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev);
+        break;
+    case libmyo_event_arm_synced:
+        decoded.arm = libmyo_event_get_arm(event);
+        decoded.xDirection = libmyo_event_get_x_direction(event);
+        decoded.rotationOnArm = libmyo_event_get_rotation_on_arm(event);
+        decoded.warmupState = libmyo_event_get_warmup_state(event);
+        break;
+    case libmyo_event_orientation:
+        if (mask & Hub::eventMaskOrientation) {
+            decoded.orientation[0] = libmyo_event_get_orientation(event, libmyo_orientation_x);
+            decoded.orientation[1] = libmyo_event_get_orientation(event, libmyo_orientation_y);
+            decoded.orientation[2] = libmyo_event_get_orientation(event, libmyo_orientation_z);
+            decoded.orientation[3] = libmyo_event_get_orientation(event, libmyo_orientation_w);
+        }
+        for (unsigned int i = 0; i < 3; ++i) {
+            if (mask & Hub::eventMaskAccelerometer) {
+                decoded.accelerometer[i] = libmyo_event_get_accelerometer(event, i);
+            }
+            if (mask & Hub::eventMaskGyroscope) {
+                decoded.gyroscope[i] = libmyo_event_get_gyroscope(event, i);
+            }
+        }
+        break;
+    case libmyo_event_pose:
+        decoded.pose = libmyo_event_get_pose(event);
+        break;
+    case libmyo_event_rssi:
+        decoded.rssi = libmyo_event_get_rssi(event);
+        break;
+    case libmyo_event_battery_level:
+        decoded.batteryLevel = libmyo_event_get_battery_level(event);
+        break;
+    case libmyo_event_emg:
+        for (unsigned int i = 0; i < 8; ++i) {
+            decoded.emg[i] = libmyo_event_get_emg(event, i);
+        }
+        break;
+    case libmyo_event_warmup_completed:
+        decoded.warmupResult = libmyo_event_get_warmup_result(event);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace detail
+// --------------- end ----------------
+
 inline
 Hub::Hub(const std::string& applicationIdentifier)
 : _hub(0)
 , _myos()
 , _listeners()
+, _myoIndex()
+, _lastMyo(0)
+, _eventMask(eventMaskAll)
 {
     libmyo_init_hub(&_hub, applicationIdentifier.c_str(), ThrowOnError());
 }
@@ -94,9 +182,25 @@ void Hub::setLockingPolicy(LockingPolicy lockingPolicy)
     libmyo_set_locking_policy(_hub, static_cast<libmyo_locking_policy_t>(lockingPolicy), ThrowOnError());
 }
 
+inline
+void Hub::setEventMask(unsigned int mask)
+{
+    _eventMask = mask;
+}
+
 inline
 void Hub::onDeviceEvent(libmyo_event_t event)
 {
+    // @CHANGED
+    // Disabled data streams are dropped before any decoding
+    uint32_t type = libmyo_event_get_type(event);
+    if ((type == libmyo_event_orientation
+         && !(_eventMask & (eventMaskOrientation | eventMaskAccelerometer | eventMaskGyroscope)))
+        || (type == libmyo_event_pose && !(_eventMask & eventMaskPose))
+        || (type == libmyo_event_emg && !(_eventMask & eventMaskEmg))) {
+        return;
+    }
+
     libmyo_myo_t opaqueMyo = libmyo_event_get_myo(event);
 
     Myo* myo = lookupMyo(opaqueMyo);
@@ -120,42 +224,34 @@ void Hub::onDeviceEvent(libmyo_event_t event)
         return;
     }
 
+    detail::DecodedEvent decoded;
+    detail::decodeEvent(event, decoded, _eventMask);
+    uint64_t time = decoded.timestamp;
+
     for (std::vector<DeviceListener*>::iterator I = _listeners.begin(), IE = _listeners.end(); I != IE; ++I) {
         DeviceListener* listener = *I;
 
         listener->onOpaqueEvent(event);
 
-        uint64_t time = libmyo_event_get_timestamp(event);
-
-        switch (libmyo_event_get_type(event)) {
-        case libmyo_event_paired: {
-            FirmwareVersion version = {libmyo_event_get_firmware_version(event, libmyo_version_major),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_minor),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_patch),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev)};
-            listener->onPair(myo, time, version);
+        switch (decoded.type) {
+        case libmyo_event_paired:
+            listener->onPair(myo, time, decoded.firmwareVersion);
             break;
-        }
         case libmyo_event_unpaired:
             listener->onUnpair(myo, time);
             break;
-        case libmyo_event_connected: {
-            FirmwareVersion version = {libmyo_event_get_firmware_version(event, libmyo_version_major),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_minor),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_patch),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev)};
-            listener->onConnect(myo, time, version);
+        case libmyo_event_connected:
+            listener->onConnect(myo, time, decoded.firmwareVersion);
             break;
-        }
         case libmyo_event_disconnected:
             listener->onDisconnect(myo, time);
             break;
         case libmyo_event_arm_synced:
             listener->onArmSync(myo, time,
-                                static_cast<Arm>(libmyo_event_get_arm(event)),
-                                static_cast<XDirection>(libmyo_event_get_x_direction(event)),
-                                libmyo_event_get_rotation_on_arm(event),
-                                static_cast<WarmupState>(libmyo_event_get_warmup_state(event)));
+                                static_cast<Arm>(decoded.arm),
+                                static_cast<XDirection>(decoded.xDirection),
+                                decoded.rotationOnArm,
+                                static_cast<WarmupState>(decoded.warmupState));
             break;
         case libmyo_event_arm_unsynced:
             listener->onArmUnsync(myo, time);
@@ -167,45 +263,40 @@ void Hub::onDeviceEvent(libmyo_event_t event)
             listener->onLock(myo, time);
             break;
         case libmyo_event_orientation:
-            listener->onOrientationData(myo, time,
-                                        Quaternion<float>(libmyo_event_get_orientation(event, libmyo_orientation_x),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_y),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_z),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_w)));
-            listener->onAccelerometerData(myo, time,
-                                          Vector3<float>(libmyo_event_get_accelerometer(event, 0),
-                                                         libmyo_event_get_accelerometer(event, 1),
-                                                         libmyo_event_get_accelerometer(event, 2)));
-
-            listener->onGyroscopeData(myo, time,
-                                      Vector3<float>(libmyo_event_get_gyroscope(event, 0),
-                                                     libmyo_event_get_gyroscope(event, 1),
-                                                     libmyo_event_get_gyroscope(event, 2)));
-
+            if (_eventMask & eventMaskOrientation) {
+                listener->onOrientationData(myo, time,
+                                            Quaternion<float>(decoded.orientation[0],
+                                                              decoded.orientation[1],
+                                                              decoded.orientation[2],
+                                                              decoded.orientation[3]));
+            }
+            if (_eventMask & eventMaskAccelerometer) {
+                listener->onAccelerometerData(myo, time,
+                                              Vector3<float>(decoded.accelerometer[0],
+                                                             decoded.accelerometer[1],
+                                                             decoded.accelerometer[2]));
+            }
+            if (_eventMask & eventMaskGyroscope) {
+                listener->onGyroscopeData(myo, time,
+                                          Vector3<float>(decoded.gyroscope[0],
+                                                         decoded.gyroscope[1],
+                                                         decoded.gyroscope[2]));
+            }
             break;
         case libmyo_event_pose:
-            listener->onPose(myo, time, Pose(static_cast<Pose::Type>(libmyo_event_get_pose(event))));
+            listener->onPose(myo, time, Pose(static_cast<Pose::Type>(decoded.pose)));
             break;
         case libmyo_event_rssi:
-            listener->onRssi(myo, time, libmyo_event_get_rssi(event));
+            listener->onRssi(myo, time, decoded.rssi);
             break;
         case libmyo_event_battery_level:
-            listener->onBatteryLevelReceived(myo, time, libmyo_event_get_battery_level(event));
+            listener->onBatteryLevelReceived(myo, time, decoded.batteryLevel);
             break;
-        case libmyo_event_emg: {
-            int8_t emg[] = { libmyo_event_get_emg(event, 0),
-                             libmyo_event_get_emg(event, 1),
-                             libmyo_event_get_emg(event, 2),
-                             libmyo_event_get_emg(event, 3),
-                             libmyo_event_get_emg(event, 4),
-                             libmyo_event_get_emg(event, 5),
-                             libmyo_event_get_emg(event, 6),
-                             libmyo_event_get_emg(event, 7) };
-            listener->onEmgData(myo, time, emg);
+        case libmyo_event_emg:
+            listener->onEmgData(myo, time, decoded.emg);
             break;
-        }
         case libmyo_event_warmup_completed: {
-            listener->onWarmupCompleted(myo, time, static_cast<WarmupResult>(libmyo_event_get_warmup_result(event)));
+            listener->onWarmupCompleted(myo, time, static_cast<WarmupResult>(decoded.warmupResult));
             break;
         }
         }
@@ -242,6 +333,32 @@ void Hub::runOnce(unsigned int duration_ms)
     libmyo_run(_hub, duration_ms, &local::handler, this, ThrowOnError());
 }
 
+// @CHANGED
+// Interruptible event loop
+// --------------- begin ----------------
+inline
+void Hub::run(unsigned int duration_ms, const std::atomic<int>& interrupt)
+{
+    struct local {
+        Hub* hub;
+        const std::atomic<int>* interrupt;
+
+        static libmyo_handler_result_t handler(void* user_data, libmyo_event_t event) {
+            local* self = static_cast<local*>(user_data);
+
+            self->hub->onDeviceEvent(event);
+
+            return self->interrupt->load() ? libmyo_handler_stop : libmyo_handler_continue;
+        }
+    };
+    if (interrupt.load()) {
+        return;
+    }
+    local context = {this, &interrupt};
+    libmyo_run(_hub, duration_ms, &local::handler, &context, ThrowOnError());
+}
+// --------------- end ----------------
+
 inline
 libmyo_hub_t Hub::libmyoObject()
 {
@@ -251,15 +368,19 @@ libmyo_hub_t Hub::libmyoObject()
 inline
 Myo* Hub::lookupMyo(libmyo_myo_t opaqueMyo) const
 {
-    Myo* myo = 0;
-    for (std::vector<Myo*>::const_iterator I = _myos.begin(), IE = _myos.end(); I != IE; ++I) {
-        if ((*I)->libmyoObject() == opaqueMyo) {
-            myo = *I;
-            break;
-        }
+    // @CHANGED
+    // Hashed lookup instead of a linear scan of _myos
+    if (_lastMyo && _lastMyo->libmyoObject() == opaqueMyo) {
+        return _lastMyo;
     }
 
-    return myo;
+    std::unordered_map<libmyo_myo_t, Myo*>::const_iterator I = _myoIndex.find(opaqueMyo);
+    if (I == _myoIndex.end()) {
+        return 0;
+    }
+
+    _lastMyo = I->second;
+    return _lastMyo;
 }
 
 inline
@@ -268,6 +389,7 @@ Myo* Hub::addMyo(libmyo_myo_t opaqueMyo)
     Myo* myo = new Myo(opaqueMyo);
 
     _myos.push_back(myo);
+    _myoIndex[opaqueMyo] = myo;
 
     return myo;
 }
@@ -0,0 +1,163 @@
+/**
+ *
+ * @file envelope.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Bayesian estimation of the EMG envelope (muscle force)
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_ENVELOPE_HPP
+#define MAXMYO_ENVELOPE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Bayesian filter of the envelope of the 8 EMG channels (T. D. Sanger,
+ * "Bayesian filtering of myoelectric signals", J Neurophysiol 2007), as the
+ * bayesfilter of PiPo. The envelope of each channel is a distribution over a
+ * fixed grid of kLevels amplitudes. For each sample, the distribution
+ * diffuses to the neighbouring amplitudes (diffusion rate), may jump to any
+ * amplitude (jump rate), and is multiplied by the likelihood of the
+ * rectified sample under a Laplacian model. The estimate is the amplitude of
+ * maximum probability.
+ *
+ * Raw samples are 8-bit, so the likelihood of every rectified sample for
+ * every amplitude of the grid is precomputed in a table shared by all
+ * filters: the update of a channel is a few loops over kLevels floats, which
+ * compilers vectorize. The grid spans the full scale of the raw samples, and
+ * estimates are normalized to [0, 1] (full scale); MVC normalization is left
+ * to the caller.
+ */
+class EmgEnvelope {
+  public:
+    static const int kChannels = 8;
+    static const int kLevels = 128;
+
+    explicit EmgEnvelope(float diffusion = 0.1f, float jump_rate = 1e-10f)
+        : posterior_(kChannels * kLevels) {
+        setRates(diffusion, jump_rate);
+        reset();
+    }
+
+    /// Sets the diffusion rate (in [0, 0.5]) and the jump rate (in [0, 1])
+    void setRates(float diffusion, float jump_rate) {
+        diffusion_ = diffusion < 0.f ? 0.f : (diffusion > 0.5f ? 0.5f
+                                                               : diffusion);
+        jump_rate_ = jump_rate < 0.f ? 0.f : (jump_rate > 1.f ? 1.f
+                                                              : jump_rate);
+    }
+
+    float diffusion() const { return diffusion_; }
+    float jumpRate() const { return jump_rate_; }
+
+    /// Resets the distributions of all channels to uniform
+    void reset() {
+        for (std::size_t i = 0; i < posterior_.size(); i++)
+            posterior_[i] = 1.f / kLevels;
+    }
+
+    /// Updates the envelopes with a raw sample of the 8 channels, and writes
+    /// the estimates (in [0, 1]) to envelope
+    void update(int8_t const *sample, float *envelope) {
+        float const *table = likelihoodTable();
+        float const a = diffusion_;
+        float const b = jump_rate_;
+        float prior[kLevels];
+        for (int c = 0; c < kChannels; c++) {
+            float *p = &posterior_[c * kLevels];
+            float const *likelihood = table + std::abs(sample[c]) * kLevels;
+
+            // diffusion (reflecting bounds) and jumps
+            int last = kLevels - 1;
+            prior[0] = (1.f - a) * p[0] + a * p[1];
+            for (int k = 1; k < last; k++)
+                prior[k] =
+                    a * p[k - 1] + (1.f - 2.f * a) * p[k] + a * p[k + 1];
+            prior[last] = a * p[last - 1] + (1.f - a) * p[last];
+
+            // observation (in the local array, which does not alias the
+            // table, so that the loops are vectorized)
+            for (int k = 0; k < kLevels; k++)
+                prior[k] = (b + (1.f - b) * prior[k]) * likelihood[k];
+            float sum = reduce(prior, Sum);
+            // a sample far out of the distribution: start over
+            if (!(sum > 1e-30f)) {
+                for (int k = 0; k < kLevels; k++) prior[k] = likelihood[k];
+                sum = reduce(prior, Sum);
+            }
+            float norm = 1.f / sum;
+            for (int k = 0; k < kLevels; k++) p[k] = prior[k] * norm;
+
+            // maximum a posteriori
+            float max = reduce(p, Max);
+            int map = 0;
+            while (p[map] < max) map++;
+            envelope[c] = level(map);
+        }
+    }
+
+    /// Amplitude of a level of the grid, in [0, 1]
+    static float level(int k) { return (k + 1.f) / kLevels; }
+
+  private:
+    enum Reduction { Sum, Max };
+
+    /// Sum or maximum of kLevels values, computed in 8 independent lanes so
+    /// that the loop is vectorized without reordering float operations
+    static float reduce(float const *values, Reduction reduction) {
+        float lanes[8];
+        for (int j = 0; j < 8; j++) lanes[j] = values[j];
+        for (int k = 8; k < kLevels; k += 8) {
+            for (int j = 0; j < 8; j++) {
+                if (reduction == Sum)
+                    lanes[j] += values[k + j];
+                else
+                    lanes[j] = values[k + j] > lanes[j] ? values[k + j]
+                                                        : lanes[j];
+            }
+        }
+        float result = lanes[0];
+        for (int j = 1; j < 8; j++) {
+            if (reduction == Sum)
+                result += lanes[j];
+            else if (lanes[j] > result)
+                result = lanes[j];
+        }
+        return result;
+    }
+
+    /// Likelihood of each rectified sample (0 to 128) for each level:
+    /// exp(-|x| / a) / a, for an amplitude a in raw units
+    static float const *likelihoodTable() {
+        static std::vector<float> const table = makeTable();
+        return &table[0];
+    }
+
+    static std::vector<float> makeTable() {
+        std::vector<float> table(129 * kLevels);
+        for (int x = 0; x <= 128; x++) {
+            for (int k = 0; k < kLevels; k++) {
+                double amplitude = 128. * level(k);
+                table[x * kLevels + k] = static_cast<float>(
+                    std::exp(-x / amplitude) / amplitude);
+            }
+        }
+        return table;
+    }
+
+    float diffusion_;
+    float jump_rate_;
+    std::vector<float> posterior_;  // kLevels values for each channel
+};
+
+#endif
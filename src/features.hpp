@@ -0,0 +1,170 @@
+/**
+ *
+ * @file features.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Sliding-window EMG features, updated incrementally for 8 channels
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_FEATURES_HPP
+#define MAXMYO_FEATURES_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Time-domain features of the 8 EMG channels over a sliding window of raw
+ * samples, output every hop samples:
+ * - root mean square and mean absolute value (normalized to [0, 1])
+ * - waveform length: sum of the absolute differences of consecutive samples
+ *   (normalized by 127)
+ * - zero crossings: number of sign changes of consecutive samples
+ * - slope sign changes: number of local extrema
+ *
+ * Each sample contributes integer terms to the sums of the window (e.g. its
+ * square, or its absolute difference with the previous sample). The terms
+ * of every sample of the window are kept, so that adding a sample adds its
+ * terms and subtracts the terms of the samples that leave the window: the
+ * cost does not depend on the window size, and integer sums do not drift.
+ * All channels are updated together by loops over fixed-size arrays of 8
+ * lanes, which compilers vectorize (SSE/AVX, NEON).
+ */
+class EmgFeatures {
+  public:
+    enum Feature {
+        Rms,
+        Mav,
+        WaveformLength,
+        ZeroCrossings,
+        SlopeSignChanges,
+        NumFeatures
+    };
+
+    static const int kChannels = 8;
+    static const int kSize = NumFeatures * kChannels;
+
+    /// Window and hop in samples (the window has at least 3 samples)
+    explicit EmgFeatures(int window = 40, int hop = 10) {
+        configure(window, hop);
+    }
+
+    void configure(int window, int hop) {
+        window_ = window < 3 ? 3 : window;
+        hop_ = hop < 1 ? 1 : hop;
+        terms_.assign(window_, Terms());
+        reset();
+    }
+
+    /// Clears the window
+    void reset() {
+        for (int i = 0; i < window_; i++)
+            for (int j = 0; j < kSize; j++) terms_[i].values[j] = 0;
+        for (int j = 0; j < kSize; j++) sums_.values[j] = 0;
+        for (int c = 0; c < kChannels; c++) x1_[c] = x2_[c] = 0;
+        samples_ = 0;
+        index_ = 0;
+        countdown_ = hop_;
+    }
+
+    int window() const { return window_; }
+    int hop() const { return hop_; }
+
+    /// Adds a sample of the 8 channels, returns true at the end of each hop
+    /// once the window is full
+    bool push(int8_t const *sample) {
+        int32_t x[kChannels];
+        for (int c = 0; c < kChannels; c++) x[c] = sample[c];
+
+        // terms of the new sample (pair terms need a previous sample, and
+        // slope sign changes two)
+        int32_t pair = samples_ >= 1;
+        int32_t triple = samples_ >= 2;
+        int32_t terms[kSize];
+        for (int c = 0; c < kChannels; c++) {
+            int32_t d = x[c] - x1_[c];
+            terms[Rms * kChannels + c] = x[c] * x[c];
+            terms[Mav * kChannels + c] = std::abs(x[c]);
+            terms[WaveformLength * kChannels + c] = pair * std::abs(d);
+            terms[ZeroCrossings * kChannels + c] = pair * (x[c] * x1_[c] < 0);
+            terms[SlopeSignChanges * kChannels + c] =
+                triple * ((x1_[c] - x2_[c]) * -d > 0);
+        }
+
+        // the slot of the new sample holds the terms of the sample leaving
+        // the window, the pair (resp. triple) terms leave with the next
+        // sample (resp. the one after): they are subtracted and cleared so
+        // that they are not subtracted twice
+        // (each loop writes a single array, so that it is vectorized)
+        int32_t *slot = terms_[index_].values;
+        int32_t *next = terms_[wrap(index_ + 1)].values;
+        int32_t *after = terms_[wrap(index_ + 2)].values;
+        const int pairs = WaveformLength * kChannels;
+        const int triples = SlopeSignChanges * kChannels;
+        int32_t delta[kSize];
+        for (int j = 0; j < pairs; j++) delta[j] = terms[j] - slot[j];
+        for (int j = pairs; j < triples; j++) delta[j] = terms[j] - next[j];
+        for (int j = triples; j < kSize; j++) delta[j] = terms[j] - after[j];
+        for (int j = 0; j < kSize; j++) sums_.values[j] += delta[j];
+        for (int j = 0; j < kSize; j++) slot[j] = terms[j];
+        for (int j = pairs; j < triples; j++) next[j] = 0;
+        for (int j = triples; j < kSize; j++) after[j] = 0;
+        for (int c = 0; c < kChannels; c++) {
+            x2_[c] = x1_[c];
+            x1_[c] = x[c];
+        }
+
+        index_ = wrap(index_ + 1);
+        if (samples_ < window_) samples_++;
+        if (--countdown_ > 0) return false;
+        countdown_ = hop_;
+        return samples_ == window_;
+    }
+
+    /// Features of the current window: kSize values, the 8 channels of each
+    /// feature in turn (see Feature)
+    void compute(float *features) const {
+        float n = static_cast<float>(window_);
+        int32_t const *s = sums_.values;
+        for (int c = 0; c < kChannels; c++) {
+            features[Rms * kChannels + c] =
+                std::sqrt(s[Rms * kChannels + c] / n) / 127.f;
+            features[Mav * kChannels + c] = s[Mav * kChannels + c] / n / 127.f;
+            features[WaveformLength * kChannels + c] =
+                s[WaveformLength * kChannels + c] / 127.f;
+            features[ZeroCrossings * kChannels + c] =
+                static_cast<float>(s[ZeroCrossings * kChannels + c]);
+            features[SlopeSignChanges * kChannels + c] =
+                static_cast<float>(s[SlopeSignChanges * kChannels + c]);
+        }
+    }
+
+  private:
+    struct Terms {
+        int32_t values[kSize];
+    };
+
+    int wrap(int index) const {
+        return index >= window_ ? index - window_ : index;
+    }
+
+    int window_;
+    int hop_;
+    std::vector<Terms> terms_;  // terms of the samples of the window
+    Terms sums_;                // sums of the terms over the window
+    int32_t x1_[kChannels];     // previous sample
+    int32_t x2_[kChannels];     // sample before the previous one
+    int samples_;               // samples in the window
+    int index_;                 // slot of the next sample
+    int countdown_;             // samples until the end of the hop
+};
+
+#endif
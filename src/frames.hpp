@@ -0,0 +1,100 @@
+/**
+ *
+ * @file frames.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Timestamped sensor frames exchanged between the hub thread and Max
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_FRAMES_HPP
+#define MAXMYO_FRAMES_HPP
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Frame of N sensor values with the hardware timestamp (in microseconds) at
+ * which the Myo produced it, and the index of the device that produced it.
+ */
+template <typename T, std::size_t N>
+struct TimedFrame {
+    uint64_t timestamp;
+    uint8_t device;
+    std::array<T, N> values;
+};
+
+/// Raw EMG frame (8 electrodes, signed 8-bit)
+typedef TimedFrame<int8_t, 8> EmgFrame;
+
+/// Accelerometer (g) or gyroscope (deg/s) frame
+typedef TimedFrame<float, 3> Vector3Frame;
+
+/// Orientation frame (x, y, z, w)
+typedef TimedFrame<float, 4> QuaternionFrame;
+
+/// EMG frame with the IMU values aligned on its timestamp: EMG (8, in
+/// [-1, 1], or envelope), acceleration (3), gyroscope (3) and orientation (4)
+typedef TimedFrame<float, 18> FusedFrame;
+
+/// EMG envelope of the 8 channels, relative to the MVC (see EmgEnvelope)
+typedef TimedFrame<float, 8> EnvelopeFrame;
+
+/// EMG features of a window (see EmgFeatures): 5 features of 8 channels
+typedef TimedFrame<float, 40> EmgFeatureFrame;
+
+/// Result of the classification of a frame (see GmmClassifier): likeliest
+/// class and normalized likelihoods of the classes
+struct ClassFrame {
+    uint64_t timestamp;
+    uint8_t device;
+    uint8_t classes;
+    uint8_t likeliest;
+    std::array<float, 16> likelihoods;
+};
+
+/// Result of the following of a frame (see HmmFollower): likeliest class,
+/// normalized likelihoods and time progression (in [0, 1]) of the classes
+struct FollowFrame {
+    uint64_t timestamp;
+    uint8_t device;
+    uint8_t classes;
+    uint8_t likeliest;
+    std::array<float, 16> likelihoods;
+    std::array<float, 16> progressions;
+};
+
+/// Output parameters regressed from a fused frame (see GmrRegressor)
+struct RegressionFrame {
+    uint64_t timestamp;
+    uint8_t device;
+    uint8_t outputs;
+    std::array<float, 32> values;
+};
+
+/**
+ * Non-sensor event (connection, arm synchronization, pose, RSSI, battery)
+ * forwarded from the hub thread to Max.
+ */
+struct InfoEvent {
+    enum Type { Connect, Disconnect, ArmSync, ArmUnsync, Rssi, Battery, Pose };
+
+    Type type;
+    uint64_t timestamp;
+    uint8_t device;
+
+    /// Pose type, RSSI or battery level in values[0]. For arm
+    /// synchronization: arm, x direction and warmup state.
+    int values[3];
+
+    /// Rotation of the armband on the arm (arm synchronization only)
+    float rotation;
+};
+
+#endif
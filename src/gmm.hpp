@@ -0,0 +1,320 @@
+/**
+ *
+ * @file gmm.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Gaussian mixture classifier of EMG frames, with a sliding window
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_GMM_HPP
+#define MAXMYO_GMM_HPP
+
+#include "trainingset.hpp"
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+/// log(2 pi), for the normalization of Gaussian densities
+const double kGmmLog2Pi = 1.8378770664093453;
+
+/**
+ * Gaussian mixture model with diagonal covariances, trained by expectation
+ * maximization (in double precision: training runs on a background thread).
+ * Components start at the means of consecutive segments of the frames
+ * (recordings are time series: segments capture the phases of a gesture),
+ * with the global variance. Variances are regularized by a fraction of the
+ * global variance plus a floor, so that a component never collapses on a
+ * few frames.
+ */
+struct GaussianMixture {
+    int dimension;
+    int components;
+    std::vector<double> weights;    // components
+    std::vector<double> means;      // components x dimension
+    std::vector<double> variances;  // components x dimension
+
+    /// Trains the model on frames (frames x dimension values); stops after
+    /// the given number of iterations, when the log-likelihood converges, or
+    /// when cancel becomes true. Returns false if there are no frames.
+    bool train(float const *data, std::size_t frames, int frame_size,
+               int max_components, int iterations = 100,
+               std::atomic<bool> const *cancel = 0,
+               double relative_regularization = 1e-2,
+               double absolute_regularization = 1e-3) {
+        if (!frames || frame_size < 1 || max_components < 1) return false;
+        dimension = frame_size;
+        components = max_components > static_cast<int>(frames)
+                         ? static_cast<int>(frames)
+                         : max_components;
+        const int D = dimension;
+        const int K = components;
+
+        // global statistics, and regularization of the variances
+        std::vector<double> mean(D, 0.), variance(D, 0.), regularization(D);
+        for (std::size_t n = 0; n < frames; n++)
+            for (int d = 0; d < D; d++) mean[d] += data[n * D + d];
+        for (int d = 0; d < D; d++) mean[d] /= frames;
+        for (std::size_t n = 0; n < frames; n++)
+            for (int d = 0; d < D; d++) {
+                double x = data[n * D + d] - mean[d];
+                variance[d] += x * x;
+            }
+        for (int d = 0; d < D; d++) {
+            variance[d] /= frames;
+            regularization[d] = relative_regularization * variance[d] +
+                                absolute_regularization;
+        }
+
+        // initialization on consecutive segments
+        weights.assign(K, 1. / K);
+        means.assign(K * D, 0.);
+        variances.assign(K * D, 0.);
+        for (int k = 0; k < K; k++) {
+            std::size_t begin = frames * k / K;
+            std::size_t end = frames * (k + 1) / K;
+            for (std::size_t n = begin; n < end; n++)
+                for (int d = 0; d < D; d++)
+                    means[k * D + d] += data[n * D + d];
+            for (int d = 0; d < D; d++) {
+                means[k * D + d] /= (end - begin);
+                variances[k * D + d] = variance[d] + regularization[d];
+            }
+        }
+
+        std::vector<double> responsibilities(frames * K);
+        double previous = -std::numeric_limits<double>::infinity();
+        for (int it = 0; it < iterations; it++) {
+            if (cancel && cancel->load()) return false;
+
+            // expectation
+            double loglikelihood = 0.;
+            for (std::size_t n = 0; n < frames; n++) {
+                double *r = &responsibilities[n * K];
+                double max = -std::numeric_limits<double>::infinity();
+                for (int k = 0; k < K; k++) {
+                    r[k] = std::log(weights[k]) +
+                           logDensity(&data[n * D], k);
+                    if (r[k] > max) max = r[k];
+                }
+                double sum = 0.;
+                for (int k = 0; k < K; k++) sum += std::exp(r[k] - max);
+                for (int k = 0; k < K; k++) r[k] = std::exp(r[k] - max) / sum;
+                loglikelihood += max + std::log(sum);
+            }
+
+            // maximization
+            for (int k = 0; k < K; k++) {
+                double total = 0.;
+                for (std::size_t n = 0; n < frames; n++)
+                    total += responsibilities[n * K + k];
+                weights[k] = (total + 1e-10) / (frames + K * 1e-10);
+                if (total < 1e-10) continue;  // keeps an empty component
+                for (int d = 0; d < D; d++) {
+                    double m = 0.;
+                    for (std::size_t n = 0; n < frames; n++)
+                        m += responsibilities[n * K + k] * data[n * D + d];
+                    m /= total;
+                    double v = 0.;
+                    for (std::size_t n = 0; n < frames; n++) {
+                        double x = data[n * D + d] - m;
+                        v += responsibilities[n * K + k] * x * x;
+                    }
+                    means[k * D + d] = m;
+                    variances[k * D + d] = v / total + regularization[d];
+                }
+            }
+
+            if (std::fabs(loglikelihood - previous) <
+                1e-5 * std::fabs(loglikelihood))
+                break;
+            previous = loglikelihood;
+        }
+        return true;
+    }
+
+    /// Log-density of a frame for a component
+    double logDensity(float const *x, int k) const {
+        double sum = 0.;
+        for (int d = 0; d < dimension; d++) {
+            double v = variances[k * dimension + d];
+            double diff = x[d] - means[k * dimension + d];
+            sum += kGmmLog2Pi + std::log(v) + diff * diff / v;
+        }
+        return -0.5 * sum;
+    }
+};
+
+/**
+ * Classifier with a Gaussian mixture per class. The components of all
+ * classes are evaluated together: their parameters are stored by dimension
+ * (the components of a dimension are contiguous), so that the loop over the
+ * components is vectorized, and the log-likelihood of a class is the
+ * log-sum-exp of the log-densities of its components.
+ */
+class GmmClassifier {
+  public:
+    static const int kMaxClasses = 16;
+    static const int kMaxComponents = 16;
+
+    GmmClassifier() : dimension_(0), components_(0) {}
+
+    /// Trains a mixture of the given number of components for each class
+    /// of the training set (on the calling thread). Returns an empty
+    /// string, or the reason why the model could not be trained.
+    std::string train(TrainingSet const &set, int components,
+                      std::atomic<bool> const *cancel = 0) {
+        if (set.labels.empty() || set.dimension < 1)
+            return "no training data";
+        if (set.labels.size() > static_cast<std::size_t>(kMaxClasses))
+            return "too many classes";
+        components = components < 1 ? 1 : (components > kMaxComponents
+                                               ? kMaxComponents
+                                               : components);
+        std::vector<GaussianMixture> mixtures(set.labels.size());
+        for (std::size_t c = 0; c < mixtures.size(); c++) {
+            std::size_t frames = set.data[c].size() / set.dimension;
+            if (!frames) return "no frames for " + set.labels[c];
+            if (!mixtures[c].train(&set.data[c][0], frames, set.dimension,
+                                   components, 100, cancel))
+                return "cancelled";
+        }
+
+        labels_ = set.labels;
+        dimension_ = set.dimension;
+        components_ = 0;
+        offsets_.assign(1, 0);
+        for (std::size_t c = 0; c < mixtures.size(); c++) {
+            components_ += mixtures[c].components;
+            offsets_.push_back(components_);
+        }
+        const int M = components_;
+        means_.assign(dimension_ * M, 0.f);
+        precisions_.assign(dimension_ * M, 0.f);
+        constants_.assign(M, 0.f);
+        for (std::size_t c = 0; c < mixtures.size(); c++) {
+            GaussianMixture const &g = mixtures[c];
+            for (int k = 0; k < g.components; k++) {
+                int m = offsets_[c] + k;
+                double constant = std::log(g.weights[k]);
+                for (int d = 0; d < dimension_; d++) {
+                    double v = g.variances[k * dimension_ + d];
+                    means_[d * M + m] =
+                        static_cast<float>(g.means[k * dimension_ + d]);
+                    precisions_[d * M + m] = static_cast<float>(1. / v);
+                    constant -= 0.5 * (kGmmLog2Pi + std::log(v));
+                }
+                constants_[m] = static_cast<float>(constant);
+            }
+        }
+        return std::string();
+    }
+
+    int dimension() const { return dimension_; }
+    int classes() const { return static_cast<int>(labels_.size()); }
+    std::string const &label(int c) const { return labels_[c]; }
+
+    /// Log-likelihood of a frame (dimension values) for each class
+    void logLikelihoods(float const *x, float *loglikelihoods) const {
+        const int M = components_;
+        float acc[kMaxClasses * kMaxComponents];
+        for (int m = 0; m < M; m++) acc[m] = 0.f;
+        for (int d = 0; d < dimension_; d++) {
+            float const *mean = &means_[d * M];
+            float const *precision = &precisions_[d * M];
+            float xd = x[d];
+            for (int m = 0; m < M; m++) {
+                float diff = xd - mean[m];
+                acc[m] += diff * diff * precision[m];
+            }
+        }
+        for (int m = 0; m < M; m++) acc[m] = constants_[m] - 0.5f * acc[m];
+
+        for (int c = 0; c < classes(); c++) {
+            float max = acc[offsets_[c]];
+            for (int m = offsets_[c] + 1; m < offsets_[c + 1]; m++)
+                if (acc[m] > max) max = acc[m];
+            float sum = 0.f;
+            for (int m = offsets_[c]; m < offsets_[c + 1]; m++)
+                sum += std::exp(acc[m] - max);
+            loglikelihoods[c] = max + std::log(sum);
+        }
+    }
+
+  private:
+    int dimension_;
+    int components_;                  // components of all classes
+    std::vector<std::string> labels_;
+    std::vector<int> offsets_;        // first component of each class
+    std::vector<float> means_;        // dimension x components
+    std::vector<float> precisions_;   // dimension x components
+    std::vector<float> constants_;    // log(weight) - log(normalization)
+};
+
+/**
+ * Sliding window of the log-likelihoods of the classes: the classes are
+ * compared on the mean log-likelihood of the last frames (the product of
+ * their likelihoods), which smooths the decision over the window.
+ */
+class LikelihoodWindow {
+  public:
+    LikelihoodWindow() { configure(0, 1); }
+
+    void configure(int classes, int window) {
+        classes_ = classes;
+        window_ = window < 1 ? 1 : window;
+        values_.assign(classes_ * window_, 0.f);
+        sums_.assign(classes_, 0.);
+        size_ = 0;
+        index_ = 0;
+    }
+
+    void reset() { configure(classes_, window_); }
+
+    int classes() const { return classes_; }
+    int window() const { return window_; }
+
+    /// Adds the log-likelihoods of a frame, writes the normalized
+    /// likelihoods of the classes over the window, and returns the index of
+    /// the likeliest class
+    int push(float const *loglikelihoods, float *likelihoods) {
+        float *slot = &values_[index_ * classes_];
+        for (int c = 0; c < classes_; c++) {
+            sums_[c] += loglikelihoods[c] - slot[c];
+            slot[c] = loglikelihoods[c];
+        }
+        index_ = index_ + 1 == window_ ? 0 : index_ + 1;
+        if (size_ < window_) size_++;
+
+        int likeliest = 0;
+        for (int c = 1; c < classes_; c++)
+            if (sums_[c] > sums_[likeliest]) likeliest = c;
+        double total = 0.;
+        for (int c = 0; c < classes_; c++) {
+            double p = std::exp((sums_[c] - sums_[likeliest]) / size_);
+            likelihoods[c] = static_cast<float>(p);
+            total += p;
+        }
+        for (int c = 0; c < classes_; c++)
+            likelihoods[c] = static_cast<float>(likelihoods[c] / total);
+        return likeliest;
+    }
+
+  private:
+    int classes_;
+    int window_;
+    std::vector<float> values_;  // window x classes log-likelihoods
+    std::vector<double> sums_;   // sums over the window
+    int size_;                   // frames in the window
+    int index_;                  // slot of the next frame
+};
+
+#endif
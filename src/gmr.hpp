@@ -0,0 +1,315 @@
+/**
+ *
+ * @file gmr.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Gaussian mixture regression from sensor frames to parameters
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_GMR_HPP
+#define MAXMYO_GMR_HPP
+
+#include "gmm.hpp"
+#include "trainingset.hpp"
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * Cholesky factorization of a symmetric positive definite matrix (n x n,
+ * row-major) in place: the lower triangle becomes L, with A = L L^T (the
+ * upper triangle is cleared). Returns false if the matrix is not positive
+ * definite.
+ */
+inline bool cholesky(double *a, int n) {
+    for (int j = 0; j < n; j++) {
+        double d = a[j * n + j];
+        for (int k = 0; k < j; k++) d -= a[j * n + k] * a[j * n + k];
+        if (!(d > 0.)) return false;
+        d = std::sqrt(d);
+        a[j * n + j] = d;
+        for (int i = j + 1; i < n; i++) {
+            double s = a[i * n + j];
+            for (int k = 0; k < j; k++) s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / d;
+        }
+        for (int i = 0; i < j; i++) a[i * n + j] = 0.;
+    }
+    return true;
+}
+
+/// Solves L v = b in place (L lower triangular, n x n, row-major)
+template <typename T>
+void forwardSubstitution(T const *l, int n, T *b) {
+    for (int i = 0; i < n; i++) {
+        T s = b[i];
+        for (int k = 0; k < i; k++) s -= l[i * n + k] * b[k];
+        b[i] = s / l[i * n + i];
+    }
+}
+
+/// Solves L^T v = b in place (L lower triangular, n x n, row-major)
+inline void backSubstitution(double const *l, int n, double *b) {
+    for (int i = n - 1; i >= 0; i--) {
+        double s = b[i];
+        for (int k = i + 1; k < n; k++) s -= l[k * n + i] * b[k];
+        b[i] = s / l[i * n + i];
+    }
+}
+
+/**
+ * Gaussian mixture regression (GMR): a Gaussian mixture with full
+ * covariances is trained by expectation maximization on the joint frames
+ * [input, output], and the output of an input frame is the sum of the
+ * conditional expectations of the components, weighted by the likelihood
+ * of the input for each component.
+ *
+ * Everything that does not depend on the input is computed once after
+ * training: the Cholesky factor of the input covariance of each component
+ * (its log-likelihood is then a triangular solve) and its regression matrix
+ * (output-input covariance times the inverse input covariance), so that a
+ * frame costs a triangular solve and a matrix-vector product per component,
+ * without allocation.
+ */
+class GmrRegressor {
+  public:
+    static const int kMaxComponents = 16;
+    static const int kMaxInputs = 32;
+    static const int kMaxOutputs = 32;
+
+    GmrRegressor() : inputs_(0), outputs_(0), components_(0) {}
+
+    /// Trains the model on frames of inputs + outputs values (all the
+    /// frames of the training set, on the calling thread). Returns an empty
+    /// string, or the reason why the model could not be trained.
+    std::string train(TrainingSet const &set, int inputs, int components,
+                      std::atomic<bool> const *cancel = 0,
+                      int iterations = 100,
+                      double relative_regularization = 1e-2,
+                      double absolute_regularization = 1e-3) {
+        const int D = set.dimension;
+        const int I = inputs;
+        const int O = D - inputs;
+        if (I < 1 || I > kMaxInputs || O < 1 || O > kMaxOutputs)
+            return "invalid number of inputs or outputs";
+        std::vector<float> data;
+        for (std::size_t c = 0; c < set.data.size(); c++)
+            data.insert(data.end(), set.data[c].begin(), set.data[c].end());
+        std::size_t frames = data.size() / D;
+        if (!frames) return "no training data";
+        int K = components < 1 ? 1 : (components > kMaxComponents
+                                          ? kMaxComponents
+                                          : components);
+        if (K > static_cast<int>(frames)) K = static_cast<int>(frames);
+
+        // global statistics, and regularization of the variances
+        std::vector<double> mean(D, 0.), variance(D, 0.), regularization(D);
+        for (std::size_t n = 0; n < frames; n++)
+            for (int d = 0; d < D; d++) mean[d] += data[n * D + d];
+        for (int d = 0; d < D; d++) mean[d] /= frames;
+        for (std::size_t n = 0; n < frames; n++)
+            for (int d = 0; d < D; d++) {
+                double x = data[n * D + d] - mean[d];
+                variance[d] += x * x;
+            }
+        for (int d = 0; d < D; d++) {
+            variance[d] /= frames;
+            regularization[d] = relative_regularization * variance[d] +
+                                absolute_regularization;
+        }
+
+        // initialization on consecutive segments, with the global variance
+        std::vector<double> weights(K, 1. / K);
+        std::vector<double> means(K * D, 0.);
+        std::vector<double> covariances(K * D * D, 0.);
+        for (int k = 0; k < K; k++) {
+            std::size_t begin = frames * k / K;
+            std::size_t end = frames * (k + 1) / K;
+            for (std::size_t n = begin; n < end; n++)
+                for (int d = 0; d < D; d++)
+                    means[k * D + d] += data[n * D + d];
+            for (int d = 0; d < D; d++) {
+                means[k * D + d] /= (end - begin);
+                covariances[(k * D + d) * D + d] =
+                    variance[d] + regularization[d];
+            }
+        }
+
+        // expectation maximization
+        std::vector<double> responsibilities(frames * K);
+        std::vector<double> factor(D * D), z(D);
+        double previous = -std::numeric_limits<double>::infinity();
+        for (int it = 0; it < iterations; it++) {
+            if (cancel && cancel->load()) return "cancelled";
+
+            for (int k = 0; k < K; k++) {
+                factor.assign(&covariances[k * D * D],
+                              &covariances[k * D * D] + D * D);
+                if (!cholesky(&factor[0], D))
+                    return "singular covariance, record more frames";
+                double constant = std::log(weights[k]) - 0.5 * D * kGmmLog2Pi;
+                for (int d = 0; d < D; d++)
+                    constant -= std::log(factor[d * D + d]);
+                for (std::size_t n = 0; n < frames; n++) {
+                    for (int d = 0; d < D; d++)
+                        z[d] = data[n * D + d] - means[k * D + d];
+                    forwardSubstitution(&factor[0], D, &z[0]);
+                    double distance = 0.;
+                    for (int d = 0; d < D; d++) distance += z[d] * z[d];
+                    responsibilities[n * K + k] = constant - 0.5 * distance;
+                }
+            }
+            double loglikelihood = 0.;
+            for (std::size_t n = 0; n < frames; n++) {
+                double *r = &responsibilities[n * K];
+                double max = r[0];
+                for (int k = 1; k < K; k++)
+                    if (r[k] > max) max = r[k];
+                double sum = 0.;
+                for (int k = 0; k < K; k++) sum += std::exp(r[k] - max);
+                for (int k = 0; k < K; k++) r[k] = std::exp(r[k] - max) / sum;
+                loglikelihood += max + std::log(sum);
+            }
+
+            for (int k = 0; k < K; k++) {
+                double total = 0.;
+                for (std::size_t n = 0; n < frames; n++)
+                    total += responsibilities[n * K + k];
+                weights[k] = (total + 1e-10) / (frames + K * 1e-10);
+                if (total < 1e-10) continue;  // keeps an empty component
+                double *m = &means[k * D];
+                double *cov = &covariances[k * D * D];
+                for (int d = 0; d < D; d++) m[d] = 0.;
+                for (std::size_t n = 0; n < frames; n++)
+                    for (int d = 0; d < D; d++)
+                        m[d] += responsibilities[n * K + k] * data[n * D + d];
+                for (int d = 0; d < D; d++) m[d] /= total;
+                for (int i = 0; i < D * D; i++) cov[i] = 0.;
+                for (std::size_t n = 0; n < frames; n++) {
+                    double r = responsibilities[n * K + k];
+                    for (int d = 0; d < D; d++)
+                        z[d] = data[n * D + d] - m[d];
+                    for (int i = 0; i < D; i++)
+                        for (int j = 0; j <= i; j++)
+                            cov[i * D + j] += r * z[i] * z[j];
+                }
+                for (int i = 0; i < D; i++) {
+                    for (int j = 0; j <= i; j++) {
+                        cov[i * D + j] /= total;
+                        cov[j * D + i] = cov[i * D + j];
+                    }
+                    cov[i * D + i] += regularization[i];
+                }
+            }
+
+            if (std::fabs(loglikelihood - previous) <
+                1e-5 * std::fabs(loglikelihood))
+                break;
+            previous = loglikelihood;
+        }
+
+        // conditional distributions of the outputs given the inputs
+        inputs_ = I;
+        outputs_ = O;
+        components_ = K;
+        input_means_.assign(K * I, 0.f);
+        output_means_.assign(K * O, 0.f);
+        factors_.assign(K * I * I, 0.f);
+        regressions_.assign(K * O * I, 0.f);
+        constants_.assign(K, 0.f);
+        std::vector<double> input_factor(I * I), column(I);
+        for (int k = 0; k < K; k++) {
+            double const *cov = &covariances[k * D * D];
+            for (int i = 0; i < I; i++)
+                for (int j = 0; j < I; j++)
+                    input_factor[i * I + j] = cov[i * D + j];
+            if (!cholesky(&input_factor[0], I))
+                return "singular input covariance, record more frames";
+            double constant = std::log(weights[k]) - 0.5 * I * kGmmLog2Pi;
+            for (int i = 0; i < I; i++)
+                constant -= std::log(input_factor[i * I + i]);
+            constants_[k] = static_cast<float>(constant);
+            for (int i = 0; i < I * I; i++)
+                factors_[k * I * I + i] = static_cast<float>(input_factor[i]);
+            for (int i = 0; i < I; i++)
+                input_means_[k * I + i] =
+                    static_cast<float>(means[k * D + i]);
+            for (int o = 0; o < O; o++) {
+                output_means_[k * O + o] =
+                    static_cast<float>(means[k * D + I + o]);
+                // row o of cov_yx cov_xx^-1: cov_xx a = cov_xy[:, o]
+                for (int i = 0; i < I; i++) column[i] = cov[i * D + I + o];
+                forwardSubstitution(&input_factor[0], I, &column[0]);
+                backSubstitution(&input_factor[0], I, &column[0]);
+                for (int i = 0; i < I; i++)
+                    regressions_[(k * O + o) * I + i] =
+                        static_cast<float>(column[i]);
+            }
+        }
+        return std::string();
+    }
+
+    int inputs() const { return inputs_; }
+    int outputs() const { return outputs_; }
+    int components() const { return components_; }
+
+    /// Estimates the outputs of an input frame
+    void regress(float const *x, float *y) const {
+        const int I = inputs_;
+        const int O = outputs_;
+        float deltas[kMaxComponents * kMaxInputs];
+        float loglikelihoods[kMaxComponents];
+        for (int k = 0; k < components_; k++) {
+            float *delta = deltas + k * I;
+            float const *mean = &input_means_[k * I];
+            for (int i = 0; i < I; i++) delta[i] = x[i] - mean[i];
+            float v[kMaxInputs];
+            for (int i = 0; i < I; i++) v[i] = delta[i];
+            forwardSubstitution(&factors_[k * I * I], I, v);
+            float distance = 0.f;
+            for (int i = 0; i < I; i++) distance += v[i] * v[i];
+            loglikelihoods[k] = constants_[k] - 0.5f * distance;
+        }
+        float max = loglikelihoods[0];
+        for (int k = 1; k < components_; k++)
+            if (loglikelihoods[k] > max) max = loglikelihoods[k];
+        float sum = 0.f;
+        for (int k = 0; k < components_; k++) {
+            loglikelihoods[k] = std::exp(loglikelihoods[k] - max);
+            sum += loglikelihoods[k];
+        }
+
+        for (int o = 0; o < O; o++) y[o] = 0.f;
+        for (int k = 0; k < components_; k++) {
+            float weight = loglikelihoods[k] / sum;
+            float const *delta = deltas + k * I;
+            for (int o = 0; o < O; o++) {
+                float const *row = &regressions_[(k * O + o) * I];
+                float value = output_means_[k * O + o];
+                for (int i = 0; i < I; i++) value += row[i] * delta[i];
+                y[o] += weight * value;
+            }
+        }
+    }
+
+  private:
+    int inputs_;
+    int outputs_;
+    int components_;
+    std::vector<float> input_means_;   // components x inputs
+    std::vector<float> output_means_;  // components x outputs
+    std::vector<float> factors_;       // Cholesky factor of each component
+    std::vector<float> regressions_;   // components x outputs x inputs
+    std::vector<float> constants_;     // log(weight) - log(normalization)
+};
+
+#endif
@@ -0,0 +1,266 @@
+/**
+ *
+ * @file hmm.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Left-to-right HMM following of recorded gesture templates
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_HMM_HPP
+#define MAXMYO_HMM_HPP
+
+#include "trainingset.hpp"
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * Gesture templates as left-to-right hidden Markov models, as the Gesture
+ * Follower (Bevilacqua et al., 2010): each template (a recording of a class)
+ * is resampled to at most a given number of states, whose emissions are
+ * Gaussians centered on the template with a variance shared by all states (a
+ * fraction of the variance of all templates, per dimension). From each
+ * state, the follower stays, moves to the next state or skips one, so that
+ * gestures can be performed at varying speeds; from the last state of a
+ * template, it may restart at the first state of any template, so that
+ * gestures can be followed one after another.
+ *
+ * The states of all templates form a single model: parameters are stored by
+ * dimension (the states of a dimension are contiguous), and transitions as
+ * weights of the state, previous state and the one before for each state, so
+ * that every step of the forward algorithm is a loop over all states, which
+ * compilers vectorize.
+ */
+class HmmModel {
+  public:
+    static const int kMaxClasses = 16;
+
+    HmmModel() : dimension_(0), states_(0) {}
+
+    /// Builds the model from the templates of a training set (one template
+    /// per class), with at most max_states states per template. Returns an
+    /// empty string, or the reason why the model could not be built.
+    std::string build(TrainingSet const &set, int max_states,
+                      double relative_variance = 0.1,
+                      double absolute_variance = 1e-3) {
+        if (set.labels.empty() || set.dimension < 1) return "no templates";
+        if (set.labels.size() > static_cast<std::size_t>(kMaxClasses))
+            return "too many classes";
+        const int D = set.dimension;
+        if (max_states < 2) max_states = 2;
+
+        // variance of all templates
+        std::vector<double> mean(D, 0.), variance(D, 0.);
+        std::size_t frames = 0;
+        for (std::size_t c = 0; c < set.data.size(); c++) {
+            std::size_t n = set.data[c].size() / D;
+            if (!n) return "empty template " + set.labels[c];
+            for (std::size_t i = 0; i < n * D; i++)
+                mean[i % D] += set.data[c][i];
+            frames += n;
+        }
+        for (int d = 0; d < D; d++) mean[d] /= frames;
+        for (std::size_t c = 0; c < set.data.size(); c++)
+            for (std::size_t i = 0; i < set.data[c].size(); i++) {
+                double x = set.data[c][i] - mean[i % D];
+                variance[i % D] += x * x;
+            }
+
+        labels_ = set.labels;
+        dimension_ = D;
+        offsets_.assign(1, 0);
+        std::vector<int> lengths;
+        for (std::size_t c = 0; c < set.data.size(); c++) {
+            int n = static_cast<int>(set.data[c].size() / D);
+            lengths.push_back(n < max_states ? n : max_states);
+            offsets_.push_back(offsets_.back() + lengths.back());
+        }
+        states_ = offsets_.back();
+        const int S = states_;
+
+        means_.assign(D * S, 0.f);
+        precisions_.assign(D, 0.f);
+        for (int d = 0; d < D; d++)
+            precisions_[d] = static_cast<float>(
+                1. / (relative_variance * variance[d] / frames +
+                      absolute_variance));
+        stay_.assign(S, 0.f);
+        next_.assign(S, 0.f);
+        skip_.assign(S, 0.f);
+        exit_.assign(classes(), 0.f);
+        for (int c = 0; c < classes(); c++) {
+            std::vector<float> const &data = set.data[c];
+            int n = static_cast<int>(data.size() / D);
+            int states = lengths[c];
+            // each state is the mean of a segment of the template
+            for (int k = 0; k < states; k++) {
+                int begin = n * k / states;
+                int end = n * (k + 1) / states;
+                for (int d = 0; d < D; d++) {
+                    double sum = 0.;
+                    for (int i = begin; i < end; i++) sum += data[i * D + d];
+                    means_[d * S + offsets_[c] + k] =
+                        static_cast<float>(sum / (end - begin));
+                }
+            }
+            // at the speed of the template, the follower advances by
+            // states / n states per frame: it moves (uniformly to the same,
+            // next or second next state) with that probability
+            float move = static_cast<float>(states) / n;
+            for (int k = 0; k < states; k++) {
+                int s = offsets_[c] + k;
+                stay_[s] = 1.f - move + move / 3.f;
+                next_[s] = k >= 1 ? move / 3.f : 0.f;
+                skip_[s] = k >= 2 ? move / 3.f : 0.f;
+            }
+            // the last state keeps the mass that does not exit
+            exit_[c] = move / 3.f;
+            stay_[offsets_[c + 1] - 1] = 1.f - exit_[c];
+        }
+        return std::string();
+    }
+
+    int dimension() const { return dimension_; }
+    int states() const { return states_; }
+    int classes() const { return static_cast<int>(labels_.size()); }
+    std::string const &label(int c) const { return labels_[c]; }
+
+  private:
+    friend class HmmFollower;
+
+    int dimension_;
+    int states_;                     // states of all classes
+    std::vector<std::string> labels_;
+    std::vector<int> offsets_;       // first state of each class
+    std::vector<float> means_;       // dimension x states
+    std::vector<float> precisions_;  // dimension
+    std::vector<float> stay_;        // weight of the state itself
+    std::vector<float> next_;        // weight of the previous state
+    std::vector<float> skip_;        // weight of the state before it
+    std::vector<float> exit_;        // exit of the last state of each class
+};
+
+/**
+ * Incremental forward algorithm over the states of a model, for one stream.
+ * Buffers are allocated by configure(): updates do not allocate, and their
+ * cost is bounded by the number of states times the dimension.
+ */
+class HmmFollower {
+  public:
+    HmmFollower() : model_(0) {}
+
+    /// Allocates the buffers for a model (which must outlive the follower
+    /// or the next call) and restarts
+    void configure(HmmModel const *model) {
+        model_ = model;
+        int S = model ? model->states() : 0;
+        alpha_.assign(S + 2, 0.f);
+        prior_.assign(S, 0.f);
+        emission_.assign(S, 0.f);
+        reset();
+    }
+
+    HmmModel const *model() const { return model_; }
+
+    /// Restarts at the first state of every class
+    void reset() {
+        for (std::size_t s = 0; s < alpha_.size(); s++) alpha_[s] = 0.f;
+        started_ = false;
+    }
+
+    /// Updates the state probabilities with a frame (dimension values),
+    /// writes the normalized likelihood and the time progression (in
+    /// [0, 1]) of each class, and returns the index of the likeliest class
+    int update(float const *x, float *likelihoods, float *progressions) {
+        HmmModel const &m = *model_;
+        const int S = m.states_;
+        const int C = m.classes();
+        float *alpha = &alpha_[2];  // two zeros before the first state
+        float *prior = &prior_[0];
+        float *emission = &emission_[0];
+
+        // transitions
+        if (!started_) {
+            for (int s = 0; s < S; s++) prior[s] = 0.f;
+            for (int c = 0; c < C; c++) prior[m.offsets_[c]] = 1.f / C;
+            started_ = true;
+        } else {
+            float const *stay = &m.stay_[0];
+            float const *next = &m.next_[0];
+            float const *skip = &m.skip_[0];
+            for (int s = 0; s < S; s++)
+                prior[s] = stay[s] * alpha[s] + next[s] * alpha[s - 1] +
+                           skip[s] * alpha[s - 2];
+            float restart = 0.f;
+            for (int c = 0; c < C; c++)
+                restart += m.exit_[c] * alpha[m.offsets_[c + 1] - 1];
+            for (int c = 0; c < C; c++) prior[m.offsets_[c]] += restart / C;
+        }
+
+        // emissions (relative to the likeliest state, the variance is
+        // shared by all states)
+        for (int s = 0; s < S; s++) emission[s] = 0.f;
+        for (int d = 0; d < m.dimension_; d++) {
+            float const *mean = &m.means_[d * S];
+            float precision = m.precisions_[d];
+            float xd = x[d];
+            for (int s = 0; s < S; s++) {
+                float diff = xd - mean[s];
+                emission[s] -= 0.5f * precision * diff * diff;
+            }
+        }
+        float max = emission[0];
+        for (int s = 1; s < S; s++)
+            if (emission[s] > max) max = emission[s];
+        for (int s = 0; s < S; s++) emission[s] = std::exp(emission[s] - max);
+
+        float sum = 0.f;
+        for (int s = 0; s < S; s++) {
+            alpha[s] = prior[s] * emission[s];
+            sum += alpha[s];
+        }
+        // a frame out of the followed templates: start over from the frame
+        if (!(sum > 1e-30f)) {
+            sum = 0.f;
+            for (int s = 0; s < S; s++) {
+                alpha[s] = emission[s];
+                sum += alpha[s];
+            }
+        }
+        float norm = 1.f / sum;
+        for (int s = 0; s < S; s++) alpha[s] *= norm;
+
+        int likeliest = 0;
+        for (int c = 0; c < C; c++) {
+            int begin = m.offsets_[c];
+            int states = m.offsets_[c + 1] - begin;
+            float p = 0.f;
+            float position = 0.f;
+            for (int k = 0; k < states; k++) {
+                p += alpha[begin + k];
+                position += k * alpha[begin + k];
+            }
+            likelihoods[c] = p;
+            progressions[c] =
+                (p > 0.f && states > 1) ? position / p / (states - 1) : 0.f;
+            if (p > likelihoods[likeliest]) likeliest = c;
+        }
+        return likeliest;
+    }
+
+  private:
+    HmmModel const *model_;
+    std::vector<float> alpha_;     // state probabilities
+    std::vector<float> prior_;     // after the transitions
+    std::vector<float> emission_;  // relative emission probabilities
+    bool started_;
+};
+
+#endif
@@ -20,27 +20,134 @@
 #include "ext.h"
 #include "ext_obex.h"
 #include "ext_systhread.h"
+#include "envelope.hpp"
+#include "features.hpp"
+#include "frames.hpp"
+#include "gmm.hpp"
+#include "gmr.hpp"
+#include "hmm.hpp"
+#include "orientation.hpp"
+#include "replay.hpp"
+#include "resampler.hpp"
+#include "ringbuffer.hpp"
+#include "session.hpp"
+#include "sharedhub.hpp"
+#include "stats.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <deque>
+#include <memory>
+#include <mutex>
 #include <myo/myo.hpp>
-#include <set>
 #include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define atom_isnum(a) ((a)->a_type == A_LONG || (a)->a_type == A_FLOAT)
 #define atom_issym(a) ((a)->a_type == A_SYM)
 #define mysneg(s) ((s)->s_name)
 #define atom_setvoid(p) ((p)->a_type = A_NOTHING)
 
+#define EMG_BUFFER_DEFAULT_SIZE 256
+#define MAX_DEVICES 16
+#define EMG_PERIOD_US 5000   // EMG sampled at 200 Hz
+#define IMU_PERIOD_US 20000  // IMU sampled at 50 Hz
+// IMU buffers: as long as the EMG buffer, for each device
+#define IMU_BUFFER_SIZE(emg_size)                                  \
+    (((emg_size) * EMG_PERIOD_US + IMU_PERIOD_US - 1) / IMU_PERIOD_US * \
+     MAX_DEVICES)
+#define FEATURES_WINDOW_DEFAULT 40  // 200 ms
+#define FEATURES_HOP_DEFAULT 10     // 50 ms
+#define FEATURES_MAX_SIZE 1000
+#define GMM_MAX_FRAMES 120000  // 10 minutes of EMG
+#define GMR_MAX_FRAMES 120000  // 10 minutes of fused frames
+#define GMR_INPUTS 18          // values of a fused frame
+#define HMM_MAX_FRAMES 3000    // 1 minute of IMU per template
+#define HMM_MAX_STATES 256
+#define HMM_DIMENSION 10       // acceleration, gyroscope and orientation
+
 typedef struct _myo t_myo;
 
 #if defined(MAC_VERSION)
 #pragma mark -
 #pragma mark Myo Device Listener
 #endif
-class MaxMyoListener : public myo::DeviceListener {
+/**
+ * State of a device seen by the listener. Devices are indexed by order of
+ * first connection, this compact index prefixes messages in multi-device mode.
+ */
+struct DeviceState {
+    myo::Myo *myo;  // NULL for replayed devices
+    std::string name;
+    std::atomic<bool> connected;
+
+    /// Timestamp at which the device was connected (0 until known)
+    std::atomic<uint64_t> connection_timestamp;
+};
+
+class MaxMyoListener : public myo::DeviceListener,
+                       public SessionPlayer::Listener {
   public:
     MaxMyoListener(t_myo *maxObject)
-        : maxObject_(maxObject), num_emg_frames(0) {}
+        : emg_buffer(EMG_BUFFER_DEFAULT_SIZE),
+          accel_buffer(IMU_BUFFER_SIZE(EMG_BUFFER_DEFAULT_SIZE)),
+          gyro_buffer(IMU_BUFFER_SIZE(EMG_BUFFER_DEFAULT_SIZE)),
+          quat_buffer(IMU_BUFFER_SIZE(EMG_BUFFER_DEFAULT_SIZE)),
+          info_buffer(64),
+          fused_buffer(EMG_BUFFER_DEFAULT_SIZE),
+          features_buffer(64),
+          envelope_buffer(EMG_BUFFER_DEFAULT_SIZE),
+          gmm_buffer(64),
+          hmm_buffer(64),
+          gmr_buffer(EMG_BUFFER_DEFAULT_SIZE),
+          emg_latest(),
+          accel_latest(),
+          gyro_latest(),
+          quat_latest(),
+          fused_latest(),
+          features_latest(),
+          envelope_latest(),
+          mvc_calibrating(false),
+          gmm_label(-1),
+          gmm_cancel(false),
+          hmm_label(-1),
+          gmr_recording(false),
+          gmr_target(),
+          gmr_outputs(0),
+          gmr_cancel(false),
+          emg_dropped(0),
+          num_devices(0),
+          drain_pending(false),
+          recorder(NULL),
+          replaying(false),
+          replay_device(-1),
+          resampling_(false),
+          features_window_(FEATURES_WINDOW_DEFAULT),
+          features_hop_(FEATURES_HOP_DEFAULT),
+          maxObject_(maxObject) {
+        for (int i = 0; i < MAX_DEVICES; i++) {
+            emg_link[i] = LinkMonitor(EMG_PERIOD_US);
+            imu_link[i] = LinkMonitor(IMU_PERIOD_US);
+            emg_resampler[i] = Resampler<EmgFrame>(EMG_PERIOD_US);
+            accel_resampler[i] = Resampler<Vector3Frame>(IMU_PERIOD_US);
+            gyro_resampler[i] = Resampler<Vector3Frame>(IMU_PERIOD_US);
+            quat_resampler[i] = Resampler<QuaternionFrame>(IMU_PERIOD_US);
+            devices[i].myo = NULL;
+            devices[i].connected = false;
+            devices[i].connection_timestamp = 0;
+            emg_latest[i].device = accel_latest[i].device =
+                gyro_latest[i].device = quat_latest[i].device =
+                    fused_latest[i].device = features_latest[i].device =
+                        envelope_latest[i].device = static_cast<uint8_t>(i);
+            mvc[i].fill(1.f);
+            mvc_peak[i].fill(0.f);
+            imu_timestamp[i] = 0;
+            imu_received[i] = 0;
+        }
+    }
 
     /// Called when a paired Myo has been connected.
     void onConnect(myo::Myo *myo, uint64_t timestamp,
@@ -85,19 +192,306 @@ class MaxMyoListener : public myo::DeviceListener {
     /// Called when a paired Myo has provided a new pose.
     void onPose(myo::Myo *myo, uint64_t timestamp, myo::Pose pose);
 
-    // Sensor Data arrays
-    uint64_t emg_timestamp;
-    std::array<std::array<float, 8>, 4> emg_frames;
-    std::array<float, 3> acceleration;
-    std::array<float, 3> gyroscopes;
-    std::array<float, 4> quaternions;
+    /// Called by the session player for each record of a replayed session
+    void onRecord(SessionRecord const &record);
+
+    /// Called by the session player at the end of a replayed session
+    void onEnd();
+
+    /// Sensor streams: frames are pushed by the hub thread and drained by
+    /// the Max thread in deferred mode, or when querying all EMG frames
+    /// (@emgall 1, see myo_bang)
+    RingBuffer<EmgFrame> emg_buffer;
+    RingBuffer<Vector3Frame> accel_buffer;
+    RingBuffer<Vector3Frame> gyro_buffer;
+    RingBuffer<QuaternionFrame> quat_buffer;
+
+    /// Latest frame of each device, written by the hub thread and read by
+    /// queries: a query returns the latest frame after any interval
+    std::array<LatestValue<EmgFrame>, MAX_DEVICES> emg_value;
+    std::array<LatestValue<EnvelopeFrame>, MAX_DEVICES> envelope_value;
+    std::array<LatestValue<EmgFeatureFrame>, MAX_DEVICES> features_value;
+    std::array<LatestValue<FusedFrame>, MAX_DEVICES> fused_value;
+    std::array<LatestValue<Vector3Frame>, MAX_DEVICES> accel_value;
+    std::array<LatestValue<Vector3Frame>, MAX_DEVICES> gyro_value;
+    std::array<LatestValue<QuaternionFrame>, MAX_DEVICES> quat_value;
+
+    /// Info events waiting to be output by Max (deferred mode only)
+    RingBuffer<InfoEvent> info_buffer;
+
+    /// Fused frames (@fused 1), queued like EMG frames
+    RingBuffer<FusedFrame> fused_buffer;
+
+    /// EMG features (@features 1), one frame per hop
+    RingBuffer<EmgFeatureFrame> features_buffer;
+
+    /// EMG envelope (@envelope 1), queued like EMG frames
+    RingBuffer<EnvelopeFrame> envelope_buffer;
+
+    /// GMM classification results (@gmm 1), queued like info events
+    RingBuffer<ClassFrame> gmm_buffer;
+
+    /// HMM following results (@hmm 1), queued like info events
+    RingBuffer<FollowFrame> hmm_buffer;
+
+    /// GMR results (@gmr 1), queued like info events
+    RingBuffer<RegressionFrame> gmr_buffer;
+
+    /// Latest frames of each device drained from the buffers (only accessed
+    /// by Max)
+    std::array<EmgFrame, MAX_DEVICES> emg_latest;
+    std::array<Vector3Frame, MAX_DEVICES> accel_latest;
+    std::array<Vector3Frame, MAX_DEVICES> gyro_latest;
+    std::array<QuaternionFrame, MAX_DEVICES> quat_latest;
+    std::array<FusedFrame, MAX_DEVICES> fused_latest;
+    std::array<EmgFeatureFrame, MAX_DEVICES> features_latest;
+    std::array<EnvelopeFrame, MAX_DEVICES> envelope_latest;
+
+    /// Maximum voluntary contraction of each channel of each device: the
+    /// envelope is output relative to the MVC. Set with a MyoLock.
+    std::array<std::array<float, 8>, MAX_DEVICES> mvc;
+
+    /// MVC calibration: while calibrating, the hub thread keeps the peak
+    /// envelope of each channel (read with a MyoLock)
+    std::atomic<bool> mvc_calibrating;
+    std::array<std::array<float, 8>, MAX_DEVICES> mvc_peak;
+
+    /// GMM training set: while gmm_label is set, the hub thread appends the
+    /// classifier input of the streamed devices to the frames of that class.
+    /// Set and read with a MyoLock.
+    TrainingSet gmm_data;
+    int gmm_label;  // class being recorded (-1 if none)
+
+    /// GMM classifier used by the hub thread (NULL until trained), and the
+    /// symbols of its classes. Only replaced by Max, with a MyoLock.
+    std::unique_ptr<GmmClassifier> gmm;
+    std::vector<t_symbol *> gmm_labels;
+
+    /// Background training: the thread trains gmm_trained (or sets
+    /// gmm_error) and sets the gmm clock, which installs the model
+    std::thread gmm_thread;
+    std::unique_ptr<GmmClassifier> gmm_trained;
+    std::string gmm_error;
+    std::atomic<bool> gmm_cancel;
+
+    /// Sliding windows of the class likelihoods of each device (reset by Max
+    /// with a MyoLock when a model is installed)
+    std::array<LikelihoodWindow, MAX_DEVICES> gmm_window;
+
+    /// HMM templates: while hmm_label is set, the hub thread appends the IMU
+    /// frames of the streamed devices to the template of that class. Set and
+    /// read with a MyoLock.
+    TrainingSet hmm_data;
+    int hmm_label;  // template being recorded (-1 if none)
+
+    /// HMM model followed by the hub thread (NULL if no template), the
+    /// symbols of its classes and the follower of each device. Only replaced
+    /// by Max, with a MyoLock.
+    std::unique_ptr<HmmModel> hmm;
+    std::vector<t_symbol *> hmm_labels;
+    std::array<HmmFollower, MAX_DEVICES> hmm_follower;
+
+    /// GMR training set: while recording, the hub thread appends the fused
+    /// frames of the streamed devices followed by the target values. Set and
+    /// read with a MyoLock.
+    TrainingSet gmr_data;
+    bool gmr_recording;
+    std::array<float, GmrRegressor::kMaxOutputs> gmr_target;
+
+    /// GMR model used by the hub thread (NULL until trained), and its number
+    /// of outputs. Only replaced by Max, with a MyoLock.
+    std::unique_ptr<GmrRegressor> gmr;
+    int gmr_outputs;
+
+    /// Background training (see gmm_thread)
+    std::thread gmr_thread;
+    std::unique_ptr<GmrRegressor> gmr_trained;
+    std::string gmr_error;
+    std::atomic<bool> gmr_cancel;
+
+    /// Reference orientation of each device (identity if none): orientations
+    /// are output relative to it. Set with a MyoLock.
+    std::array<myo::Quaternion<float>, MAX_DEVICES> orientation_reference;
+
+    /// Number of EMG frames dropped because their buffer was full (EMG,
+    /// fused, features or envelope buffer)
+    std::atomic<unsigned long> emg_dropped;
+
+    /// Event, loss and timing counters (see myo_stats)
+    ListenerStats stats;
+
+    /// Table of the devices seen by the listener (only appended to by the hub
+    /// thread, entries below num_devices can be read from Max)
+    std::array<DeviceState, MAX_DEVICES> devices;
+    std::atomic<int> num_devices;
+
+    /// True when the drain clock is set and has not run yet
+    std::atomic<bool> drain_pending;
+
+    /// Session recorder (NULL when not recording). Set with a MyoLock, only
+    /// used by the hub thread.
+    SessionWriter *recorder;
+
+    /// True while a session is replayed: the session player replaces the hub
+    /// thread, and devices of the table are the devices of the session
+    std::atomic<bool> replaying;
+
+    /// Device followed in single-device mode while replaying (-1 if none)
+    std::atomic<int> replay_device;
+
+    /// Mutex of the session player, which sends each record with a MyoLock
+    /// (with the hub mutex as well if the hub is running): the state shared
+    /// with Max is protected during replay as it is from the hub thread
+    std::recursive_mutex replay_mutex;
+
+    /// Index of a device in the device table (-1 if unknown)
+    int deviceIndex(myo::Myo *myo) const;
+
+    /// Index of the device followed in single-device mode (-1 if none)
+    int followedIndex() const;
+
+    /// True if the data of the device at the given index is output
+    bool isStreamed(int index) const;
+
+    /// Index of a device if its data is output by the object, -1 otherwise
+    int streamedIndex(myo::Myo *myo) const;
+
+    /// Clears the device table (the hub thread and the session player must
+    /// be stopped)
+    void resetDevices();
+
+    /// First connected device in the device table (NULL if none)
+    myo::Myo *firstConnected() const;
+
+    /// Captures the latest orientation of a device as its reference (false
+    /// if no orientation was received, requires a MyoLock)
+    bool captureReference(int index);
+
+    /// Routes the streamed devices to this listener on the shared hub
+    /// (requires a SharedHub::Lock, or to be called from the hub thread)
+    void updateRoutes();
 
-    int num_emg_frames;
+  protected:
+    /// Handles sensor frames received from the devices or from the session
+    /// player: records them, and forwards them (resampled with @resample 1)
+    void handle(EmgFrame const &frame);
+    void handleAccel(Vector3Frame const &frame);
+    void handleGyro(Vector3Frame const &frame);
+    void handle(QuaternionFrame const &frame);
+
+    /// Outputs sensor frames, or queues them for queries or in deferred mode
+    void forward(EmgFrame const &frame);
+    void forwardAccel(Vector3Frame const &frame);
+    void forwardGyro(Vector3Frame const &frame);
+    void forward(QuaternionFrame const &frame);
+    void forward(FusedFrame const &frame);
+
+    /// Rotates an acceleration frame to the world frame by the orientation
+    /// at its timestamp, and removes gravity with @accelmode linear (false
+    /// if no orientation was received)
+    bool worldAcceleration(Vector3Frame const &frame, Vector3Frame &out) const;
+    void forward(EmgFeatureFrame const &frame);
+    void forward(EnvelopeFrame const &frame);
+
+    /// Records a classifier input frame (EMG, envelope or features) for
+    /// training, and classifies it (@gmm 1)
+    void classify(uint64_t timestamp, uint8_t device, float const *values,
+                  int dimension);
+
+    /// Outputs a classification result, or queues it in deferred mode
+    void forward(ClassFrame const &frame);
+
+    /// Collects the IMU streams of a device (myo::Hub::EventMask values) for
+    /// the HMM: calls follow() when the last enabled stream of a timestamp
+    /// is received, whatever the order of the streams
+    void collect(uint8_t device, uint64_t timestamp, unsigned int stream);
+
+    /// Records the IMU frame of a timestamp (acceleration, gyroscope and
+    /// orientation) in the template being recorded, and follows it (@hmm 1)
+    void follow(uint8_t device, uint64_t timestamp);
+
+    /// Outputs a following result, or queues it in deferred mode
+    void forward(FollowFrame const &frame);
+
+    /// Records a fused frame with the target values for training, and maps
+    /// it to the output values (@gmr 1)
+    void regress(FusedFrame const &frame);
+
+    /// Outputs a regression result, or queues it in deferred mode
+    void forward(RegressionFrame const &frame);
+
+    /// True if EMG frames are output with the aligned IMU values (@fused 1,
+    /// unless the EMG features are output)
+    bool fused() const;
+
+    /// True if the fused frames are recorded or mapped by the GMR (@gmr 1)
+    bool regressing() const;
+
+    /// True if EMG features are output instead of EMG frames (@features).
+    /// The extractors restart when their window or hop changes.
+    bool extracting();
+
+    /// True if the sensor streams are resampled (@resample). The resamplers
+    /// restart when resampling is enabled.
+    bool resampling();
+
+    /// Restarts the resamplers of a device
+    void resetResamplers(int index);
+
+    /// Marks a device as disconnected and clears its latest frames
+    void disconnectDevice(int index, uint64_t timestamp);
+
+    /// Outputs an info event, or queues it in deferred mode
+    void dispatch(InfoEvent const &event);
+
+    /// Sets the drain clock unless it is already pending (deferred mode)
+    void scheduleDrain();
+
+    /// Pushes a frame or an event to a buffer and updates its high-water
+    /// mark, or counts it as dropped if the buffer is full
+    template <typename T>
+    bool enqueue(RingBuffer<T> &buffer, T const &value,
+                 ListenerStats::Queue queue) {
+        if (buffer.push(value)) {
+            stats.queue_max[queue].max(buffer.size());
+            return true;
+        }
+        stats.dropped[queue].add();
+        return false;
+    }
 
-    // List of connected devices
-    std::set<myo::Myo *> connectedDevices;
+    /// Timestamps of the EMG and IMU streams of each device, to infer the
+    /// samples lost on the link (only used by the hub thread)
+    std::array<LinkMonitor, MAX_DEVICES> emg_link;
+    std::array<LinkMonitor, MAX_DEVICES> imu_link;
+
+    /// Reconstruction of uniformly sampled streams for each device (only used
+    /// by the hub thread)
+    std::array<Resampler<EmgFrame>, MAX_DEVICES> emg_resampler;
+    std::array<Resampler<Vector3Frame>, MAX_DEVICES> accel_resampler;
+    std::array<Resampler<Vector3Frame>, MAX_DEVICES> gyro_resampler;
+    std::array<Resampler<QuaternionFrame>, MAX_DEVICES> quat_resampler;
+    bool resampling_;
+
+    /// Latest IMU frames of each device, aligned on the EMG frames in fused
+    /// mode (only used by the hub thread)
+    std::array<FrameHistory<Vector3Frame>, MAX_DEVICES> accel_history;
+    std::array<FrameHistory<Vector3Frame>, MAX_DEVICES> gyro_history;
+    std::array<FrameHistory<QuaternionFrame>, MAX_DEVICES> quat_history;
+
+    /// Timestamp of the IMU frame collected for the HMM, and the streams
+    /// received at that timestamp (only used by the hub thread)
+    std::array<uint64_t, MAX_DEVICES> imu_timestamp;
+    std::array<unsigned int, MAX_DEVICES> imu_received;
+
+    /// EMG envelope filters of each device (only used by the hub thread)
+    std::array<EmgEnvelope, MAX_DEVICES> emg_envelope;
+
+    /// EMG feature extractors of each device (only used by the hub thread)
+    std::array<EmgFeatures, MAX_DEVICES> emg_features;
+    long features_window_;
+    long features_hop_;
 
-  protected:
     // parent object structure
     t_myo *maxObject_;
 };
@@ -111,10 +505,13 @@ struct _myo {
 
     MaxMyoListener *myoListener;  // Myo event listener
     myo::Myo *myoDevice;          // Current myo device (null if disconnected)
-    myo::Hub *myoHub;             // Myo Hub
-    t_systhread systhread;        // thread reference
-    t_systhread_mutex mutex;      // mutual exclusion lock for threadsafety
-    int systhread_cancel;         // thread cancel flag
+    SharedHub *myoHub;            // Myo Hub (shared by all objects)
+    t_clock *drain_clock;         // outputs deferred events in Max
+    SessionWriter *recorder;      // session recorder (created on record)
+    SessionPlayer *player;        // session player (created on replay)
+    t_clock *replay_clock;        // stops the replay at the end of the file
+    t_clock *gmm_clock;           // installs a GMM trained in the background
+    t_clock *gmr_clock;           // installs a GMR trained in the background
 
     void *outlet_accel;
     void *outlet_gyro;
@@ -131,9 +528,63 @@ struct _myo {
     int stream;
     int myoPolicy_emg;
     int myoPolicy_unlock;
+    long emgBufferSize;
+    long emgQueryAll;
+    long outputTimestamp;
+    long deferOutput;
+    long resampleOutput;
+    long fusedOutput;
+    t_symbol *orientationFormat;  // quat, euler or matrix
+    t_symbol *accelMode;          // sensor, world or linear
+    long emgFeatures;
+    long emgEnvelope;
+    double envelopeDiffusion;
+    double envelopeJumpRate;
+    long featuresWindow;
+    long featuresHop;
+    long gmmRun;
+    long gmmComponents;
+    long gmmWindow;
+    long hmmRun;
+    long hmmStates;
+    double hmmVariance;
+    long gmrRun;
+    long gmrComponents;
+    long multiDevices;  // 0: single device, -1: all devices, N: N devices
+    long streamAccel;
+    long streamGyro;
+    long streamQuat;
+    long streamPose;
+    long hubSlice;
+    double latencyDisconnect;  // duration of the last disconnect (ms)
+    double latencyDevice;      // duration of the last device switch (ms)
+    unsigned long emgDroppedReported;
+    unsigned long statsEmgDroppedBase;  // counters at the last [stats reset]
+    uint64_t statsSlicesBase;
+    uint64_t statsOverrunsBase;
     long dummy_attr_long;
 };
 
+/**
+ * Scoped lock of the state of the listener shared with Max and the hub
+ * thread or the session player: takes the hub mutex (interrupting the event
+ * loop, see SharedHub::Lock) if the hub is running, then the mutex of the
+ * session player. Both are recursive, and always taken in this order.
+ */
+class MyoLock {
+  public:
+    explicit MyoLock(t_myo *self)
+        : hub_lock_(self->myoHub ? new SharedHub::Lock(*self->myoHub) : NULL),
+          replay_lock_(self->myoListener->replay_mutex) {}
+
+  private:
+    MyoLock(MyoLock const &);
+    MyoLock &operator=(MyoLock const &);
+
+    std::unique_ptr<SharedHub::Lock> hub_lock_;
+    std::lock_guard<std::recursive_mutex> replay_lock_;
+};
+
 // Method declaration
 void *myo_new(t_symbol *s, long argc, t_atom *argv);
 void myo_free(t_myo *self);
@@ -144,24 +595,73 @@ void myo_bang(t_myo *self);
 void myo_connect(t_myo *self, t_symbol *s, long argc, t_atom *argv);
 void myo_disconnect(t_myo *self);
 void myo_vibrate(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_latency(t_myo *self);
+void myo_stats(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_mvc(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_setref(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_gmm(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_gmm_train(t_myo *self, TrainingSet data, long components);
+void myo_gmm_install(t_myo *self);
+void myo_gmr(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_gmr_train(t_myo *self, TrainingSet data, long components);
+void myo_gmr_install(t_myo *self);
+void myo_hmm(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_hmm_build(t_myo *self);
+t_symbol *myo_label(t_atom const *atom);
+void myo_output_labels(t_myo *self, t_symbol *selector,
+                       std::vector<t_symbol *> const &labels);
+void myo_record(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_stoprecord(t_myo *self);
+void myo_replay(t_myo *self, t_symbol *s, long argc, t_atom *argv);
+void myo_stopreplay(t_myo *self);
+double myo_elapsed_ms(std::chrono::steady_clock::time_point start);
 
 void myo_dump_devlist(t_myo *self);
 void myo_dump_emg(t_myo *self);
 void myo_dump_accel(t_myo *self);
 void myo_dump_gyro(t_myo *self);
 void myo_dump_quat(t_myo *self);
+void myo_dump_fused(t_myo *self);
+void myo_dump_features(t_myo *self);
+void myo_dump_envelope(t_myo *self);
+void myo_output_emg(t_myo *self, EmgFrame const &frame, bool timestamp);
+void myo_output_accel(t_myo *self, Vector3Frame const &frame, bool timestamp);
+void myo_output_gyro(t_myo *self, Vector3Frame const &frame, bool timestamp);
+void myo_output_quat(t_myo *self, QuaternionFrame const &frame,
+                     bool timestamp);
+void myo_output_fused(t_myo *self, FusedFrame const &frame, bool timestamp);
+void myo_output_features(t_myo *self, EmgFeatureFrame const &frame,
+                         bool timestamp);
+void myo_output_envelope(t_myo *self, EnvelopeFrame const &frame,
+                         bool timestamp);
+double myo_timestamp_ms(t_myo *self, int device, uint64_t timestamp);
+int myo_streamed_devices(t_myo *self, int *indices);
+bool myo_has_source(t_myo *self, const char *message);
+unsigned int myo_event_mask(t_myo *self);
+void myo_update_event_mask(t_myo *self);
+void myo_output_event(t_myo *self, InfoEvent const &event);
+void myo_output_class(t_myo *self, ClassFrame const &frame);
+void myo_output_follow(t_myo *self, FollowFrame const &frame);
+void myo_output_regression(t_myo *self, RegressionFrame const &frame);
+void myo_drain(t_myo *self);
 void onMaxMyoSync(t_myo *self);
 
-void *myo_run(t_myo *self);  // threaded function
-
 // Attribute accessors
 t_max_err myoSetStreamAttr(t_myo *self, void *attr, long ac, t_atom *av);
 t_max_err myoGetStreamAttr(t_myo *self, t_object *attr, long *ac, t_atom **av);
 t_max_err myoSetStreamEmgAttr(t_myo *self, void *attr, long ac, t_atom *av);
 t_max_err myoGetStreamEmgAttr(t_myo *self, t_object *attr, long *ac,
                               t_atom **av);
+t_max_err myoSetStreamMaskAttr(t_myo *self, t_object *attr, long ac,
+                               t_atom *av);
+t_max_err myoSetEmgBufferAttr(t_myo *self, void *attr, long ac, t_atom *av);
+t_max_err myoSetSliceAttr(t_myo *self, void *attr, long ac, t_atom *av);
+t_max_err myoSetOrientationAttr(t_myo *self, void *attr, long ac, t_atom *av);
+t_max_err myoSetAccelModeAttr(t_myo *self, void *attr, long ac, t_atom *av);
 t_max_err myoSetUnlockAttr(t_myo *self, void *attr, long ac, t_atom *av);
 t_max_err myoGetUnlockAttr(t_myo *self, t_object *attr, long *ac, t_atom **av);
+t_max_err myoSetMultiAttr(t_myo *self, void *attr, long ac, t_atom *av);
+t_max_err myoGetMultiAttr(t_myo *self, t_object *attr, long *ac, t_atom **av);
 t_max_err myoSetDeviceAttr(t_myo *self, void *attr, long ac, t_atom *av);
 t_max_err myoGetDeviceAttr(t_myo *self, t_object *attr, long *ac, t_atom **av);
 
@@ -172,8 +672,37 @@ static t_symbol *sym_long = gensym("long");
 static t_symbol *sym_rssi = gensym("rssi");
 static t_symbol *sym_battery = gensym("battery");
 static t_symbol *sym_auto = gensym("auto");
+static t_symbol *sym_all = gensym("all");
 static t_symbol *sym_connected = gensym("connected");
 static t_symbol *sym_armsync = gensym("armsync");
+static t_symbol *sym_emgdropped = gensym("emgdropped");
+static t_symbol *sym_latency = gensym("latency");
+static t_symbol *sym_stats = gensym("stats");
+static t_symbol *sym_reset = gensym("reset");
+static t_symbol *sym_start = gensym("start");
+static t_symbol *sym_stop = gensym("stop");
+static t_symbol *sym_mvc = gensym("mvc");
+static t_symbol *sym_events = gensym("events");
+static t_symbol *sym_lost = gensym("lost");
+static t_symbol *sym_callback = gensym("callback");
+static t_symbol *sym_queue = gensym("queue");
+static t_symbol *sym_slices = gensym("slices");
+static t_symbol *sym_gmm = gensym("gmm");
+static t_symbol *sym_hmm = gensym("hmm");
+static t_symbol *sym_gmr = gensym("gmr");
+static t_symbol *sym_quat = gensym("quat");
+static t_symbol *sym_euler = gensym("euler");
+static t_symbol *sym_matrix = gensym("matrix");
+static t_symbol *sym_sensor = gensym("sensor");
+static t_symbol *sym_world = gensym("world");
+static t_symbol *sym_linear = gensym("linear");
+static t_symbol *sym_record = gensym("record");
+static t_symbol *sym_train = gensym("train");
+static t_symbol *sym_trained = gensym("trained");
+static t_symbol *sym_clear = gensym("clear");
+static t_symbol *sym_disconnect = gensym("disconnect");
+static t_symbol *sym_device = gensym("device");
+static t_symbol *sym_replay = gensym("replay");
 
 t_class *myo_class;
 
@@ -199,6 +728,17 @@ int C74_EXPORT main(void) {
         c, (method)myo_assist, "assist", A_CANT,
         0);  // (optional) assistance method needs to be declared like this
     class_addmethod(c, (method)myo_vibrate, "vibrate", A_GIMME, 0);
+    class_addmethod(c, (method)myo_latency, "latency", 0);
+    class_addmethod(c, (method)myo_stats, "stats", A_GIMME, 0);
+    class_addmethod(c, (method)myo_mvc, "mvc", A_GIMME, 0);
+    class_addmethod(c, (method)myo_setref, "setref", A_GIMME, 0);
+    class_addmethod(c, (method)myo_gmm, "gmm", A_GIMME, 0);
+    class_addmethod(c, (method)myo_hmm, "hmm", A_GIMME, 0);
+    class_addmethod(c, (method)myo_gmr, "gmr", A_GIMME, 0);
+    class_addmethod(c, (method)myo_record, "record", A_GIMME, 0);
+    class_addmethod(c, (method)myo_stoprecord, "stoprecord", 0);
+    class_addmethod(c, (method)myo_replay, "replay", A_GIMME, 0);
+    class_addmethod(c, (method)myo_stopreplay, "stopreplay", 0);
 
     // Stream
     // ------------------------------
@@ -219,6 +759,182 @@ int C74_EXPORT main(void) {
     CLASS_ATTR_STYLE_LABEL(c, "emg", 0, "onoff",
                            "Enable/Disable EMG Streaming");
 
+    // Stream IMU data and poses
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "accel", 0, t_myo, streamAccel);
+    CLASS_ATTR_FILTER_MIN(c, "accel", 0);
+    CLASS_ATTR_FILTER_MAX(c, "accel", 1);
+    CLASS_ATTR_ACCESSORS(c, "accel", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "accel", 0, "onoff",
+                           "Enable/Disable Acceleration Output");
+
+    CLASS_ATTR_LONG(c, "gyro", 0, t_myo, streamGyro);
+    CLASS_ATTR_FILTER_MIN(c, "gyro", 0);
+    CLASS_ATTR_FILTER_MAX(c, "gyro", 1);
+    CLASS_ATTR_ACCESSORS(c, "gyro", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "gyro", 0, "onoff",
+                           "Enable/Disable Gyroscope Output");
+
+    CLASS_ATTR_LONG(c, "quat", 0, t_myo, streamQuat);
+    CLASS_ATTR_FILTER_MIN(c, "quat", 0);
+    CLASS_ATTR_FILTER_MAX(c, "quat", 1);
+    CLASS_ATTR_ACCESSORS(c, "quat", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "quat", 0, "onoff",
+                           "Enable/Disable Orientation Output");
+
+    CLASS_ATTR_LONG(c, "pose", 0, t_myo, streamPose);
+    CLASS_ATTR_FILTER_MIN(c, "pose", 0);
+    CLASS_ATTR_FILTER_MAX(c, "pose", 1);
+    CLASS_ATTR_ACCESSORS(c, "pose", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "pose", 0, "onoff", "Enable/Disable Pose Output");
+
+    // EMG buffer size
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "emgbuffer", 0, t_myo, emgBufferSize);
+    CLASS_ATTR_FILTER_MIN(c, "emgbuffer", 1);
+    CLASS_ATTR_ACCESSORS(c, "emgbuffer", NULL, (method)myoSetEmgBufferAttr);
+    CLASS_ATTR_LABEL(c, "emgbuffer", 0, "Size of the EMG Buffer (frames)");
+
+    // Output all EMG frames when queried
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "emgall", 0, t_myo, emgQueryAll);
+    CLASS_ATTR_FILTER_MIN(c, "emgall", 0);
+    CLASS_ATTR_FILTER_MAX(c, "emgall", 1);
+    CLASS_ATTR_STYLE_LABEL(c, "emgall", 0, "onoff",
+                           "Output all EMG Frames received since last bang");
+
+    // Prepend timestamps
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "timestamp", 0, t_myo, outputTimestamp);
+    CLASS_ATTR_FILTER_MIN(c, "timestamp", 0);
+    CLASS_ATTR_FILTER_MAX(c, "timestamp", 1);
+    CLASS_ATTR_STYLE_LABEL(c, "timestamp", 0, "onoff",
+                           "Prepend Timestamps (ms since connection)");
+
+    // Deferred output
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "defer", 0, t_myo, deferOutput);
+    CLASS_ATTR_FILTER_MIN(c, "defer", 0);
+    CLASS_ATTR_FILTER_MAX(c, "defer", 1);
+    CLASS_ATTR_STYLE_LABEL(c, "defer", 0, "onoff",
+                           "Output from the Max Scheduler (batched)");
+
+    // Uniform-rate output
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "resample", 0, t_myo, resampleOutput);
+    CLASS_ATTR_FILTER_MIN(c, "resample", 0);
+    CLASS_ATTR_FILTER_MAX(c, "resample", 1);
+    CLASS_ATTR_STYLE_LABEL(c, "resample", 0, "onoff",
+                           "Resample EMG at 200 Hz and IMU at 50 Hz");
+
+    // Fused output
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "fused", 0, t_myo, fusedOutput);
+    CLASS_ATTR_FILTER_MIN(c, "fused", 0);
+    CLASS_ATTR_FILTER_MAX(c, "fused", 1);
+    CLASS_ATTR_ACCESSORS(c, "fused", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "fused", 0, "onoff",
+                           "Output EMG and aligned IMU in a single list");
+
+    // Orientation format
+    // ------------------------------
+    CLASS_ATTR_SYM(c, "orientation", 0, t_myo, orientationFormat);
+    CLASS_ATTR_ENUM(c, "orientation", 0, "quat euler matrix");
+    CLASS_ATTR_ACCESSORS(c, "orientation", NULL,
+                         (method)myoSetOrientationAttr);
+    CLASS_ATTR_LABEL(c, "orientation", 0,
+                     "Orientation Output (quaternion, Euler angles, matrix)");
+
+    // Acceleration frame
+    // ------------------------------
+    CLASS_ATTR_SYM(c, "accelmode", 0, t_myo, accelMode);
+    CLASS_ATTR_ENUM(c, "accelmode", 0, "sensor world linear");
+    CLASS_ATTR_ACCESSORS(c, "accelmode", NULL, (method)myoSetAccelModeAttr);
+    CLASS_ATTR_LABEL(c, "accelmode", 0,
+                     "Acceleration Output (sensor, world or linear)");
+
+    // EMG envelope
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "envelope", 0, t_myo, emgEnvelope);
+    CLASS_ATTR_FILTER_MIN(c, "envelope", 0);
+    CLASS_ATTR_FILTER_MAX(c, "envelope", 1);
+    CLASS_ATTR_ACCESSORS(c, "envelope", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "envelope", 0, "onoff",
+                           "Output the EMG Envelope instead of EMG");
+
+    CLASS_ATTR_DOUBLE(c, "diffusion", 0, t_myo, envelopeDiffusion);
+    CLASS_ATTR_FILTER_CLIP(c, "diffusion", 0., 0.5);
+    CLASS_ATTR_LABEL(c, "diffusion", 0, "EMG Envelope Diffusion Rate");
+
+    CLASS_ATTR_DOUBLE(c, "jumprate", 0, t_myo, envelopeJumpRate);
+    CLASS_ATTR_FILTER_CLIP(c, "jumprate", 0., 1.);
+    CLASS_ATTR_LABEL(c, "jumprate", 0, "EMG Envelope Jump Rate");
+
+    // EMG features
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "features", 0, t_myo, emgFeatures);
+    CLASS_ATTR_FILTER_MIN(c, "features", 0);
+    CLASS_ATTR_FILTER_MAX(c, "features", 1);
+    CLASS_ATTR_ACCESSORS(c, "features", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "features", 0, "onoff",
+                           "Output EMG Features instead of EMG");
+
+    CLASS_ATTR_LONG(c, "window", 0, t_myo, featuresWindow);
+    CLASS_ATTR_FILTER_CLIP(c, "window", 3, FEATURES_MAX_SIZE);
+    CLASS_ATTR_LABEL(c, "window", 0, "EMG Features Window (samples)");
+
+    CLASS_ATTR_LONG(c, "hop", 0, t_myo, featuresHop);
+    CLASS_ATTR_FILTER_CLIP(c, "hop", 1, FEATURES_MAX_SIZE);
+    CLASS_ATTR_LABEL(c, "hop", 0, "EMG Features Hop (samples)");
+
+    // GMM classifier
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "gmm", 0, t_myo, gmmRun);
+    CLASS_ATTR_FILTER_MIN(c, "gmm", 0);
+    CLASS_ATTR_FILTER_MAX(c, "gmm", 1);
+    CLASS_ATTR_ACCESSORS(c, "gmm", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "gmm", 0, "onoff", "Classify EMG with the GMM");
+
+    CLASS_ATTR_LONG(c, "gmmcomponents", 0, t_myo, gmmComponents);
+    CLASS_ATTR_FILTER_CLIP(c, "gmmcomponents", 1,
+                           GmmClassifier::kMaxComponents);
+    CLASS_ATTR_LABEL(c, "gmmcomponents", 0, "GMM Components per Class");
+
+    CLASS_ATTR_LONG(c, "gmmwindow", 0, t_myo, gmmWindow);
+    CLASS_ATTR_FILTER_CLIP(c, "gmmwindow", 1, FEATURES_MAX_SIZE);
+    CLASS_ATTR_LABEL(c, "gmmwindow", 0, "GMM Likelihood Window (frames)");
+
+    // HMM follower
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "hmm", 0, t_myo, hmmRun);
+    CLASS_ATTR_FILTER_MIN(c, "hmm", 0);
+    CLASS_ATTR_FILTER_MAX(c, "hmm", 1);
+    CLASS_ATTR_ACCESSORS(c, "hmm", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "hmm", 0, "onoff",
+                           "Follow IMU Gestures with the HMM");
+
+    CLASS_ATTR_LONG(c, "hmmstates", 0, t_myo, hmmStates);
+    CLASS_ATTR_FILTER_CLIP(c, "hmmstates", 2, HMM_MAX_STATES);
+    CLASS_ATTR_LABEL(c, "hmmstates", 0, "HMM States per Template");
+
+    CLASS_ATTR_DOUBLE(c, "hmmvariance", 0, t_myo, hmmVariance);
+    CLASS_ATTR_FILTER_CLIP(c, "hmmvariance", 1e-4, 10.);
+    CLASS_ATTR_LABEL(c, "hmmvariance", 0, "HMM Relative Variance");
+
+    // GMR mapping
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "gmr", 0, t_myo, gmrRun);
+    CLASS_ATTR_FILTER_MIN(c, "gmr", 0);
+    CLASS_ATTR_FILTER_MAX(c, "gmr", 1);
+    CLASS_ATTR_ACCESSORS(c, "gmr", NULL, (method)myoSetStreamMaskAttr);
+    CLASS_ATTR_STYLE_LABEL(c, "gmr", 0, "onoff",
+                           "Map Fused Frames to Parameters with the GMR");
+
+    CLASS_ATTR_LONG(c, "gmrcomponents", 0, t_myo, gmrComponents);
+    CLASS_ATTR_FILTER_CLIP(c, "gmrcomponents", 1,
+                           GmrRegressor::kMaxComponents);
+    CLASS_ATTR_LABEL(c, "gmrcomponents", 0, "GMR Components");
+
     // Device name
     // ------------------------------
     CLASS_ATTR_SYM(c, "device", 0, t_myo, deviceName);
@@ -226,6 +942,22 @@ int C74_EXPORT main(void) {
     CLASS_ATTR_ACCESSORS(c, "device", (method)myoGetDeviceAttr,
                          (method)myoSetDeviceAttr);
 
+    // Multi-device mode
+    // ------------------------------
+    CLASS_ATTR_ATOM(c, "multi", 0, t_myo, dummy_attr_long);
+    CLASS_ATTR_ACCESSORS(c, "multi", (method)myoGetMultiAttr,
+                         (method)myoSetMultiAttr);
+    CLASS_ATTR_LABEL(c, "multi", 0,
+                     "Multi-device Mode (0: off, N devices or all)");
+
+    // Event loop slice
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "slice", 0, t_myo, hubSlice);
+    CLASS_ATTR_FILTER_MIN(c, "slice", 1);
+    CLASS_ATTR_FILTER_MAX(c, "slice", 100);
+    CLASS_ATTR_ACCESSORS(c, "slice", NULL, (method)myoSetSliceAttr);
+    CLASS_ATTR_LABEL(c, "slice", 0, "Event Loop Slice (ms, all objects)");
+
     // Keep unlocked
     // ------------------------------
     CLASS_ATTR_LONG(c, "unlock", 0, t_myo, dummy_attr_long);
@@ -252,8 +984,6 @@ void *myo_new(t_symbol *s, long argc, t_atom *argv) {
     long ac = attr_args_offset((short)argc, argv);
 
     if (self) {
-        systhread_mutex_new(&self->mutex, 0);
-
         self->outlet_info = outlet_new(self, NULL);
         self->outlet_poses = outlet_new(self, NULL);
         self->outlet_emg = outlet_new(self, NULL);
@@ -263,10 +993,50 @@ void *myo_new(t_symbol *s, long argc, t_atom *argv) {
 
         self->myoListener = NULL;
         self->myoDevice = NULL;
-        self->systhread = NULL;
+        self->myoHub = NULL;
+        self->recorder = NULL;
+        self->player = NULL;
+        self->replay_clock = clock_new(self, (method)myo_stopreplay);
+        self->gmm_clock = clock_new(self, (method)myo_gmm_install);
+        self->gmr_clock = clock_new(self, (method)myo_gmr_install);
         self->stream = false;
         self->myoPolicy_emg = true;
         self->myoPolicy_unlock = false;
+        self->emgBufferSize = EMG_BUFFER_DEFAULT_SIZE;
+        self->emgQueryAll = false;
+        self->outputTimestamp = false;
+        self->deferOutput = false;
+        self->resampleOutput = false;
+        self->fusedOutput = false;
+        self->orientationFormat = sym_quat;
+        self->accelMode = sym_sensor;
+        self->emgFeatures = false;
+        self->emgEnvelope = false;
+        self->envelopeDiffusion = 0.1;
+        self->envelopeJumpRate = 1e-10;
+        self->featuresWindow = FEATURES_WINDOW_DEFAULT;
+        self->featuresHop = FEATURES_HOP_DEFAULT;
+        self->gmmRun = false;
+        self->gmmComponents = 3;
+        self->gmmWindow = 10;
+        self->hmmRun = false;
+        self->hmmStates = 32;
+        self->hmmVariance = 0.1;
+        self->gmrRun = false;
+        self->gmrComponents = 5;
+        self->multiDevices = 0;
+        self->streamAccel = true;
+        self->streamGyro = true;
+        self->streamQuat = true;
+        self->streamPose = true;
+        self->hubSlice = 1;
+        self->latencyDisconnect = -1.;
+        self->latencyDevice = -1.;
+        self->drain_clock = clock_new(self, (method)myo_drain);
+        self->emgDroppedReported = 0;
+        self->statsEmgDroppedBase = 0;
+        self->statsSlicesBase = 0;
+        self->statsOverrunsBase = 0;
 
         self->deviceName = sym_auto;
 
@@ -275,16 +1045,15 @@ void *myo_new(t_symbol *s, long argc, t_atom *argv) {
         // get device name if object has argument
         if (ac > 0 && atom_issym(argv)) self->deviceName = atom_getsym(argv);
 
+        // Create a device listener, subscribed to the hub on connect (and
+        // also used to replay sessions without the hub)
+        self->myoListener = new MaxMyoListener(self);
+
         try {
-            // First, we create a Hub with our application identifier. Be sure
-            // not to use the com.example namespace when
-            // publishing your application. The Hub provides access to one or
-            // more Myos.
-            self->myoHub = new myo::Hub("com.julesfrancoise.maxmyo");
-
-            // Create a device listener and add is to the hub listeners
-            self->myoListener = new MaxMyoListener(self);
-            self->myoHub->addListener(self->myoListener);
+            // All objects share a single Hub and event thread: the hub is
+            // created with the first object. The Hub provides access to one
+            // or more Myos.
+            self->myoHub = SharedHub::acquire();
             self->myo_connect_running = true;
         } catch (const std::exception &e) {
             object_error((t_object *)self, e.what());
@@ -301,20 +1070,46 @@ void *myo_new(t_symbol *s, long argc, t_atom *argv) {
  * Destructor
  */
 void myo_free(t_myo *self) {
+    myo_stopreplay(self);
+    myo_stoprecord(self);
     myo_disconnect(self);
     self->myoDevice = NULL;
 
-    if (self->myoListener) {
-        self->myoHub->removeListener(self->myoListener);
-        delete self->myoListener;
+    // the training threads set the gmm and gmr clocks when done
+    if (self->myoListener && self->myoListener->gmm_thread.joinable()) {
+        self->myoListener->gmm_cancel = true;
+        self->myoListener->gmm_thread.join();
+    }
+    if (self->myoListener && self->myoListener->gmr_thread.joinable()) {
+        self->myoListener->gmr_cancel = true;
+        self->myoListener->gmr_thread.join();
+    }
+
+    if (self->drain_clock) {
+        clock_unset(self->drain_clock);
+        object_free(self->drain_clock);
+    }
+
+    if (self->replay_clock) {
+        clock_unset(self->replay_clock);
+        object_free(self->replay_clock);
     }
 
-    if (self->myoHub) {
-        self->myoHub->setLockingPolicy(myo::Hub::lockingPolicyStandard);
-        delete self->myoHub;
+    if (self->gmm_clock) {
+        clock_unset(self->gmm_clock);
+        object_free(self->gmm_clock);
     }
 
-    if (self->mutex) systhread_mutex_free(self->mutex);
+    if (self->gmr_clock) {
+        clock_unset(self->gmr_clock);
+        object_free(self->gmr_clock);
+    }
+
+    if (self->myoListener) delete self->myoListener;
+    if (self->recorder) delete self->recorder;
+    if (self->player) delete self->player;
+
+    if (self->myoHub) SharedHub::release(self->myoHub);
 }
 
 /**
@@ -324,9 +1119,13 @@ void myo_free(t_myo *self) {
 void myo_info(t_myo *self) {
     if (!self->myo_connect_running) return;
     // myo_dump_devlist(self);
-    if (self->myoDevice) {
-        self->myoDevice->requestBatteryLevel();
-        self->myoDevice->requestRssi();
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++) {
+        myo::Myo *device = self->myoListener->devices[indices[i]].myo;
+        if (!device) continue;
+        device->requestBatteryLevel();
+        device->requestRssi();
     }
 }
 
@@ -334,16 +1133,17 @@ void myo_info(t_myo *self) {
  * dumps the list of available devices
  */
 void myo_dump_devlist(t_myo *self) {
-    if (!self->myo_connect_running) return;
-    long listlen = (long)(1 + self->myoListener->connectedDevices.size());
-    t_atom *devlist = (t_atom *)sysmem_newptr(sizeof(t_atom) * listlen);
+    MaxMyoListener *listener = self->myoListener;
+    t_atom devlist[MAX_DEVICES + 1];
     atom_setsym(devlist, gensym("devices"));
     int offset = 1;
-    for (auto device : self->myoListener->connectedDevices) {
-        atom_setsym(devlist + offset, gensym(device->getName().c_str()));
+    for (int i = 0; i < listener->num_devices; i++) {
+        if (!listener->devices[i].connected) continue;
+        atom_setsym(devlist + offset,
+                    gensym(listener->devices[i].name.c_str()));
         offset++;
     }
-    outlet_list(self->outlet_info, NULL, (short)listlen, devlist);
+    outlet_list(self->outlet_info, NULL, (short)offset, devlist);
 }
 
 /**
@@ -379,134 +1179,620 @@ void myo_assist(t_myo *self, void *b, long m, long a, char *s) {
 }
 
 /**
- * Threaded function to run the event listener
+ * [bang]
+ * outputs the current frame (frames are already output as received when
+ * streaming)
+ */
+void myo_bang(t_myo *self) {
+    if (self->stream) return;
+    if (self->myoListener->followedIndex() < 0 && !self->multiDevices) return;
+    if (self->fusedOutput && !self->emgFeatures) {
+        myo_dump_fused(self);
+        return;
+    }
+    if (self->emgFeatures)
+        myo_dump_features(self);
+    else if (self->emgEnvelope)
+        myo_dump_envelope(self);
+    else
+        myo_dump_emg(self);
+    myo_dump_quat(self);
+    myo_dump_gyro(self);
+    myo_dump_accel(self);
+}
+
+/**
+ * dumps emg data: either the latest frame of each device, or all frames
+ * received since the last query (prepended with their timestamp) if emgall is
+ * enabled
  */
-void *myo_run(t_myo *self) {
-    if (!self->myo_connect_running) return NULL;
-    // We catch any exceptions that might occur below -- see the catch statement
-    // for more details.
-    try {
-        self->systhread_cancel = false;
+void myo_dump_emg(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    EmgFrame frame;
+    if (!self->emgQueryAll) {
+        while (listener->emg_buffer.pop(frame))
+            listener->emg_latest[frame.device] = frame;
+        int indices[MAX_DEVICES];
+        int count = myo_streamed_devices(self, indices);
+        for (int i = 0; i < count; i++)
+            listener->emg_value[indices[i]].read(
+                listener->emg_latest[indices[i]]);
+        for (int i = 0; i < count; i++)
+            myo_output_emg(self, listener->emg_latest[indices[i]],
+                           self->outputTimestamp);
+        return;
+    }
+    while (listener->emg_buffer.pop(frame)) {
+        listener->emg_latest[frame.device] = frame;
+        myo_output_emg(self, frame, true);
+    }
+    unsigned long dropped = listener->emg_dropped.load();
+    if (dropped != self->emgDroppedReported) {
+        self->emgDroppedReported = dropped;
+        t_atom value_out[2];
+        atom_setsym(value_out, sym_emgdropped);
+        atom_setlong(value_out + 1, static_cast<t_atom_long>(dropped));
+        outlet_list(self->outlet_info, NULL, 2, value_out);
+    }
+}
 
-        // Finally we enter our main loop.
-        while (1) {
-            // test if we're being asked to die, and if so return before we do
-            // the work
-            if (self->systhread_cancel) break;
+/**
+ * dumps acceleration data (latest frame of each device)
+ */
+void myo_dump_accel(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    Vector3Frame frame;
+    while (listener->accel_buffer.pop(frame))
+        listener->accel_latest[frame.device] = frame;
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++)
+        listener->accel_value[indices[i]].read(
+            listener->accel_latest[indices[i]]);
+    for (int i = 0; i < count; i++)
+        myo_output_accel(self, listener->accel_latest[indices[i]],
+                         self->outputTimestamp);
+}
 
-            systhread_mutex_lock(self->mutex);
+/**
+ * dumps gyro data (latest frame of each device)
+ */
+void myo_dump_gyro(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    Vector3Frame frame;
+    while (listener->gyro_buffer.pop(frame))
+        listener->gyro_latest[frame.device] = frame;
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++)
+        listener->gyro_value[indices[i]].read(
+            listener->gyro_latest[indices[i]]);
+    for (int i = 0; i < count; i++)
+        myo_output_gyro(self, listener->gyro_latest[indices[i]],
+                        self->outputTimestamp);
+}
 
-            // In each iteration of our main loop, we run the Myo event loop for
-            // a set number of milliseconds.
-            // In this case, we wish to update our display 50 times a second, so
-            // we run for 1000/20 milliseconds.
-            self->myoHub->run(20);
+/**
+ * dumps orientation data (latest frame of each device)
+ */
+void myo_dump_quat(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    QuaternionFrame frame;
+    while (listener->quat_buffer.pop(frame))
+        listener->quat_latest[frame.device] = frame;
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++)
+        listener->quat_value[indices[i]].read(
+            listener->quat_latest[indices[i]]);
+    for (int i = 0; i < count; i++)
+        myo_output_quat(self, listener->quat_latest[indices[i]],
+                        self->outputTimestamp);
+}
 
-            systhread_mutex_unlock(self->mutex);
-        }
+/**
+ * dumps fused data (@fused 1), as EMG data
+ */
+void myo_dump_fused(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    FusedFrame frame;
+    if (!self->emgQueryAll) {
+        while (listener->fused_buffer.pop(frame))
+            listener->fused_latest[frame.device] = frame;
+        int indices[MAX_DEVICES];
+        int count = myo_streamed_devices(self, indices);
+        for (int i = 0; i < count; i++)
+            listener->fused_value[indices[i]].read(
+                listener->fused_latest[indices[i]]);
+        for (int i = 0; i < count; i++)
+            myo_output_fused(self, listener->fused_latest[indices[i]],
+                             self->outputTimestamp);
+        return;
+    }
+    while (listener->fused_buffer.pop(frame)) {
+        listener->fused_latest[frame.device] = frame;
+        myo_output_fused(self, frame, true);
+    }
+}
 
-        self->listenerRunning = false;
-        self->systhread_cancel = false;
-        systhread_exit(0);  // this can return a value to systhread_join();
-        return NULL;
-    } catch (const std::exception &e) {
-        self->listenerRunning = false;
-        object_error((t_object *)self, e.what());
+/**
+ * dumps EMG features (@features 1), as EMG data
+ */
+void myo_dump_features(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    EmgFeatureFrame frame;
+    if (!self->emgQueryAll) {
+        while (listener->features_buffer.pop(frame))
+            listener->features_latest[frame.device] = frame;
+        int indices[MAX_DEVICES];
+        int count = myo_streamed_devices(self, indices);
+        for (int i = 0; i < count; i++)
+            listener->features_value[indices[i]].read(
+                listener->features_latest[indices[i]]);
+        for (int i = 0; i < count; i++)
+            myo_output_features(self, listener->features_latest[indices[i]],
+                                self->outputTimestamp);
+        return;
+    }
+    while (listener->features_buffer.pop(frame)) {
+        listener->features_latest[frame.device] = frame;
+        myo_output_features(self, frame, true);
     }
+}
 
-    return NULL;
+/**
+ * dumps the EMG envelope (@envelope 1), as EMG data
+ */
+void myo_dump_envelope(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    EnvelopeFrame frame;
+    if (!self->emgQueryAll) {
+        while (listener->envelope_buffer.pop(frame))
+            listener->envelope_latest[frame.device] = frame;
+        int indices[MAX_DEVICES];
+        int count = myo_streamed_devices(self, indices);
+        for (int i = 0; i < count; i++)
+            listener->envelope_value[indices[i]].read(
+                listener->envelope_latest[indices[i]]);
+        for (int i = 0; i < count; i++)
+            myo_output_envelope(self, listener->envelope_latest[indices[i]],
+                                self->outputTimestamp);
+        return;
+    }
+    while (listener->envelope_buffer.pop(frame)) {
+        listener->envelope_latest[frame.device] = frame;
+        myo_output_envelope(self, frame, true);
+    }
 }
 
 /**
- * [bang]
- * outputs the current frame
+ * fills indices with the indices of the devices whose data is output (the
+ * current device, or the connected devices in multi-device mode), returns
+ * the number of devices
  */
-void myo_bang(t_myo *self) {
-    if (!self->myo_connect_running) return;
-    if (self->myoDevice) {
-        myo_dump_emg(self);
-        myo_dump_quat(self);
-        myo_dump_gyro(self);
-        myo_dump_accel(self);
+int myo_streamed_devices(t_myo *self, int *indices) {
+    MaxMyoListener *listener = self->myoListener;
+    int count = 0;
+    if (!self->multiDevices) {
+        int index = listener->followedIndex();
+        if (index >= 0) indices[count++] = index;
+        return count;
     }
+    for (int i = 0; i < listener->num_devices; i++) {
+        if (listener->devices[i].connected &&
+            (self->multiDevices < 0 || i < self->multiDevices))
+            indices[count++] = i;
+    }
+    return count;
 }
 
 /**
- * dumps emg data
+ * true if the object receives frames, from the hub or from a replayed
+ * session (see MyoLock), otherwise posts an error for the message
  */
-void myo_dump_emg(t_myo *self) {
-    t_atom value_out[8];
+bool myo_has_source(t_myo *self, const char *message) {
+    if (self->myo_connect_running || self->myoListener->replaying)
+        return true;
+    object_error((t_object *)self,
+                 "%s: Myo Connect is not running and no session is replayed",
+                 message);
+    return false;
+}
+
+/**
+ * converts a hardware timestamp (us) to milliseconds since the connection of
+ * the device
+ */
+double myo_timestamp_ms(t_myo *self, int device, uint64_t timestamp) {
+    uint64_t origin =
+        self->myoListener->devices[device].connection_timestamp.load();
+    if (origin == 0 || timestamp < origin) return 0.;
+    return static_cast<double>(timestamp - origin) / 1000.;
+}
+
+/**
+ * outputs a frame of emg data, optionally prepended with its timestamp in
+ * milliseconds since connection (and with the device index in multi-device
+ * mode)
+ */
+void myo_output_emg(t_myo *self, EmgFrame const &frame, bool timestamp) {
+    t_atom value_out[10];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
     for (int j = 0; j < 8; j++) {
-        atom_setfloat(
-            value_out + j,
-            self->myoListener
-                ->emg_frames[self->myoListener->num_emg_frames - 1][j]);
-    }
-    if (self->myoListener->num_emg_frames > 1) {
-        self->myoListener->num_emg_frames--;
+        atom_setfloat(values + j,
+                      static_cast<float>(frame.values[j]) / (float)127.);
     }
-    outlet_list(self->outlet_emg, NULL, 8, value_out);
+    outlet_list(self->outlet_emg, NULL, (short)(values - value_out) + 8,
+                value_out);
 }
 
 /**
- * dumps acceleration data
+ * outputs a fused frame from the EMG outlet: EMG (8), acceleration (3),
+ * gyroscope (3) and orientation (4), optionally prepended with the device
+ * index and timestamp as EMG frames
  */
-void myo_dump_accel(t_myo *self) {
-    t_atom value_out[3];
+void myo_output_fused(t_myo *self, FusedFrame const &frame, bool timestamp) {
+    t_atom value_out[20];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    for (int j = 0; j < 18; j++) atom_setfloat(values + j, frame.values[j]);
+    outlet_list(self->outlet_emg, NULL, (short)(values - value_out) + 18,
+                value_out);
+}
+
+/**
+ * outputs EMG features from the EMG outlet: RMS (8), MAV (8), waveform length
+ * (8), zero crossings (8) and slope sign changes (8), optionally prepended
+ * with the device index and timestamp as EMG frames
+ */
+void myo_output_features(t_myo *self, EmgFeatureFrame const &frame,
+                         bool timestamp) {
+    t_atom value_out[42];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    for (int j = 0; j < EmgFeatures::kSize; j++)
+        atom_setfloat(values + j, frame.values[j]);
+    outlet_list(self->outlet_emg, NULL,
+                (short)(values - value_out) + EmgFeatures::kSize, value_out);
+}
+
+/**
+ * outputs a frame of the EMG envelope from the EMG outlet
+ */
+void myo_output_envelope(t_myo *self, EnvelopeFrame const &frame,
+                         bool timestamp) {
+    t_atom value_out[10];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    for (int j = 0; j < 8; j++) atom_setfloat(values + j, frame.values[j]);
+    outlet_list(self->outlet_emg, NULL, (short)(values - value_out) + 8,
+                value_out);
+}
+
+/**
+ * outputs a frame of acceleration data
+ */
+void myo_output_accel(t_myo *self, Vector3Frame const &frame, bool timestamp) {
+    t_atom value_out[5];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
     for (int j = 0; j < 3; j++) {
-        atom_setfloat(value_out + j, self->myoListener->acceleration[j]);
+        atom_setfloat(values + j, frame.values[j]);
     }
-    outlet_list(self->outlet_accel, NULL, 3, value_out);
+    outlet_list(self->outlet_accel, NULL, (short)(values - value_out) + 3,
+                value_out);
 }
 
 /**
- * dumps gyro data
+ * outputs a frame of gyro data
  */
-void myo_dump_gyro(t_myo *self) {
-    t_atom value_out[3];
+void myo_output_gyro(t_myo *self, Vector3Frame const &frame, bool timestamp) {
+    t_atom value_out[5];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
     for (int j = 0; j < 3; j++) {
-        atom_setfloat(value_out + j, self->myoListener->gyroscopes[j]);
+        atom_setfloat(values + j, frame.values[j]);
     }
-    outlet_list(self->outlet_gyro, NULL, 3, value_out);
+    outlet_list(self->outlet_gyro, NULL, (short)(values - value_out) + 3,
+                value_out);
 }
 
 /**
- * dumps orientation data (quaternions)
+ * outputs a frame of orientation data (quaternions)
  */
-void myo_dump_quat(t_myo *self) {
-    t_atom value_out[4];
-    for (int j = 0; j < 4; j++) {
-        atom_setfloat(value_out + j, self->myoListener->quaternions[j]);
+void myo_output_quat(t_myo *self, QuaternionFrame const &frame,
+                     bool timestamp) {
+    t_atom value_out[11];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (timestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    float converted[9];
+    int size = 4;
+    if (self->orientationFormat == sym_euler) {
+        eulerAngles(toQuaternion(frame.values.data()), converted);
+        size = 3;
+    } else if (self->orientationFormat == sym_matrix) {
+        rotationMatrix(toQuaternion(frame.values.data()), converted);
+        size = 9;
+    } else {
+        std::copy(frame.values.begin(), frame.values.end(), converted);
+    }
+    for (int j = 0; j < size; j++) {
+        atom_setfloat(values + j, converted[j]);
+    }
+    outlet_list(self->outlet_quat, NULL, (short)(values - value_out) + size,
+                value_out);
+}
+
+/**
+ * outputs an info event (connection, arm sync, RSSI, battery or pose)
+ */
+void myo_output_event(t_myo *self, InfoEvent const &event) {
+    t_atom value_out[7];
+    t_atom *values = value_out;
+    if (event.type != InfoEvent::Pose) {
+        // info messages: the device index follows the message selector
+        values++;
+        if (self->multiDevices) atom_setlong(values++, event.device);
+    }
+    switch (event.type) {
+        case InfoEvent::Connect:
+        case InfoEvent::Disconnect:
+            if (!self->multiDevices) {
+                onMaxMyoSync(self);
+            } else {
+                DeviceState const &device =
+                    self->myoListener->devices[event.device];
+                atom_setsym(value_out, sym_connected);
+                if (event.type == InfoEvent::Connect)
+                    atom_setsym(values, gensym(device.name.c_str()));
+                else
+                    atom_setlong(values, 0);
+                outlet_list(self->outlet_info, NULL,
+                            (short)(values - value_out) + 1, value_out);
+            }
+            if (event.type == InfoEvent::Connect) myo_dump_devlist(self);
+            break;
+
+        case InfoEvent::ArmSync:
+            atom_setsym(value_out, sym_armsync);
+            atom_setlong(values, 1);
+            if (event.values[0] == myo::armLeft) {
+                atom_setsym(values + 1, gensym("Left"));
+            } else if (event.values[0] == myo::armRight) {
+                atom_setsym(values + 1, gensym("Right"));
+            } else {
+                atom_setsym(values + 1, gensym("Unknown"));
+            }
+            if (event.values[1] == myo::xDirectionTowardWrist) {
+                atom_setsym(values + 2, gensym("TowardWrist"));
+            } else if (event.values[1] == myo::xDirectionTowardElbow) {
+                atom_setsym(values + 2, gensym("TowardElbow"));
+            } else {
+                atom_setsym(values + 2, gensym("Unknown"));
+            }
+            atom_setfloat(values + 3, event.rotation);
+            if (event.values[2] == myo::warmupStateCold) {
+                atom_setsym(values + 4, gensym("Cold"));
+            } else if (event.values[2] == myo::warmupStateWarm) {
+                atom_setsym(values + 4, gensym("Warm"));
+            } else {
+                atom_setsym(values + 4, gensym("Unknown"));
+            }
+            outlet_list(self->outlet_info, NULL,
+                        (short)(values - value_out) + 5, value_out);
+            break;
+
+        case InfoEvent::ArmUnsync:
+            atom_setsym(value_out, sym_armsync);
+            atom_setlong(values, 0);
+            outlet_list(self->outlet_info, NULL,
+                        (short)(values - value_out) + 1, value_out);
+            break;
+
+        case InfoEvent::Rssi:
+            atom_setsym(value_out, sym_rssi);
+            atom_setlong(values, event.values[0]);
+            outlet_list(self->outlet_info, NULL,
+                        (short)(values - value_out) + 1, value_out);
+            break;
+
+        case InfoEvent::Battery:
+            atom_setsym(value_out, sym_battery);
+            atom_setlong(values, event.values[0]);
+            outlet_list(self->outlet_info, NULL,
+                        (short)(values - value_out) + 1, value_out);
+            break;
+
+        case InfoEvent::Pose:
+            if (self->multiDevices) atom_setlong(values++, event.device);
+            if (self->outputTimestamp)
+                atom_setfloat(values++, myo_timestamp_ms(self, event.device,
+                                                         event.timestamp));
+            atom_setsym(values,
+                        gensym(myo::Pose(static_cast<myo::Pose::Type>(
+                                             event.values[0]))
+                                   .toString()
+                                   .c_str()));
+            outlet_list(self->outlet_poses, NULL,
+                        (short)(values - value_out) + 1, value_out);
+            break;
+    }
+}
+
+/**
+ * outputs a GMM classification result on the poses outlet: likeliest label
+ * and normalized likelihoods of the classes
+ */
+void myo_output_class(t_myo *self, ClassFrame const &frame) {
+    std::vector<t_symbol *> const &labels = self->myoListener->gmm_labels;
+    // result of a replaced model
+    if (frame.classes != labels.size()) return;
+    t_atom value_out[3 + GmmClassifier::kMaxClasses];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (self->outputTimestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    atom_setsym(values++, labels[frame.likeliest]);
+    for (int c = 0; c < frame.classes; c++)
+        atom_setfloat(values++, frame.likelihoods[c]);
+    outlet_list(self->outlet_poses, NULL, (short)(values - value_out),
+                value_out);
+}
+
+/**
+ * outputs an HMM following result on the poses outlet: likeliest label,
+ * normalized likelihoods and time progressions of the classes
+ */
+void myo_output_follow(t_myo *self, FollowFrame const &frame) {
+    std::vector<t_symbol *> const &labels = self->myoListener->hmm_labels;
+    // result of a replaced model
+    if (frame.classes != labels.size()) return;
+    t_atom value_out[3 + 2 * HmmModel::kMaxClasses];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (self->outputTimestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    atom_setsym(values++, labels[frame.likeliest]);
+    for (int c = 0; c < frame.classes; c++)
+        atom_setfloat(values++, frame.likelihoods[c]);
+    for (int c = 0; c < frame.classes; c++)
+        atom_setfloat(values++, frame.progressions[c]);
+    outlet_list(self->outlet_poses, NULL, (short)(values - value_out),
+                value_out);
+}
+
+/**
+ * outputs a GMR result on the poses outlet: [gmr <values>]
+ */
+void myo_output_regression(t_myo *self, RegressionFrame const &frame) {
+    // result of a replaced model
+    if (frame.outputs != self->myoListener->gmr_outputs) return;
+    t_atom value_out[3 + GmrRegressor::kMaxOutputs];
+    t_atom *values = value_out;
+    if (self->multiDevices) atom_setlong(values++, frame.device);
+    if (self->outputTimestamp)
+        atom_setfloat(values++,
+                      myo_timestamp_ms(self, frame.device, frame.timestamp));
+    atom_setsym(values++, sym_gmr);
+    for (int o = 0; o < frame.outputs; o++)
+        atom_setfloat(values++, frame.values[o]);
+    outlet_list(self->outlet_poses, NULL, (short)(values - value_out),
+                value_out);
+}
+
+/**
+ * Deferred mode: outputs all events queued by the hub thread since the last
+ * call, from the Max scheduler.
+ */
+void myo_drain(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    if (!listener) return;
+    // events pushed from now on will set the clock again
+    listener->drain_pending = false;
+
+    InfoEvent event;
+    while (listener->info_buffer.pop(event)) myo_output_event(self, event);
+    ClassFrame class_frame;
+    while (listener->gmm_buffer.pop(class_frame))
+        myo_output_class(self, class_frame);
+    FollowFrame follow_frame;
+    while (listener->hmm_buffer.pop(follow_frame))
+        myo_output_follow(self, follow_frame);
+    RegressionFrame regression_frame;
+    while (listener->gmr_buffer.pop(regression_frame))
+        myo_output_regression(self, regression_frame);
+
+    // when not streaming, frames stay in the buffers until queried
+    if (!self->stream) return;
+    EnvelopeFrame envelope_frame;
+    while (listener->envelope_buffer.pop(envelope_frame)) {
+        listener->envelope_latest[envelope_frame.device] = envelope_frame;
+        myo_output_envelope(self, envelope_frame, self->outputTimestamp);
+    }
+    EmgFeatureFrame features_frame;
+    while (listener->features_buffer.pop(features_frame)) {
+        listener->features_latest[features_frame.device] = features_frame;
+        myo_output_features(self, features_frame, self->outputTimestamp);
+    }
+    FusedFrame fused_frame;
+    while (listener->fused_buffer.pop(fused_frame)) {
+        listener->fused_latest[fused_frame.device] = fused_frame;
+        myo_output_fused(self, fused_frame, self->outputTimestamp);
+    }
+    EmgFrame emg_frame;
+    while (listener->emg_buffer.pop(emg_frame)) {
+        listener->emg_latest[emg_frame.device] = emg_frame;
+        myo_output_emg(self, emg_frame, self->outputTimestamp);
+    }
+    QuaternionFrame quat_frame;
+    while (listener->quat_buffer.pop(quat_frame)) {
+        listener->quat_latest[quat_frame.device] = quat_frame;
+        myo_output_quat(self, quat_frame, self->outputTimestamp);
+    }
+    Vector3Frame vector_frame;
+    while (listener->gyro_buffer.pop(vector_frame)) {
+        listener->gyro_latest[vector_frame.device] = vector_frame;
+        myo_output_gyro(self, vector_frame, self->outputTimestamp);
+    }
+    while (listener->accel_buffer.pop(vector_frame)) {
+        listener->accel_latest[vector_frame.device] = vector_frame;
+        myo_output_accel(self, vector_frame, self->outputTimestamp);
     }
-    outlet_list(self->outlet_quat, NULL, 4, value_out);
 }
 
 /**
  * [connect]
- * starts the listener thread to connect to available myos
+ * subscribes to the shared hub (starts the hub thread if needed)
  */
 void myo_connect(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
     if (self->listenerRunning || !self->myo_connect_running) return;
-    if (self->systhread == NULL) {
-        self->listenerRunning = true;
-        systhread_create((method)myo_run, self, 0, 0, 0, &self->systhread);
+    myo_stopreplay(self);
+    std::string error = self->myoHub->error();
+    if (!error.empty()) object_error((t_object *)self, error.c_str());
+    self->listenerRunning = true;
+    {
+        MyoLock lock(self);
+        self->myoHub->setEventMask(self->myoListener, myo_event_mask(self));
     }
+    self->myoHub->subscribe(self->myoListener);
 }
 
 /**
  * [disconnect]
- * disconnect from sensors (stops listener thread)
+ * disconnect from sensors (unsubscribes from the shared hub, the hub thread
+ * stops with the last object)
  */
 void myo_disconnect(t_myo *self) {
-    if (!self->myo_connect_running) return;
-    unsigned int ret;
-    if (self->systhread) {
-        // object_post((t_object *)self, "stopping thread");
-        self->systhread_cancel = true;          // tell the thread to stop
-        systhread_join(self->systhread, &ret);  // wait for the thread to stop
-        self->systhread = NULL;
-        self->listenerRunning = false;
-    }
+    if (!self->myo_connect_running || !self->listenerRunning) return;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    self->myoHub->unsubscribe(self->myoListener);
+    self->listenerRunning = false;
+    self->latencyDisconnect = myo_elapsed_ms(start);
 }
 
 /**
@@ -549,94 +1835,927 @@ void myo_vibrate(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
     }
 }
 
-#if defined(MAC_VERSION)
-#pragma mark -
-#pragma mark Attributes
-#endif
 /**
- * [stream 0/1]
- * set streaming attribute (sensor data streamed as received)
+ * [latency]
+ * outputs the duration of the last disconnect and device switch in ms (-1 if
+ * none), i.e. the time for these operations to take effect on the hub thread
  */
-t_max_err myoSetStreamAttr(t_myo *self, void *attr, long ac, t_atom *av) {
-    if (ac > 0 && atom_isnum(av)) {
-        self->stream = atom_getlong(av) != 0;
-    } else
-        object_error((t_object *)self,
-                     "missing or invalid arguments for stream");
-
-    return MAX_ERR_NONE;
+void myo_latency(t_myo *self) {
+    t_atom value_out[3];
+    atom_setsym(value_out, sym_latency);
+    atom_setsym(value_out + 1, sym_disconnect);
+    atom_setfloat(value_out + 2, self->latencyDisconnect);
+    outlet_list(self->outlet_info, NULL, 3, value_out);
+    atom_setsym(value_out + 1, sym_device);
+    atom_setfloat(value_out + 2, self->latencyDevice);
+    outlet_list(self->outlet_info, NULL, 3, value_out);
 }
 
 /**
- * get streaming attribute (sensor data streamed as received)
+ * [stats]
+ * outputs the counters of the object on the info outlet:
+ * - stats events <emg> <accel> <gyro> <quat> <pose> <info>: events received
+ * - stats emgdropped <n>: EMG frames dropped because the EMG buffer was full
+ * - stats lost <emg> <imu>: EMG samples and IMU frames lost on the link,
+ *   inferred from the hardware timestamps
+ * - stats callback <mean> <max>: duration of the hub callbacks (us)
+ * - stats queue <buffer> <max> <size> <dropped>: for each buffer between the
+ *   hub thread and Max (emg, accel, gyro, quat, info, fused, features,
+ *   envelope, gmm, hmm, gmr), high-water mark, size, and frames or events
+ *   dropped because it was full
+ * - stats slices <n> <overruns>: slices of the hub event loop (shared by all
+ *   objects), and slices blocked by callbacks for more than 1 ms longer than
+ *   @slice
+ * [stats reset] resets the counters
  */
-t_max_err myoGetStreamAttr(t_myo *self, t_object *attr, long *ac, t_atom **av) {
-    if ((*ac) == 0 || (*av) == NULL) {
-        // otherwise allocate memory
-        *ac = 1;
-
-        if (!(*av = (t_atom *)getbytes(sizeof(t_atom) * (*ac)))) {
-            *ac = 0;
-            return MAX_ERR_OUT_OF_MEM;
+void myo_stats(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    MaxMyoListener *listener = self->myoListener;
+    SharedHub *hub = self->myoHub;
+    ListenerStats &stats = listener->stats;
+    if (argc > 0 && atom_getsym(argv) == sym_reset) {
+        stats.reset();
+        self->statsEmgDroppedBase = listener->emg_dropped.load();
+        if (hub) {
+            self->statsSlicesBase = hub->slices();
+            self->statsOverrunsBase = hub->overruns();
         }
+        return;
     }
 
-    atom_setlong(*av, self->stream);
-    return MAX_ERR_NONE;
+    t_atom value_out[8];
+    atom_setsym(value_out, sym_stats);
+
+    atom_setsym(value_out + 1, sym_events);
+    for (int i = 0; i < ListenerStats::NumStreams; i++)
+        atom_setlong(value_out + 2 + i,
+                     static_cast<t_atom_long>(stats.events[i].get()));
+    outlet_list(self->outlet_info, NULL, 2 + ListenerStats::NumStreams,
+                value_out);
+
+    atom_setsym(value_out + 1, sym_emgdropped);
+    atom_setlong(value_out + 2, static_cast<t_atom_long>(
+                                    listener->emg_dropped.load() -
+                                    self->statsEmgDroppedBase));
+    outlet_list(self->outlet_info, NULL, 3, value_out);
+
+    atom_setsym(value_out + 1, sym_lost);
+    atom_setlong(value_out + 2,
+                 static_cast<t_atom_long>(stats.emg_lost.get()));
+    atom_setlong(value_out + 3,
+                 static_cast<t_atom_long>(stats.imu_lost.get()));
+    outlet_list(self->outlet_info, NULL, 4, value_out);
+
+    uint64_t callbacks = stats.callbacks.get();
+    atom_setsym(value_out + 1, sym_callback);
+    atom_setfloat(value_out + 2,
+                  callbacks ? 1e-3 * stats.callback_total_ns.get() / callbacks
+                            : 0.);
+    atom_setfloat(value_out + 3, 1e-3 * stats.callback_max_ns.get());
+    outlet_list(self->outlet_info, NULL, 4, value_out);
+
+    static const char *queue_names[ListenerStats::NumQueues] = {
+        "emg",      "accel",    "gyro", "quat", "info", "fused",
+        "features", "envelope", "gmm",  "hmm",  "gmr"};
+    std::size_t capacities[ListenerStats::NumQueues] = {
+        listener->emg_buffer.capacity(),
+        listener->accel_buffer.capacity(),
+        listener->gyro_buffer.capacity(),
+        listener->quat_buffer.capacity(),
+        listener->info_buffer.capacity(),
+        listener->fused_buffer.capacity(),
+        listener->features_buffer.capacity(),
+        listener->envelope_buffer.capacity(),
+        listener->gmm_buffer.capacity(),
+        listener->hmm_buffer.capacity(),
+        listener->gmr_buffer.capacity()};
+    atom_setsym(value_out + 1, sym_queue);
+    for (int i = 0; i < ListenerStats::NumQueues; i++) {
+        atom_setsym(value_out + 2, gensym(queue_names[i]));
+        atom_setlong(value_out + 3,
+                     static_cast<t_atom_long>(stats.queue_max[i].get()));
+        atom_setlong(value_out + 4, static_cast<t_atom_long>(capacities[i]));
+        atom_setlong(value_out + 5,
+                     static_cast<t_atom_long>(stats.dropped[i].get()));
+        outlet_list(self->outlet_info, NULL, 6, value_out);
+    }
+
+    atom_setsym(value_out + 1, sym_slices);
+    atom_setlong(value_out + 2,
+                 hub ? static_cast<t_atom_long>(hub->slices() -
+                                                self->statsSlicesBase)
+                     : 0);
+    atom_setlong(value_out + 3,
+                 hub ? static_cast<t_atom_long>(hub->overruns() -
+                                                self->statsOverrunsBase)
+                     : 0);
+    outlet_list(self->outlet_info, NULL, 4, value_out);
 }
 
 /**
- * [emg 0/1]
- * specifies if the raw emg data should be streamed
+ * [mvc start], [mvc stop]
+ * calibrates the maximum voluntary contraction (MVC) of each channel: the
+ * envelope (@envelope 1) is output relative to the MVC. Between start and
+ * stop, the peak envelope of each channel of the streamed devices is
+ * recorded, and becomes their MVC.
+ * [mvc <8 values>] sets the MVC of all devices (in [0, 1] of full scale),
+ * [mvc reset] resets it to 1, [mvc] outputs the MVC of the streamed devices
  */
-t_max_err myoSetStreamEmgAttr(t_myo *self, void *attr, long ac, t_atom *av) {
-    if (ac > 0 && atom_isnum(av)) {
-        self->myoPolicy_emg = atom_getlong(av) != 0;
-        if (!self->myo_connect_running) return MAX_ERR_NONE;
-        if (self->myoDevice) {
-            if (self->myoPolicy_emg)
-                self->myoDevice->setStreamEmg(myo::Myo::streamEmgEnabled);
-            else
-                self->myoDevice->setStreamEmg(myo::Myo::streamEmgDisabled);
+void myo_mvc(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "mvc")) return;
+    MaxMyoListener *listener = self->myoListener;
+    t_symbol *command = (argc > 0 && atom_issym(argv)) ? atom_getsym(argv)
+                                                       : NULL;
+    if (command == sym_start) {
+        if (!self->emgEnvelope)
+            object_warn((t_object *)self,
+                        "mvc calibration requires @envelope 1");
+        {
+            MyoLock lock(self);
+            for (int i = 0; i < MAX_DEVICES; i++)
+                listener->mvc_peak[i].fill(0.f);
         }
-    } else
-        object_error((t_object *)self, "missing or invalid arguments for emg");
+        listener->mvc_calibrating = true;
+        return;
+    }
+    if (command == sym_stop) {
+        if (!listener->mvc_calibrating) return;
+        listener->mvc_calibrating = false;
+        MyoLock lock(self);
+        int indices[MAX_DEVICES];
+        int count = myo_streamed_devices(self, indices);
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < 8; j++) {
+                float peak = listener->mvc_peak[indices[i]][j];
+                if (peak > 0.f) listener->mvc[indices[i]][j] = peak;
+            }
+        }
+        return;
+    }
+    if (command == sym_reset || (argc >= 8 && !command)) {
+        MyoLock lock(self);
+        for (int i = 0; i < MAX_DEVICES; i++) {
+            for (int j = 0; j < 8; j++) {
+                float value =
+                    command ? 1.f : static_cast<float>(atom_getfloat(argv + j));
+                listener->mvc[i][j] = value > 1e-3f ? value : 1e-3f;
+            }
+        }
+        return;
+    }
+    if (argc > 0) {
+        object_error((t_object *)self,
+                     "mvc: expected start, stop, reset or 8 values");
+        return;
+    }
 
-    return MAX_ERR_NONE;
+    t_atom value_out[10];
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++) {
+        t_atom *values = value_out;
+        atom_setsym(values++, sym_mvc);
+        if (self->multiDevices) atom_setlong(values++, indices[i]);
+        for (int j = 0; j < 8; j++)
+            atom_setfloat(values++, listener->mvc[indices[i]][j]);
+        outlet_list(self->outlet_info, NULL, (short)(values - value_out),
+                    value_out);
+    }
 }
 
 /**
- * specifies if the raw emg data should be streamed
+ * [gmm record <label>], [gmm stop]
+ * records training frames of a class: the input of the classifier (EMG in
+ * [-1, 1], the envelope with @envelope 1 or the features with @features 1)
+ * of the streamed devices is appended to the frames of the class until stop.
+ * [gmm train] trains a Gaussian mixture of @gmmcomponents components per
+ * class in the background, and outputs [gmm trained <labels>] once the model
+ * classifies the input (@gmm 1). [gmm clear] clears the training frames,
+ * [gmm] outputs the number of frames of each class.
  */
-t_max_err myoGetStreamEmgAttr(t_myo *self, t_object *attr, long *ac,
-                              t_atom **av) {
-    if ((*ac) == 0 || (*av) == NULL) {
-        // otherwise allocate memory
-        *ac = 1;
-
-        if (!(*av = (t_atom *)getbytes(sizeof(t_atom) * (*ac)))) {
-            *ac = 0;
-            return MAX_ERR_OUT_OF_MEM;
+void myo_gmm(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "gmm")) return;
+    MaxMyoListener *listener = self->myoListener;
+    t_symbol *command = (argc > 0 && atom_issym(argv)) ? atom_getsym(argv)
+                                                       : NULL;
+    if (command == sym_record) {
+        if (argc < 2) {
+            object_error((t_object *)self, "gmm record: missing label");
+            return;
         }
+        t_symbol *label = myo_label(argv + 1);
+        MyoLock lock(self);
+        TrainingSet &data = listener->gmm_data;
+        if (data.labels.size() >= GmmClassifier::kMaxClasses &&
+            data.index(label->s_name) < 0) {
+            object_error((t_object *)self, "gmm record: at most %d classes",
+                         GmmClassifier::kMaxClasses);
+            return;
+        }
+        listener->gmm_label = data.add(label->s_name);
+        return;
+    }
+    if (command == sym_stop) {
+        MyoLock lock(self);
+        listener->gmm_label = -1;
+        return;
+    }
+    if (command == sym_clear) {
+        MyoLock lock(self);
+        listener->gmm_data.clear();
+        listener->gmm_label = -1;
+        return;
+    }
+    if (command == sym_train) {
+        if (listener->gmm_thread.joinable()) {
+            object_error((t_object *)self, "gmm train: already training");
+            return;
+        }
+        TrainingSet data;
+        {
+            MyoLock lock(self);
+            data = listener->gmm_data;
+        }
+        if (data.labels.empty()) {
+            object_error((t_object *)self, "gmm train: no training frames");
+            return;
+        }
+        listener->gmm_cancel = false;
+        listener->gmm_thread = std::thread(myo_gmm_train, self,
+                                           std::move(data),
+                                           self->gmmComponents);
+        return;
+    }
+    if (argc > 0) {
+        object_error((t_object *)self,
+                     "gmm: expected record <label>, stop, train or clear");
+        return;
     }
 
-    atom_setlong(*av, self->myoPolicy_emg);
-    return MAX_ERR_NONE;
+    MyoLock lock(self);
+    TrainingSet const &data = listener->gmm_data;
+    t_atom value_out[3];
+    for (std::size_t c = 0; c < data.labels.size(); c++) {
+        atom_setsym(value_out, sym_gmm);
+        atom_setsym(value_out + 1, gensym(data.labels[c].c_str()));
+        atom_setlong(value_out + 2, data.dimension ? data.data[c].size() /
+                                                         data.dimension
+                                                   : 0);
+        outlet_list(self->outlet_info, NULL, 3, value_out);
+    }
 }
 
 /**
- * [unlock 0/1]
- * specifies if the Myo is unlocked for pose recognition
+ * trains a GMM classifier (training thread), and sets the gmm clock to
+ * install it
  */
-t_max_err myoSetUnlockAttr(t_myo *self, void *attr, long ac, t_atom *av) {
-    if (ac > 0 && atom_isnum(av)) {
-        self->myoPolicy_unlock = atom_getlong(av) != 0;
-        if (!self->myo_connect_running) return MAX_ERR_NONE;
-        if (self->myoPolicy_unlock && self->myo_connect_running)
-            self->myoHub->setLockingPolicy(myo::Hub::lockingPolicyNone);
-        else
-            self->myoHub->setLockingPolicy(myo::Hub::lockingPolicyStandard);
-    } else
+void myo_gmm_train(t_myo *self, TrainingSet data, long components) {
+    MaxMyoListener *listener = self->myoListener;
+    std::unique_ptr<GmmClassifier> model(new GmmClassifier);
+    listener->gmm_error =
+        model->train(data, static_cast<int>(components), &listener->gmm_cancel);
+    listener->gmm_trained = std::move(model);
+    clock_delay(self->gmm_clock, 0);
+}
+
+/**
+ * installs the GMM classifier trained in the background (gmm clock)
+ */
+void myo_gmm_install(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    if (!listener->gmm_thread.joinable()) return;
+    listener->gmm_thread.join();
+    if (!listener->gmm_error.empty()) {
+        object_error((t_object *)self, "gmm train: %s",
+                     listener->gmm_error.c_str());
+        listener->gmm_trained.reset();
+        return;
+    }
+    GmmClassifier const &model = *listener->gmm_trained;
+    std::vector<t_symbol *> labels;
+    for (int c = 0; c < model.classes(); c++)
+        labels.push_back(gensym(model.label(c).c_str()));
+    if (model.dimension() != (self->emgFeatures ? EmgFeatures::kSize : 8))
+        object_warn((t_object *)self,
+                    "gmm trained on %d values: the current input has %d",
+                    model.dimension(),
+                    self->emgFeatures ? EmgFeatures::kSize : 8);
+    {
+        MyoLock lock(self);
+        listener->gmm = std::move(listener->gmm_trained);
+        listener->gmm_labels = labels;
+        for (int i = 0; i < MAX_DEVICES; i++)
+            listener->gmm_window[i].configure(model.classes(),
+                                              self->gmmWindow);
+    }
+    myo_output_labels(self, sym_gmm, labels);
+}
+
+/**
+ * [hmm record <label>], [hmm stop]
+ * records the IMU template of a gesture: acceleration, gyroscope and
+ * orientation of the streamed devices (at the IMU rate, resampled with
+ * @resample 1) replace the template of the class until stop. The templates
+ * are then followed (@hmm 1), and [hmm trained <labels>] is output.
+ * [hmm train] rebuilds the model (e.g. after setting @hmmstates or
+ * @hmmvariance), [hmm reset] restarts the following, [hmm clear] removes
+ * all templates, [hmm] outputs the number of frames of each template.
+ */
+void myo_hmm(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "hmm")) return;
+    MaxMyoListener *listener = self->myoListener;
+    t_symbol *command = (argc > 0 && atom_issym(argv)) ? atom_getsym(argv)
+                                                       : NULL;
+    if (command == sym_record) {
+        if (argc < 2) {
+            object_error((t_object *)self, "hmm record: missing label");
+            return;
+        }
+        t_symbol *label = myo_label(argv + 1);
+        MyoLock lock(self);
+        TrainingSet &data = listener->hmm_data;
+        if (data.labels.size() >= HmmModel::kMaxClasses &&
+            data.index(label->s_name) < 0) {
+            object_error((t_object *)self, "hmm record: at most %d classes",
+                         HmmModel::kMaxClasses);
+            return;
+        }
+        data.dimension = HMM_DIMENSION;
+        listener->hmm_label = data.add(label->s_name);
+        data.data[listener->hmm_label].clear();
+        return;
+    }
+    if (command == sym_stop) {
+        if (listener->hmm_label < 0) return;
+        {
+            MyoLock lock(self);
+            listener->hmm_label = -1;
+        }
+        myo_hmm_build(self);
+        return;
+    }
+    if (command == sym_train) {
+        myo_hmm_build(self);
+        return;
+    }
+    if (command == sym_reset) {
+        MyoLock lock(self);
+        for (int i = 0; i < MAX_DEVICES; i++) listener->hmm_follower[i].reset();
+        return;
+    }
+    if (command == sym_clear) {
+        MyoLock lock(self);
+        listener->hmm_data.clear();
+        listener->hmm_label = -1;
+        for (int i = 0; i < MAX_DEVICES; i++)
+            listener->hmm_follower[i].configure(NULL);
+        listener->hmm.reset();
+        listener->hmm_labels.clear();
+        return;
+    }
+    if (argc > 0) {
+        object_error((t_object *)self,
+                     "hmm: expected record <label>, stop, train, reset or "
+                     "clear");
+        return;
+    }
+
+    MyoLock lock(self);
+    TrainingSet const &data = listener->hmm_data;
+    t_atom value_out[3];
+    for (std::size_t c = 0; c < data.labels.size(); c++) {
+        atom_setsym(value_out, sym_hmm);
+        atom_setsym(value_out + 1, gensym(data.labels[c].c_str()));
+        atom_setlong(value_out + 2, data.data[c].size() / HMM_DIMENSION);
+        outlet_list(self->outlet_info, NULL, 3, value_out);
+    }
+}
+
+/**
+ * builds the HMM model from the recorded templates, and installs it
+ */
+void myo_hmm_build(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    TrainingSet data;
+    {
+        MyoLock lock(self);
+        data = listener->hmm_data;
+    }
+    std::unique_ptr<HmmModel> model(new HmmModel);
+    std::string error = model->build(data, static_cast<int>(self->hmmStates),
+                                     self->hmmVariance);
+    if (!error.empty()) {
+        object_error((t_object *)self, "hmm: %s", error.c_str());
+        return;
+    }
+    std::vector<t_symbol *> labels;
+    for (int c = 0; c < model->classes(); c++)
+        labels.push_back(gensym(model->label(c).c_str()));
+    {
+        MyoLock lock(self);
+        listener->hmm = std::move(model);
+        listener->hmm_labels = labels;
+        for (int i = 0; i < MAX_DEVICES; i++)
+            listener->hmm_follower[i].configure(listener->hmm.get());
+    }
+    myo_output_labels(self, sym_hmm, labels);
+}
+
+/**
+ * [gmr record <values>], [gmr stop]
+ * records training frames of the regression: the fused frames of the
+ * streamed devices (EMG or envelope and aligned IMU, as with @fused 1) are
+ * recorded with the given output values until stop (record can be sent again
+ * with new values while recording). [gmr train] trains a Gaussian mixture
+ * regression of @gmrcomponents components in the background, and outputs
+ * [gmr trained] once the model maps the fused frames (@gmr 1).
+ * [gmr clear] clears the training frames, [gmr] outputs their number.
+ */
+void myo_gmr(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "gmr")) return;
+    MaxMyoListener *listener = self->myoListener;
+    t_symbol *command = (argc > 0 && atom_issym(argv)) ? atom_getsym(argv)
+                                                       : NULL;
+    if (command == sym_record) {
+        long outputs = argc - 1;
+        if (outputs < 1 || outputs > GmrRegressor::kMaxOutputs) {
+            object_error((t_object *)self,
+                         "gmr record: expected 1 to %d output values",
+                         GmrRegressor::kMaxOutputs);
+            return;
+        }
+        MyoLock lock(self);
+        TrainingSet &data = listener->gmr_data;
+        if (data.dimension && data.dimension != GMR_INPUTS + outputs) {
+            object_error((t_object *)self,
+                         "gmr record: expected %d output values (or clear)",
+                         data.dimension - GMR_INPUTS);
+            return;
+        }
+        data.dimension = GMR_INPUTS + static_cast<int>(outputs);
+        for (int o = 0; o < outputs; o++)
+            listener->gmr_target[o] =
+                static_cast<float>(atom_getfloat(argv + 1 + o));
+        listener->gmr_recording = true;
+        data.add(std::string());
+        return;
+    }
+    if (command == sym_stop) {
+        MyoLock lock(self);
+        listener->gmr_recording = false;
+        return;
+    }
+    if (command == sym_clear) {
+        MyoLock lock(self);
+        listener->gmr_data.clear();
+        listener->gmr_recording = false;
+        return;
+    }
+    if (command == sym_train) {
+        if (listener->gmr_thread.joinable()) {
+            object_error((t_object *)self, "gmr train: already training");
+            return;
+        }
+        TrainingSet data;
+        {
+            MyoLock lock(self);
+            data = listener->gmr_data;
+        }
+        if (!data.size()) {
+            object_error((t_object *)self, "gmr train: no training frames");
+            return;
+        }
+        listener->gmr_cancel = false;
+        listener->gmr_thread = std::thread(myo_gmr_train, self,
+                                           std::move(data),
+                                           self->gmrComponents);
+        return;
+    }
+    if (argc > 0) {
+        object_error((t_object *)self,
+                     "gmr: expected record <values>, stop, train or clear");
+        return;
+    }
+
+    MyoLock lock(self);
+    t_atom value_out[2];
+    atom_setsym(value_out, sym_gmr);
+    atom_setlong(value_out + 1, listener->gmr_data.size());
+    outlet_list(self->outlet_info, NULL, 2, value_out);
+}
+
+/**
+ * trains a GMR model (training thread), and sets the gmr clock to install it
+ */
+void myo_gmr_train(t_myo *self, TrainingSet data, long components) {
+    MaxMyoListener *listener = self->myoListener;
+    std::unique_ptr<GmrRegressor> model(new GmrRegressor);
+    listener->gmr_error = model->train(data, GMR_INPUTS,
+                                       static_cast<int>(components),
+                                       &listener->gmr_cancel);
+    listener->gmr_trained = std::move(model);
+    clock_delay(self->gmr_clock, 0);
+}
+
+/**
+ * installs the GMR model trained in the background (gmr clock)
+ */
+void myo_gmr_install(t_myo *self) {
+    MaxMyoListener *listener = self->myoListener;
+    if (!listener->gmr_thread.joinable()) return;
+    listener->gmr_thread.join();
+    if (!listener->gmr_error.empty()) {
+        object_error((t_object *)self, "gmr train: %s",
+                     listener->gmr_error.c_str());
+        listener->gmr_trained.reset();
+        return;
+    }
+    {
+        MyoLock lock(self);
+        listener->gmr = std::move(listener->gmr_trained);
+        listener->gmr_outputs = listener->gmr->outputs();
+    }
+    myo_output_labels(self, sym_gmr, std::vector<t_symbol *>());
+}
+
+/**
+ * label of a class given as a symbol or a number
+ */
+t_symbol *myo_label(t_atom const *atom) {
+    if (atom_issym(atom)) return atom_getsym(atom);
+    char number[32];
+    snprintf(number, sizeof(number), "%ld", atom_getlong(atom));
+    return gensym(number);
+}
+
+/**
+ * outputs [<selector> trained <labels>] on the info outlet
+ */
+void myo_output_labels(t_myo *self, t_symbol *selector,
+                       std::vector<t_symbol *> const &labels) {
+    std::vector<t_atom> value_out(2 + labels.size());
+    atom_setsym(&value_out[0], selector);
+    atom_setsym(&value_out[1], sym_trained);
+    for (std::size_t c = 0; c < labels.size(); c++)
+        atom_setsym(&value_out[2 + c], labels[c]);
+    outlet_list(self->outlet_info, NULL, (short)value_out.size(),
+                &value_out[0]);
+}
+
+/**
+ * [setref]
+ * captures the current orientation of the streamed devices as their
+ * reference: orientations are then output relative to it (the rotation from
+ * the reference, in the frame of the reference). [setref <x y z w>] sets the
+ * reference quaternion of the streamed devices, [setref clear] outputs
+ * absolute orientations again.
+ */
+void myo_setref(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "setref")) return;
+    MaxMyoListener *listener = self->myoListener;
+    t_symbol *command = (argc > 0 && atom_issym(argv)) ? atom_getsym(argv)
+                                                       : NULL;
+    if (argc > 0 && command != sym_clear && !(argc == 4 && !command)) {
+        object_error((t_object *)self,
+                     "setref: expected clear or a quaternion (x y z w)");
+        return;
+    }
+    MyoLock lock(self);
+    int indices[MAX_DEVICES];
+    int count = myo_streamed_devices(self, indices);
+    for (int i = 0; i < count; i++) {
+        myo::Quaternion<float> &reference =
+            listener->orientation_reference[indices[i]];
+        if (command == sym_clear) {
+            reference = myo::Quaternion<float>();
+        } else if (argc == 4) {
+            reference =
+                myo::Quaternion<float>(static_cast<float>(atom_getfloat(argv)),
+                                       static_cast<float>(atom_getfloat(argv + 1)),
+                                       static_cast<float>(atom_getfloat(argv + 2)),
+                                       static_cast<float>(atom_getfloat(argv + 3)))
+                    .normalized();
+        } else if (!listener->captureReference(indices[i])) {
+            object_warn((t_object *)self,
+                        "setref: no orientation received from device %d",
+                        indices[i]);
+        }
+    }
+}
+
+/**
+ * [record <file>]
+ * records every event received by the object (raw EMG, IMU, poses, arm
+ * synchronization, RSSI, battery) with their hardware timestamps into a
+ * binary session file. Events are written by a dedicated thread.
+ */
+void myo_record(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (!myo_has_source(self, "record")) return;
+    if (argc < 1 || !atom_issym(argv)) {
+        object_error((t_object *)self, "missing file name for record");
+        return;
+    }
+    if (self->myoListener->replaying) {
+        object_error((t_object *)self, "cannot record while replaying");
+        return;
+    }
+    myo_stoprecord(self);
+    char path[MAX_PATH_CHARS];
+    path_nameconform(atom_getsym(argv)->s_name, path, PATH_STYLE_NATIVE,
+                     PATH_TYPE_BOOT);
+    if (!self->recorder) self->recorder = new SessionWriter();
+    if (!self->recorder->open(path)) {
+        object_error((t_object *)self, "cannot create file %s", path);
+        return;
+    }
+    MyoLock lock(self);
+    MaxMyoListener *listener = self->myoListener;
+    // start with the devices already connected, so that their names are known
+    for (int i = 0; i < listener->num_devices; i++) {
+        if (!listener->devices[i].connected) continue;
+        InfoEvent event = {InfoEvent::Connect,
+                           listener->devices[i].connection_timestamp,
+                           static_cast<uint8_t>(i), {0}, 0.f};
+        self->recorder->write(event, listener->devices[i].name);
+    }
+    listener->recorder = self->recorder;
+    object_post((t_object *)self, "recording to %s", path);
+}
+
+/**
+ * [stoprecord]
+ * stops recording and closes the session file
+ */
+void myo_stoprecord(t_myo *self) {
+    if (!self->recorder || !self->recorder->isOpen()) return;
+    {
+        MyoLock lock(self);
+        self->myoListener->recorder = NULL;
+    }
+    self->recorder->close();
+    object_post((t_object *)self, "recording stopped: %lu events (%lu dropped)",
+                self->recorder->records(), self->recorder->dropped());
+}
+
+/**
+ * [replay <file> [speed]]
+ * replays a recorded session through the same outputs as live data, paced by
+ * the recorded timestamps (speed 1: real time, 2: twice as fast...) or as
+ * fast as possible with speed 0. The object is disconnected from the
+ * armbands while replaying.
+ */
+void myo_replay(t_myo *self, t_symbol *s, long argc, t_atom *argv) {
+    if (argc < 1 || !atom_issym(argv)) {
+        object_error((t_object *)self, "missing file name for replay");
+        return;
+    }
+    double speed = (argc > 1 && atom_isnum(argv + 1)) ? atom_getfloat(argv + 1)
+                                                      : 1.;
+    myo_stopreplay(self);
+    myo_stoprecord(self);
+    myo_disconnect(self);
+    char path[MAX_PATH_CHARS];
+    path_nameconform(atom_getsym(argv)->s_name, path, PATH_STYLE_NATIVE,
+                     PATH_TYPE_BOOT);
+    MaxMyoListener *listener = self->myoListener;
+    listener->resetDevices();
+    listener->replaying = true;
+    if (!self->player) self->player = new SessionPlayer();
+    if (!self->player->start(path, listener, speed)) {
+        listener->replaying = false;
+        object_error((t_object *)self, "cannot read session file %s", path);
+        return;
+    }
+    t_atom value_out[2];
+    atom_setsym(value_out, sym_replay);
+    atom_setlong(value_out + 1, 1);
+    outlet_list(self->outlet_info, NULL, 2, value_out);
+}
+
+/**
+ * [stopreplay]
+ * stops replaying (also called at the end of the session)
+ */
+void myo_stopreplay(t_myo *self) {
+    if (!self->player || !self->myoListener->replaying) return;
+    self->player->stop();
+    self->myoListener->replaying = false;
+    self->myoListener->resetDevices();
+    t_atom value_out[2];
+    atom_setsym(value_out, sym_replay);
+    atom_setlong(value_out + 1, 0);
+    outlet_list(self->outlet_info, NULL, 2, value_out);
+}
+
+/**
+ * milliseconds elapsed since start
+ */
+double myo_elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Attributes
+#endif
+/**
+ * [stream 0/1]
+ * set streaming attribute (sensor data streamed as received)
+ */
+t_max_err myoSetStreamAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        self->stream = atom_getlong(av) != 0;
+    } else
+        object_error((t_object *)self,
+                     "missing or invalid arguments for stream");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * get streaming attribute (sensor data streamed as received)
+ */
+t_max_err myoGetStreamAttr(t_myo *self, t_object *attr, long *ac, t_atom **av) {
+    if ((*ac) == 0 || (*av) == NULL) {
+        // otherwise allocate memory
+        *ac = 1;
+
+        if (!(*av = (t_atom *)getbytes(sizeof(t_atom) * (*ac)))) {
+            *ac = 0;
+            return MAX_ERR_OUT_OF_MEM;
+        }
+    }
+
+    atom_setlong(*av, self->stream);
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [emg 0/1]
+ * specifies if the raw emg data should be streamed
+ */
+t_max_err myoSetStreamEmgAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        self->myoPolicy_emg = atom_getlong(av) != 0;
+        myo_update_event_mask(self);
+    } else
+        object_error((t_object *)self, "missing or invalid arguments for emg");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * specifies if the raw emg data should be streamed
+ */
+t_max_err myoGetStreamEmgAttr(t_myo *self, t_object *attr, long *ac,
+                              t_atom **av) {
+    if ((*ac) == 0 || (*av) == NULL) {
+        // otherwise allocate memory
+        *ac = 1;
+
+        if (!(*av = (t_atom *)getbytes(sizeof(t_atom) * (*ac)))) {
+            *ac = 0;
+            return MAX_ERR_OUT_OF_MEM;
+        }
+    }
+
+    atom_setlong(*av, self->myoPolicy_emg);
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [accel/gyro/quat/pose 0/1]
+ * specifies if a stream is output (disabled streams are not decoded)
+ */
+t_max_err myoSetStreamMaskAttr(t_myo *self, t_object *attr, long ac,
+                               t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        t_symbol *name = (t_symbol *)object_method(attr, gensym("getname"));
+        long value = atom_getlong(av) != 0;
+        if (name == gensym("accel"))
+            self->streamAccel = value;
+        else if (name == gensym("gyro"))
+            self->streamGyro = value;
+        else if (name == gensym("quat"))
+            self->streamQuat = value;
+        else if (name == gensym("pose"))
+            self->streamPose = value;
+        else if (name == gensym("fused"))
+            self->fusedOutput = value;
+        else if (name == gensym("features"))
+            self->emgFeatures = value;
+        else if (name == gensym("envelope"))
+            self->emgEnvelope = value;
+        else if (name == gensym("gmm"))
+            self->gmmRun = value;
+        else if (name == gensym("hmm"))
+            self->hmmRun = value;
+        else if (name == gensym("gmr"))
+            self->gmrRun = value;
+        myo_update_event_mask(self);
+    } else
+        object_error((t_object *)self, "missing or invalid arguments");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [emgbuffer <size>]
+ * specifies the number of EMG frames buffered between two queries. The IMU
+ * buffers of deferred mode hold as long for each device.
+ */
+t_max_err myoSetEmgBufferAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        self->emgBufferSize = atom_getlong(av) < 1 ? 1 : atom_getlong(av);
+        if (!self->myoListener) return MAX_ERR_NONE;
+        // the hub thread and the session player only push frames while
+        // holding the mutexes of the lock
+        MyoLock lock(self);
+        self->myoListener->emg_buffer.resize(self->emgBufferSize);
+        self->myoListener->fused_buffer.resize(self->emgBufferSize);
+        self->myoListener->accel_buffer.resize(
+            IMU_BUFFER_SIZE(self->emgBufferSize));
+        self->myoListener->gyro_buffer.resize(
+            IMU_BUFFER_SIZE(self->emgBufferSize));
+        self->myoListener->quat_buffer.resize(
+            IMU_BUFFER_SIZE(self->emgBufferSize));
+    } else
+        object_error((t_object *)self,
+                     "missing or invalid arguments for emgbuffer");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [slice <ms>]
+ * duration of the slices of the shared event loop. Control operations
+ * interrupt the current slice, the slice only bounds their latency while no
+ * event is received: about 1 ms with the default 1 ms slice (see the control
+ * case of bench/myobench.cpp). Shared by all objects: the last value set
+ * applies.
+ */
+t_max_err myoSetSliceAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        long slice = atom_getlong(av);
+        self->hubSlice = slice < 1 ? 1 : (slice > 100 ? 100 : slice);
+        if (self->myoHub)
+            self->myoHub->setSlice(static_cast<unsigned int>(self->hubSlice));
+    } else
+        object_error((t_object *)self,
+                     "missing or invalid arguments for slice");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [orientation quat/euler/matrix]
+ * format of the orientation outlet: quaternion (x y z w), Euler angles (yaw
+ * pitch roll in degrees) or rotation matrix (3 x 3, row-major)
+ */
+t_max_err myoSetOrientationAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    t_symbol *format = (ac > 0 && atom_issym(av)) ? atom_getsym(av) : NULL;
+    if (format == sym_quat || format == sym_euler || format == sym_matrix)
+        self->orientationFormat = format;
+    else
+        object_error((t_object *)self,
+                     "orientation: expected quat, euler or matrix");
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [accelmode sensor/world/linear]
+ * acceleration output in the frame of the armband (sensor), rotated to the
+ * world frame by the orientation of the same IMU sample (world), or in the
+ * world frame without gravity (linear), in g
+ */
+t_max_err myoSetAccelModeAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    t_symbol *mode = (ac > 0 && atom_issym(av)) ? atom_getsym(av) : NULL;
+    if (mode == sym_sensor || mode == sym_world || mode == sym_linear) {
+        self->accelMode = mode;
+        myo_update_event_mask(self);
+    } else {
+        object_error((t_object *)self,
+                     "accelmode: expected sensor, world or linear");
+    }
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [unlock 0/1]
+ * specifies if the Myo is unlocked for pose recognition
+ */
+t_max_err myoSetUnlockAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_isnum(av)) {
+        self->myoPolicy_unlock = atom_getlong(av) != 0;
+        if (!self->myo_connect_running) return MAX_ERR_NONE;
+        if (self->myoPolicy_unlock && self->myo_connect_running)
+            self->myoHub->setLockingPolicy(myo::Hub::lockingPolicyNone);
+        else
+            self->myoHub->setLockingPolicy(myo::Hub::lockingPolicyStandard);
+    } else
         object_error((t_object *)self,
                      "missing or invalid arguments for unlock");
 
@@ -661,6 +2780,51 @@ t_max_err myoGetUnlockAttr(t_myo *self, t_object *attr, long *ac, t_atom **av) {
     return MAX_ERR_NONE;
 }
 
+/**
+ * [multi 0/N/all]
+ * multi-device mode: outputs the data of the N first devices (or of all
+ * devices), prefixed by the device index
+ */
+t_max_err myoSetMultiAttr(t_myo *self, void *attr, long ac, t_atom *av) {
+    if (ac > 0 && atom_issym(av) && atom_getsym(av) == sym_all) {
+        self->multiDevices = -1;
+    } else if (ac > 0 && atom_isnum(av)) {
+        self->multiDevices = atom_getlong(av) < 0 ? 0 : atom_getlong(av);
+    } else {
+        object_error((t_object *)self,
+                     "missing or invalid arguments for multi");
+        return MAX_ERR_NONE;
+    }
+    if (!self->myo_connect_running) return MAX_ERR_NONE;
+    {
+        MyoLock lock(self);
+        self->myoListener->updateRoutes();
+    }
+
+    return MAX_ERR_NONE;
+}
+
+/**
+ * multi-device mode
+ */
+t_max_err myoGetMultiAttr(t_myo *self, t_object *attr, long *ac, t_atom **av) {
+    if ((*ac) == 0 || (*av) == NULL) {
+        // otherwise allocate memory
+        *ac = 1;
+
+        if (!(*av = (t_atom *)getbytes(sizeof(t_atom) * (*ac)))) {
+            *ac = 0;
+            return MAX_ERR_OUT_OF_MEM;
+        }
+    }
+
+    if (self->multiDevices < 0)
+        atom_setsym(*av, sym_all);
+    else
+        atom_setlong(*av, self->multiDevices);
+    return MAX_ERR_NONE;
+}
+
 /**
  * [device <myoname>]
  * specifies the name of the myo device to listen
@@ -670,19 +2834,43 @@ t_max_err myoSetDeviceAttr(t_myo *self, void *attr, long ac, t_atom *av) {
         if (self->deviceName != atom_getsym(av)) {
             self->deviceName = atom_getsym(av);
             self->myoDevice = NULL;
+            MaxMyoListener *listener = self->myoListener;
+            if (listener->replaying) {
+                // reselect among the devices of the replayed session (or on
+                // their next connection)
+                MyoLock lock(self);
+                int selected = -1;
+                for (int i = 0; i < listener->num_devices && selected < 0;
+                     i++) {
+                    if (listener->devices[i].connected &&
+                        (self->deviceName == sym_auto ||
+                         std::string(self->deviceName->s_name) ==
+                             listener->devices[i].name))
+                        selected = i;
+                }
+                listener->replay_device = selected;
+                onMaxMyoSync(self);
+                return MAX_ERR_NONE;
+            }
             if (!self->myo_connect_running) return MAX_ERR_NONE;
-            if (self->deviceName == sym_auto) {
-                if (self->myoListener->connectedDevices.size() > 0)
-                    self->myoDevice =
-                        *(self->myoListener->connectedDevices.begin());
-            } else {
-                for (auto device : self->myoListener->connectedDevices) {
-                    if (std::string(self->deviceName->s_name) ==
-                        device->getName()) {
-                        self->myoDevice = device;
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            {
+                MyoLock lock(self);
+                if (self->deviceName == sym_auto) {
+                    self->myoDevice = listener->firstConnected();
+                } else {
+                    for (int i = 0; i < listener->num_devices; i++) {
+                        if (listener->devices[i].connected &&
+                            std::string(self->deviceName->s_name) ==
+                                listener->devices[i].name) {
+                            self->myoDevice = listener->devices[i].myo;
+                        }
                     }
                 }
+                listener->updateRoutes();
             }
+            self->latencyDevice = myo_elapsed_ms(start);
             onMaxMyoSync(self);
             if (!self->myoDevice) {
                 object_warn(
@@ -722,33 +2910,135 @@ t_max_err myoGetDeviceAttr(t_myo *self, t_object *attr, long *ac, t_atom **av) {
  * outputs max messages when max is synced with a myo
  */
 void onMaxMyoSync(t_myo *self) {
-    if (!self->myo_connect_running) return;
     t_atom deviceInfo[2];
     atom_setsym(deviceInfo, sym_connected);
-    if (self->myoDevice) {
-        if (self->myoPolicy_emg)
-            self->myoDevice->setStreamEmg(myo::Myo::streamEmgEnabled);
-        else
-            self->myoDevice->setStreamEmg(myo::Myo::streamEmgDisabled);
-        atom_setsym(deviceInfo + 1, gensym(self->myoDevice->getName().c_str()));
-        object_post((t_object *)self,
-                    ("Connected to myo " + self->myoDevice->getName()).c_str());
+    int index = self->myoListener->followedIndex();
+    if (index >= 0) {
+        std::string const &name = self->myoListener->devices[index].name;
+        atom_setsym(deviceInfo + 1, gensym(name.c_str()));
+        object_post((t_object *)self, ("Connected to myo " + name).c_str());
     } else {
         atom_setlong(deviceInfo + 1, 0);
     }
     outlet_list(self->outlet_info, NULL, 2, deviceInfo);
 }
 
+/**
+ * data streams consumed by the object (combination of myo::Hub::EventMask)
+ */
+unsigned int myo_event_mask(t_myo *self) {
+    unsigned int mask = 0;
+    if (self->myoPolicy_emg) mask |= myo::Hub::eventMaskEmg;
+    if (self->streamAccel) mask |= myo::Hub::eventMaskAccelerometer;
+    if (self->streamAccel && self->accelMode != sym_sensor)
+        mask |= myo::Hub::eventMaskOrientation;
+    if (self->streamGyro) mask |= myo::Hub::eventMaskGyroscope;
+    if (self->streamQuat) mask |= myo::Hub::eventMaskOrientation;
+    if (self->streamPose) mask |= myo::Hub::eventMaskPose;
+    if (self->fusedOutput || self->hmmRun || self->gmrRun)
+        mask |= myo::Hub::eventMaskEmg | myo::Hub::eventMaskAccelerometer |
+                myo::Hub::eventMaskGyroscope | myo::Hub::eventMaskOrientation;
+    if (self->emgFeatures || self->emgEnvelope || self->gmmRun)
+        mask |= myo::Hub::eventMaskEmg;
+    return mask;
+}
+
+/**
+ * updates the data streams forwarded to the object by the shared hub (EMG
+ * streaming is disabled on the devices that have no EMG consumer)
+ */
+void myo_update_event_mask(t_myo *self) {
+    if (!self->myo_connect_running || !self->listenerRunning) return;
+    MyoLock lock(self);
+    self->myoHub->setEventMask(self->myoListener, myo_event_mask(self));
+}
+
 #if defined(MAC_VERSION)
 #pragma mark -
 #pragma mark Myo Device Listener: Methods
 #endif
+int MaxMyoListener::deviceIndex(myo::Myo *myo) const {
+    for (int i = 0; i < num_devices; i++) {
+        if (devices[i].myo == myo) return i;
+    }
+    return -1;
+}
+
+int MaxMyoListener::followedIndex() const {
+    if (replaying) return replay_device;
+    return maxObject_->myoDevice ? deviceIndex(maxObject_->myoDevice) : -1;
+}
+
+bool MaxMyoListener::isStreamed(int index) const {
+    if (index < 0) return false;
+    if (!maxObject_->multiDevices) return index == followedIndex();
+    return maxObject_->multiDevices < 0 || index < maxObject_->multiDevices;
+}
+
+int MaxMyoListener::streamedIndex(myo::Myo *myo) const {
+    int index = deviceIndex(myo);
+    return isStreamed(index) ? index : -1;
+}
+
+void MaxMyoListener::resetDevices() {
+    num_devices = 0;
+    replay_device = -1;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        devices[i].myo = NULL;
+        devices[i].name.clear();
+        devices[i].connected = false;
+        devices[i].connection_timestamp = 0;
+    }
+}
+
+myo::Myo *MaxMyoListener::firstConnected() const {
+    for (int i = 0; i < num_devices; i++) {
+        if (devices[i].connected) return devices[i].myo;
+    }
+    return NULL;
+}
+
+void MaxMyoListener::updateRoutes() {
+    if (!maxObject_->myoHub) return;
+    std::vector<myo::Myo *> routed;
+    for (int i = 0; i < num_devices; i++) {
+        if (devices[i].myo && devices[i].connected && isStreamed(i))
+            routed.push_back(devices[i].myo);
+    }
+    maxObject_->myoHub->route(this, routed);
+}
+
 void MaxMyoListener::onConnect(myo::Myo *myo, uint64_t timestamp,
                                myo::FirmwareVersion firmwareVersion) {
-    connectedDevices.insert(myo);
+    int index = deviceIndex(myo);
+    if (index < 0) {
+        if (num_devices == MAX_DEVICES) {
+            object_warn((t_object *)maxObject_,
+                        "too many devices, ignoring myo %s",
+                        myo->getName().c_str());
+            return;
+        }
+        index = num_devices;
+        devices[index].myo = myo;
+        devices[index].name = myo->getName();
+        num_devices++;
+    }
+    devices[index].connected = true;
+    devices[index].connection_timestamp = timestamp;
+    emg_link[index].reset();
+    imu_link[index].reset();
+    resetResamplers(index);
+    accel_history[index].reset();
+    gyro_history[index].reset();
+    quat_history[index].reset();
+    imu_received[index] = 0;
+    emg_features[index].reset();
+    emg_envelope[index].reset();
+    gmm_window[index].reset();
+    hmm_follower[index].reset();
 
     if (maxObject_->deviceName == sym_auto) {
-        if (connectedDevices.size() == 1) {
+        if (!maxObject_->myoDevice) {
             maxObject_->myoDevice = myo;
         }
     } else {
@@ -756,130 +3046,694 @@ void MaxMyoListener::onConnect(myo::Myo *myo, uint64_t timestamp,
             maxObject_->myoDevice = myo;
         }
     }
-    for (int i = 0; i < 4; i++) emg_frames[i].fill(0.);
-    onMaxMyoSync(maxObject_);
-    myo_dump_devlist(maxObject_);
+    updateRoutes();
+    InfoEvent event = {InfoEvent::Connect, timestamp,
+                       static_cast<uint8_t>(index), {0}, 0.f};
+    dispatch(event);
 }
 
 void MaxMyoListener::onDisconnect(myo::Myo *myo, uint64_t timestamp) {
-    connectedDevices.erase(myo);
+    int index = deviceIndex(myo);
+    if (index < 0) return;
+    devices[index].connected = false;
     if (maxObject_->myoDevice == myo) {
         object_post((t_object *)maxObject_,
                     ("Disconnected from myo " + myo->getName()).c_str());
         maxObject_->myoDevice = NULL;
-        if (connectedDevices.size() > 0 && maxObject_->deviceName == sym_auto) {
-            maxObject_->myoDevice = *(connectedDevices.begin());
+        if (maxObject_->deviceName == sym_auto) {
+            maxObject_->myoDevice = firstConnected();
         }
     }
-    onMaxMyoSync(maxObject_);
-    for (int i = 0; i < 4; i++) emg_frames[i].fill(0.);
-    acceleration.fill(0);
-    gyroscopes.fill(0);
-    quaternions.fill(0);
+    updateRoutes();
+    disconnectDevice(index, timestamp);
+}
+
+void MaxMyoListener::disconnectDevice(int index, uint64_t timestamp) {
+    devices[index].connected = false;
+    devices[index].connection_timestamp = 0;
+    InfoEvent event = {InfoEvent::Disconnect, timestamp,
+                       static_cast<uint8_t>(index), {0}, 0.f};
+    dispatch(event);
+
+    // null frames, so that queries do not return stale data: the buffers
+    // only receive them when they are read, as in the forward() methods
+    uint8_t device = static_cast<uint8_t>(index);
+    bool deferred = maxObject_->stream && maxObject_->deferOutput;
+    bool queued = deferred || (!maxObject_->stream && maxObject_->emgQueryAll);
+    EmgFrame emg_frame = {timestamp, device, {{0}}};
+    Vector3Frame vector_frame = {timestamp, device, {{0}}};
+    QuaternionFrame quat_frame = {timestamp, device, {{0}}};
+    emg_value[index].write(emg_frame);
+    accel_value[index].write(vector_frame);
+    gyro_value[index].write(vector_frame);
+    quat_value[index].write(quat_frame);
+    if (queued) enqueue(emg_buffer, emg_frame, ListenerStats::EmgQueue);
+    if (deferred) {
+        enqueue(accel_buffer, vector_frame, ListenerStats::AccelQueue);
+        enqueue(gyro_buffer, vector_frame, ListenerStats::GyroQueue);
+        enqueue(quat_buffer, quat_frame, ListenerStats::QuatQueue);
+    }
+    EmgFeatureFrame features_frame = {timestamp, device, {{0}}};
+    FusedFrame fused_frame = {timestamp, device, {{0}}};
+    EnvelopeFrame envelope_frame = {timestamp, device, {{0}}};
+    features_value[index].write(features_frame);
+    fused_value[index].write(fused_frame);
+    envelope_value[index].write(envelope_frame);
+    if (!queued) return;
+    if (maxObject_->emgFeatures)
+        enqueue(features_buffer, features_frame, ListenerStats::FeaturesQueue);
+    else if (maxObject_->fusedOutput)
+        enqueue(fused_buffer, fused_frame, ListenerStats::FusedQueue);
+    else if (maxObject_->emgEnvelope)
+        enqueue(envelope_buffer, envelope_frame, ListenerStats::EnvelopeQueue);
 }
 
 void MaxMyoListener::onArmSync(myo::Myo *myo, uint64_t timestamp, myo::Arm arm,
                                myo::XDirection xDirection, float rotation,
                                myo::WarmupState warmupState) {
     if (!maxObject_->myo_connect_running) return;
-    if (myo != maxObject_->myoDevice) return;
-    t_atom arm_sync[6];
-    atom_setsym(arm_sync, sym_armsync);
-    atom_setlong(arm_sync + 1, 1);
-    if (arm == myo::Arm::armLeft) {
-        atom_setsym(arm_sync + 2, gensym("Left"));
-    } else if (arm == myo::Arm::armRight) {
-        atom_setsym(arm_sync + 2, gensym("Right"));
-    } else {
-        atom_setsym(arm_sync + 2, gensym("Unknown"));
-    }
-    if (xDirection == myo::XDirection::xDirectionTowardWrist) {
-        atom_setsym(arm_sync + 3, gensym("TowardWrist"));
-    } else if (xDirection == myo::XDirection::xDirectionTowardElbow) {
-        atom_setsym(arm_sync + 3, gensym("TowardElbow"));
-    } else {
-        atom_setsym(arm_sync + 3, gensym("Unknown"));
-    }
-    atom_setfloat(arm_sync + 4, rotation);
-    if (warmupState == myo::WarmupState::warmupStateCold) {
-        atom_setsym(arm_sync + 5, gensym("Cold"));
-    } else if (warmupState == myo::WarmupState::warmupStateWarm) {
-        atom_setsym(arm_sync + 5, gensym("Warm"));
-    } else {
-        atom_setsym(arm_sync + 5, gensym("Unknown"));
-    }
-    outlet_list(maxObject_->outlet_info, NULL, 6, arm_sync);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    InfoEvent event = {InfoEvent::ArmSync,
+                       timestamp,
+                       static_cast<uint8_t>(index),
+                       {arm, xDirection, warmupState},
+                       rotation};
+    dispatch(event);
 }
 
 void MaxMyoListener::onArmUnsync(myo::Myo *myo, uint64_t timestamp) {
-    t_atom arm_sync[2];
-    atom_setsym(arm_sync, sym_armsync);
-    atom_setlong(arm_sync + 1, 0);
-    outlet_list(maxObject_->outlet_info, NULL, 2, arm_sync);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    InfoEvent event = {InfoEvent::ArmUnsync, timestamp,
+                       static_cast<uint8_t>(index), {0}, 0.f};
+    dispatch(event);
 }
 
 void MaxMyoListener::onAccelerometerData(myo::Myo *myo, uint64_t timestamp,
                                          const myo::Vector3<float> &accel) {
-    if (myo != maxObject_->myoDevice) return;
-    acceleration[0] = accel.x();
-    acceleration[1] = accel.y();
-    acceleration[2] = accel.z();
-    if (maxObject_->stream) myo_dump_accel(maxObject_);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    Vector3Frame frame = {timestamp, static_cast<uint8_t>(index),
+                          {{accel.x(), accel.y(), accel.z()}}};
+    handleAccel(frame);
 }
 
 void MaxMyoListener::onGyroscopeData(myo::Myo *myo, uint64_t timestamp,
                                      const myo::Vector3<float> &gyro) {
-    if (myo != maxObject_->myoDevice) return;
-    gyroscopes[0] = gyro.x();
-    gyroscopes[1] = gyro.y();
-    gyroscopes[2] = gyro.z();
-    if (maxObject_->stream) myo_dump_gyro(maxObject_);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    Vector3Frame frame = {timestamp, static_cast<uint8_t>(index),
+                          {{gyro.x(), gyro.y(), gyro.z()}}};
+    handleGyro(frame);
 }
 
 void MaxMyoListener::onOrientationData(myo::Myo *myo, uint64_t timestamp,
                                        const myo::Quaternion<float> &rotation) {
-    if (myo != maxObject_->myoDevice) return;
-    quaternions[0] = rotation.x();
-    quaternions[1] = rotation.y();
-    quaternions[2] = rotation.z();
-    quaternions[3] = rotation.w();
-    if (maxObject_->stream) myo_dump_quat(maxObject_);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    QuaternionFrame frame = {
+        timestamp,
+        static_cast<uint8_t>(index),
+        {{rotation.x(), rotation.y(), rotation.z(), rotation.w()}}};
+    handle(frame);
 }
 
 void MaxMyoListener::onEmgData(myo::Myo *myo, uint64_t timestamp,
                                const int8_t *emg) {
-    if (myo != maxObject_->myoDevice || num_emg_frames == 4) return;
-    if (maxObject_->stream || emg_timestamp != timestamp) {
-        num_emg_frames = 0;
-    }
-    emg_timestamp = timestamp;
-    for (int i = 0; i < 8; i++) {
-        emg_frames[num_emg_frames][i] = static_cast<float>(emg[i]) / (float)127.;
-    }
-    num_emg_frames++;
-    if (maxObject_->stream) myo_dump_emg(maxObject_);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    EmgFrame frame;
+    frame.timestamp = timestamp;
+    frame.device = static_cast<uint8_t>(index);
+    for (int i = 0; i < 8; i++) frame.values[i] = emg[i];
+    handle(frame);
 }
 
 void MaxMyoListener::onRssi(myo::Myo *myo, uint64_t timestamp, int8_t rssi) {
-    if (myo != maxObject_->myoDevice) return;
-    t_atom value_out[2];
-    atom_setsym(value_out, sym_rssi);
-    atom_setlong(value_out + 1, static_cast<int>(rssi));
-    outlet_list(maxObject_->outlet_info, NULL, 2, value_out);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    InfoEvent event = {InfoEvent::Rssi, timestamp, static_cast<uint8_t>(index),
+                       {rssi}, 0.f};
+    dispatch(event);
 }
 
 void MaxMyoListener::onBatteryLevelReceived(myo::Myo *myo, uint64_t timestamp,
                                             uint8_t level) {
-    if (myo != maxObject_->myoDevice) return;
-    t_atom value_out[2];
-    atom_setsym(value_out, sym_battery);
-    atom_setlong(value_out + 1, static_cast<int>(level));
-    outlet_list(maxObject_->outlet_info, NULL, 2, value_out);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    InfoEvent event = {InfoEvent::Battery, timestamp,
+                       static_cast<uint8_t>(index), {level}, 0.f};
+    dispatch(event);
 }
 
 void MaxMyoListener::onPose(myo::Myo *myo, uint64_t timestamp, myo::Pose pose) {
-    if (myo != maxObject_->myoDevice) return;
-    t_atom value_out[1];
-    atom_setsym(value_out, gensym(pose.toString().c_str()));
-    outlet_list(maxObject_->outlet_poses, NULL, 1, value_out);
+    int index = streamedIndex(myo);
+    if (index < 0) return;
+    InfoEvent event = {InfoEvent::Pose, timestamp, static_cast<uint8_t>(index),
+                       {pose.type()}, 0.f};
+    dispatch(event);
+}
+
+void MaxMyoListener::onRecord(SessionRecord const &record) {
+    MyoLock lock(maxObject_);
+    int index = record.device;
+    if (index >= MAX_DEVICES) return;
+    uint8_t device = record.device;
+
+    if (record.type == SessionRecord::Connect) {
+        if (index >= num_devices) {
+            for (int i = num_devices; i <= index; i++) devices[i].name.clear();
+            devices[index].name = record.name;
+            num_devices = index + 1;
+        }
+        devices[index].connected = true;
+        devices[index].connection_timestamp = record.timestamp;
+        emg_link[index].reset();
+        imu_link[index].reset();
+        resetResamplers(index);
+        accel_history[index].reset();
+        gyro_history[index].reset();
+        quat_history[index].reset();
+        imu_received[index] = 0;
+        emg_features[index].reset();
+        emg_envelope[index].reset();
+        gmm_window[index].reset();
+        hmm_follower[index].reset();
+        if (replay_device < 0 &&
+            (maxObject_->deviceName == sym_auto ||
+             std::string(maxObject_->deviceName->s_name) ==
+                 devices[index].name))
+            replay_device = index;
+        InfoEvent event = {InfoEvent::Connect, record.timestamp, device, {0},
+                           0.f};
+        dispatch(event);
+        return;
+    }
+    if (index >= num_devices || !devices[index].connected) return;
+    if (record.type == SessionRecord::Disconnect) {
+        if (replay_device == index) replay_device = -1;
+        disconnectDevice(index, record.timestamp);
+        return;
+    }
+    if (!isStreamed(index)) return;
+
+    // apply the stream attributes, filtered by the hub for live data
+    unsigned int mask = myo_event_mask(maxObject_);
+    switch (record.type) {
+        case SessionRecord::Emg:
+            if (mask & myo::Hub::eventMaskEmg) {
+                EmgFrame frame;
+                frame.timestamp = record.timestamp;
+                frame.device = device;
+                for (int i = 0; i < 8; i++) frame.values[i] = record.emg[i];
+                handle(frame);
+            }
+            break;
+
+        case SessionRecord::Accel:
+            if (mask & myo::Hub::eventMaskAccelerometer) {
+                Vector3Frame frame = {
+                    record.timestamp,
+                    device,
+                    {{record.values[0], record.values[1], record.values[2]}}};
+                handleAccel(frame);
+            }
+            break;
+
+        case SessionRecord::Gyro:
+            if (mask & myo::Hub::eventMaskGyroscope) {
+                Vector3Frame frame = {
+                    record.timestamp,
+                    device,
+                    {{record.values[0], record.values[1], record.values[2]}}};
+                handleGyro(frame);
+            }
+            break;
+
+        case SessionRecord::Quat:
+            if (mask & myo::Hub::eventMaskOrientation) {
+                QuaternionFrame frame = {record.timestamp,
+                                         device,
+                                         {{record.values[0], record.values[1],
+                                           record.values[2], record.values[3]}}};
+                handle(frame);
+            }
+            break;
+
+        case SessionRecord::Pose:
+            if (mask & myo::Hub::eventMaskPose) {
+                InfoEvent event = {InfoEvent::Pose, record.timestamp, device,
+                                   {record.info[0]}, 0.f};
+                dispatch(event);
+            }
+            break;
+
+        case SessionRecord::ArmSync: {
+            InfoEvent event = {InfoEvent::ArmSync,
+                               record.timestamp,
+                               device,
+                               {record.info[0], record.info[1], record.info[2]},
+                               record.values[0]};
+            dispatch(event);
+            break;
+        }
+
+        case SessionRecord::ArmUnsync: {
+            InfoEvent event = {InfoEvent::ArmUnsync, record.timestamp, device,
+                               {0}, 0.f};
+            dispatch(event);
+            break;
+        }
+
+        case SessionRecord::Rssi: {
+            InfoEvent event = {InfoEvent::Rssi, record.timestamp, device,
+                               {record.info[0]}, 0.f};
+            dispatch(event);
+            break;
+        }
+
+        case SessionRecord::Battery: {
+            InfoEvent event = {InfoEvent::Battery, record.timestamp, device,
+                               {record.info[0]}, 0.f};
+            dispatch(event);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void MaxMyoListener::onEnd() { clock_delay(maxObject_->replay_clock, 0); }
+
+void MaxMyoListener::handle(EmgFrame const &frame) {
+    ScopeTimer timer(stats.callbacks, stats.callback_total_ns,
+                     stats.callback_max_ns);
+    stats.events[ListenerStats::Emg].add();
+    stats.emg_lost.add(emg_link[frame.device].received(frame.timestamp));
+    if (devices[frame.device].connection_timestamp == 0)
+        devices[frame.device].connection_timestamp = frame.timestamp;
+    if (recorder) recorder->write(frame);
+    if (resampling())
+        emg_resampler[frame.device].push(
+            frame, [this](EmgFrame const &out) { forward(out); });
+    else
+        forward(frame);
+}
+
+void MaxMyoListener::forward(EmgFrame const &frame) {
+    if (extracting()) {
+        EmgFeatures &extractor = emg_features[frame.device];
+        if (!extractor.push(frame.values.data())) return;
+        EmgFeatureFrame features = {frame.timestamp, frame.device, {{0}}};
+        extractor.compute(features.values.data());
+        classify(features.timestamp, features.device, features.values.data(),
+                 EmgFeatures::kSize);
+        forward(features);
+        return;
+    }
+    EnvelopeFrame envelope = {frame.timestamp, frame.device, {{0}}};
+    if (maxObject_->emgEnvelope) {
+        EmgEnvelope &filter = emg_envelope[frame.device];
+        filter.setRates(static_cast<float>(maxObject_->envelopeDiffusion),
+                        static_cast<float>(maxObject_->envelopeJumpRate));
+        filter.update(frame.values.data(), envelope.values.data());
+        std::array<float, 8> &peak = mvc_peak[frame.device];
+        std::array<float, 8> const &reference = mvc[frame.device];
+        for (int i = 0; i < 8; i++) {
+            if (mvc_calibrating && envelope.values[i] > peak[i])
+                peak[i] = envelope.values[i];
+            envelope.values[i] /= reference[i];
+        }
+    }
+    float emg[8];  // envelope or EMG in [-1, 1]
+    for (int i = 0; i < 8; i++)
+        emg[i] = maxObject_->emgEnvelope ? envelope.values[i]
+                                         : frame.values[i] / 127.f;
+    classify(frame.timestamp, frame.device, emg, 8);
+    if (fused() || regressing()) {
+        FusedFrame fused_frame = {frame.timestamp, frame.device, {{0}}};
+        std::copy(emg, emg + 8, fused_frame.values.begin());
+        Vector3Frame vector_frame;
+        QuaternionFrame quat_frame;
+        if (accel_history[frame.device].at(frame.timestamp, vector_frame))
+            std::copy(vector_frame.values.begin(), vector_frame.values.end(),
+                      fused_frame.values.begin() + 8);
+        if (gyro_history[frame.device].at(frame.timestamp, vector_frame))
+            std::copy(vector_frame.values.begin(), vector_frame.values.end(),
+                      fused_frame.values.begin() + 11);
+        if (quat_history[frame.device].at(frame.timestamp, quat_frame))
+            std::copy(quat_frame.values.begin(), quat_frame.values.end(),
+                      fused_frame.values.begin() + 14);
+        regress(fused_frame);
+        if (fused()) {
+            forward(fused_frame);
+            return;
+        }
+    }
+    if (maxObject_->emgEnvelope) {
+        forward(envelope);
+        return;
+    }
+    emg_value[frame.device].write(frame);
+    if (maxObject_->stream && !maxObject_->deferOutput) {
+        myo_output_emg(maxObject_, frame, maxObject_->outputTimestamp);
+        return;
+    }
+    if (!maxObject_->stream && !maxObject_->emgQueryAll) return;
+    if (!enqueue(emg_buffer, frame, ListenerStats::EmgQueue)) emg_dropped++;
+    if (maxObject_->stream) scheduleDrain();
+}
+
+void MaxMyoListener::handleAccel(Vector3Frame const &frame) {
+    ScopeTimer timer(stats.callbacks, stats.callback_total_ns,
+                     stats.callback_max_ns);
+    stats.events[ListenerStats::Accel].add();
+    if (devices[frame.device].connection_timestamp == 0)
+        devices[frame.device].connection_timestamp = frame.timestamp;
+    if (recorder) recorder->writeAccel(frame);
+    if (resampling())
+        accel_resampler[frame.device].push(
+            frame, [this](Vector3Frame const &out) { forwardAccel(out); });
+    else
+        forwardAccel(frame);
+}
+
+void MaxMyoListener::forwardAccel(Vector3Frame const &frame) {
+    accel_history[frame.device].push(frame);
+    collect(frame.device, frame.timestamp, myo::Hub::eventMaskAccelerometer);
+    if (fused()) return;
+    Vector3Frame accel = frame;
+    if (maxObject_->accelMode != sym_sensor &&
+        !worldAcceleration(frame, accel))
+        return;
+    accel_value[frame.device].write(accel);
+    if (!maxObject_->stream) return;
+    if (!maxObject_->deferOutput) {
+        myo_output_accel(maxObject_, accel, maxObject_->outputTimestamp);
+        return;
+    }
+    enqueue(accel_buffer, accel, ListenerStats::AccelQueue);
+    scheduleDrain();
+}
+
+bool MaxMyoListener::worldAcceleration(Vector3Frame const &frame,
+                                       Vector3Frame &out) const {
+    // the orientation of an IMU sample is received before its acceleration:
+    // the history holds the orientation of the same timestamp
+    QuaternionFrame quat_frame;
+    if (!quat_history[frame.device].at(frame.timestamp, quat_frame))
+        return false;
+    rotateVector(toQuaternion(quat_frame.values.data()), frame.values.data(),
+                 out.values.data());
+    // at rest, the accelerometer measures 1 g upwards (world z axis)
+    if (maxObject_->accelMode == sym_linear) out.values[2] -= 1.f;
+    return true;
+}
+
+void MaxMyoListener::handleGyro(Vector3Frame const &frame) {
+    ScopeTimer timer(stats.callbacks, stats.callback_total_ns,
+                     stats.callback_max_ns);
+    stats.events[ListenerStats::Gyro].add();
+    if (devices[frame.device].connection_timestamp == 0)
+        devices[frame.device].connection_timestamp = frame.timestamp;
+    if (recorder) recorder->writeGyro(frame);
+    if (resampling())
+        gyro_resampler[frame.device].push(
+            frame, [this](Vector3Frame const &out) { forwardGyro(out); });
+    else
+        forwardGyro(frame);
+}
+
+void MaxMyoListener::forwardGyro(Vector3Frame const &frame) {
+    gyro_history[frame.device].push(frame);
+    collect(frame.device, frame.timestamp, myo::Hub::eventMaskGyroscope);
+    if (fused()) return;
+    gyro_value[frame.device].write(frame);
+    if (!maxObject_->stream) return;
+    if (!maxObject_->deferOutput) {
+        myo_output_gyro(maxObject_, frame, maxObject_->outputTimestamp);
+        return;
+    }
+    enqueue(gyro_buffer, frame, ListenerStats::GyroQueue);
+    scheduleDrain();
+}
+
+void MaxMyoListener::handle(QuaternionFrame const &frame) {
+    ScopeTimer timer(stats.callbacks, stats.callback_total_ns,
+                     stats.callback_max_ns);
+    stats.events[ListenerStats::Quat].add();
+    stats.imu_lost.add(imu_link[frame.device].received(frame.timestamp));
+    if (devices[frame.device].connection_timestamp == 0)
+        devices[frame.device].connection_timestamp = frame.timestamp;
+    if (recorder) recorder->write(frame);
+    if (resampling())
+        quat_resampler[frame.device].push(
+            frame, [this](QuaternionFrame const &out) { forward(out); });
+    else
+        forward(frame);
+}
+
+void MaxMyoListener::forward(QuaternionFrame const &frame) {
+    quat_history[frame.device].push(frame);
+    collect(frame.device, frame.timestamp, myo::Hub::eventMaskOrientation);
+    if (fused()) return;
+    QuaternionFrame relative = frame;
+    myo::Quaternion<float> q =
+        relativeOrientation(orientation_reference[frame.device],
+                            toQuaternion(frame.values.data()));
+    relative.values[0] = q.x();
+    relative.values[1] = q.y();
+    relative.values[2] = q.z();
+    relative.values[3] = q.w();
+    quat_value[frame.device].write(relative);
+    if (!maxObject_->stream) return;
+    if (!maxObject_->deferOutput) {
+        myo_output_quat(maxObject_, relative, maxObject_->outputTimestamp);
+        return;
+    }
+    enqueue(quat_buffer, relative, ListenerStats::QuatQueue);
+    scheduleDrain();
+}
+
+void MaxMyoListener::forward(FusedFrame const &frame) {
+    fused_value[frame.device].write(frame);
+    if (maxObject_->stream && !maxObject_->deferOutput) {
+        myo_output_fused(maxObject_, frame, maxObject_->outputTimestamp);
+        return;
+    }
+    if (!maxObject_->stream && !maxObject_->emgQueryAll) return;
+    if (!enqueue(fused_buffer, frame, ListenerStats::FusedQueue))
+        emg_dropped++;
+    if (maxObject_->stream) scheduleDrain();
+}
+
+void MaxMyoListener::forward(EmgFeatureFrame const &frame) {
+    features_value[frame.device].write(frame);
+    if (maxObject_->stream && !maxObject_->deferOutput) {
+        myo_output_features(maxObject_, frame, maxObject_->outputTimestamp);
+        return;
+    }
+    if (!maxObject_->stream && !maxObject_->emgQueryAll) return;
+    if (!enqueue(features_buffer, frame, ListenerStats::FeaturesQueue))
+        emg_dropped++;
+    if (maxObject_->stream) scheduleDrain();
+}
+
+void MaxMyoListener::forward(EnvelopeFrame const &frame) {
+    envelope_value[frame.device].write(frame);
+    if (maxObject_->stream && !maxObject_->deferOutput) {
+        myo_output_envelope(maxObject_, frame, maxObject_->outputTimestamp);
+        return;
+    }
+    if (!maxObject_->stream && !maxObject_->emgQueryAll) return;
+    if (!enqueue(envelope_buffer, frame, ListenerStats::EnvelopeQueue))
+        emg_dropped++;
+    if (maxObject_->stream) scheduleDrain();
+}
+
+void MaxMyoListener::classify(uint64_t timestamp, uint8_t device,
+                              float const *values, int dimension) {
+    if (gmm_label >= 0 && gmm_data.size() < GMM_MAX_FRAMES) {
+        if (!gmm_data.dimension) gmm_data.dimension = dimension;
+        std::vector<float> &frames = gmm_data.data[gmm_label];
+        if (dimension == gmm_data.dimension)
+            frames.insert(frames.end(), values, values + dimension);
+    }
+    if (!maxObject_->gmmRun || !gmm || gmm->dimension() != dimension) return;
+    LikelihoodWindow &window = gmm_window[device];
+    if (window.classes() != gmm->classes() ||
+        window.window() != maxObject_->gmmWindow)
+        window.configure(gmm->classes(), maxObject_->gmmWindow);
+    float loglikelihoods[GmmClassifier::kMaxClasses];
+    gmm->logLikelihoods(values, loglikelihoods);
+    ClassFrame frame;
+    frame.timestamp = timestamp;
+    frame.device = device;
+    frame.classes = static_cast<uint8_t>(gmm->classes());
+    frame.likeliest = static_cast<uint8_t>(
+        window.push(loglikelihoods, frame.likelihoods.data()));
+    forward(frame);
+}
+
+void MaxMyoListener::forward(ClassFrame const &frame) {
+    if (!maxObject_->deferOutput) {
+        myo_output_class(maxObject_, frame);
+        return;
+    }
+    enqueue(gmm_buffer, frame, ListenerStats::GmmQueue);
+    scheduleDrain();
+}
+
+void MaxMyoListener::collect(uint8_t device, uint64_t timestamp,
+                             unsigned int stream) {
+    // libmyo sends the orientation of an IMU sample before its acceleration
+    // and gyroscope: the sample is complete with the last enabled stream
+    if (timestamp != imu_timestamp[device]) {
+        imu_timestamp[device] = timestamp;
+        imu_received[device] = 0;
+    }
+    if (imu_received[device] & stream) return;  // already followed
+    imu_received[device] |= stream;
+    unsigned int expected =
+        myo_event_mask(maxObject_) &
+        (myo::Hub::eventMaskAccelerometer | myo::Hub::eventMaskGyroscope |
+         myo::Hub::eventMaskOrientation);
+    if ((imu_received[device] & expected) != expected) return;
+    imu_received[device] = ~0u;
+    follow(device, timestamp);
+}
+
+void MaxMyoListener::follow(uint8_t device, uint64_t timestamp) {
+    bool recording = hmm_label >= 0 &&
+                     hmm_data.data[hmm_label].size() <
+                         HMM_MAX_FRAMES * HMM_DIMENSION;
+    if (!recording && !(maxObject_->hmmRun && hmm)) return;
+    // streams disabled by the attributes are recorded as zeros
+    float imu[HMM_DIMENSION] = {0.f};
+    Vector3Frame vector_frame;
+    QuaternionFrame quat_frame;
+    if (accel_history[device].at(timestamp, vector_frame))
+        std::copy(vector_frame.values.begin(), vector_frame.values.end(), imu);
+    if (gyro_history[device].at(timestamp, vector_frame))
+        std::copy(vector_frame.values.begin(), vector_frame.values.end(),
+                  imu + 3);
+    if (quat_history[device].at(timestamp, quat_frame))
+        std::copy(quat_frame.values.begin(), quat_frame.values.end(),
+                  imu + 6);
+    if (recording) {
+        std::vector<float> &frames = hmm_data.data[hmm_label];
+        frames.insert(frames.end(), imu, imu + HMM_DIMENSION);
+    }
+    if (!maxObject_->hmmRun || !hmm) return;
+    FollowFrame result;
+    result.timestamp = timestamp;
+    result.device = device;
+    result.classes = static_cast<uint8_t>(hmm->classes());
+    result.likeliest = static_cast<uint8_t>(
+        hmm_follower[device].update(imu, result.likelihoods.data(),
+                                    result.progressions.data()));
+    forward(result);
+}
+
+void MaxMyoListener::forward(FollowFrame const &frame) {
+    if (!maxObject_->deferOutput) {
+        myo_output_follow(maxObject_, frame);
+        return;
+    }
+    enqueue(hmm_buffer, frame, ListenerStats::HmmQueue);
+    scheduleDrain();
+}
+
+void MaxMyoListener::regress(FusedFrame const &frame) {
+    if (gmr_recording && gmr_data.size() < GMR_MAX_FRAMES) {
+        std::vector<float> &frames = gmr_data.data.back();
+        frames.insert(frames.end(), frame.values.begin(), frame.values.end());
+        frames.insert(frames.end(), gmr_target.begin(),
+                      gmr_target.begin() + (gmr_data.dimension - GMR_INPUTS));
+    }
+    if (!maxObject_->gmrRun || !gmr) return;
+    RegressionFrame result;
+    result.timestamp = frame.timestamp;
+    result.device = frame.device;
+    result.outputs = static_cast<uint8_t>(gmr->outputs());
+    gmr->regress(frame.values.data(), result.values.data());
+    forward(result);
+}
+
+void MaxMyoListener::forward(RegressionFrame const &frame) {
+    if (!maxObject_->deferOutput) {
+        myo_output_regression(maxObject_, frame);
+        return;
+    }
+    enqueue(gmr_buffer, frame, ListenerStats::GmrQueue);
+    scheduleDrain();
+}
+
+bool MaxMyoListener::fused() const {
+    return maxObject_->fusedOutput && !maxObject_->emgFeatures;
+}
+
+bool MaxMyoListener::captureReference(int index) {
+    QuaternionFrame frame;
+    if (!quat_history[index].latest(frame)) return false;
+    orientation_reference[index] = toQuaternion(frame.values.data());
+    return true;
+}
+
+bool MaxMyoListener::regressing() const {
+    return gmr_recording || (maxObject_->gmrRun && gmr);
+}
+
+bool MaxMyoListener::extracting() {
+    if (!maxObject_->emgFeatures) return false;
+    long window = maxObject_->featuresWindow;
+    long hop = maxObject_->featuresHop;
+    if (window != features_window_ || hop != features_hop_) {
+        for (int i = 0; i < MAX_DEVICES; i++)
+            emg_features[i].configure(window, hop);
+        features_window_ = window;
+        features_hop_ = hop;
+    }
+    return true;
+}
+
+bool MaxMyoListener::resampling() {
+    bool enabled = maxObject_->resampleOutput != 0;
+    if (enabled && !resampling_)
+        for (int i = 0; i < MAX_DEVICES; i++) resetResamplers(i);
+    resampling_ = enabled;
+    return enabled;
+}
+
+void MaxMyoListener::resetResamplers(int index) {
+    emg_resampler[index].reset();
+    accel_resampler[index].reset();
+    gyro_resampler[index].reset();
+    quat_resampler[index].reset();
+}
+
+void MaxMyoListener::dispatch(InfoEvent const &event) {
+    ScopeTimer timer(stats.callbacks, stats.callback_total_ns,
+                     stats.callback_max_ns);
+    stats.events[event.type == InfoEvent::Pose ? ListenerStats::Pose
+                                               : ListenerStats::Info]
+        .add();
+    if (recorder) {
+        if (event.type == InfoEvent::Connect)
+            recorder->write(event, devices[event.device].name);
+        else
+            recorder->write(event);
+    }
+    if (!maxObject_->deferOutput) {
+        myo_output_event(maxObject_, event);
+        return;
+    }
+    enqueue(info_buffer, event, ListenerStats::InfoQueue);
+    scheduleDrain();
+}
+
+void MaxMyoListener::scheduleDrain() {
+    if (!drain_pending.exchange(true)) clock_delay(maxObject_->drain_clock, 0);
 }
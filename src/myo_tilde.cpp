@@ -0,0 +1,669 @@
+/**
+ *
+ * @file myo_tilde.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Max/MSP signal interface object for the Myo Armband
+ *
+ * [myo~] outputs the streams of a Myo as signals, one outlet per channel:
+ * the streams are given as arguments (emg, envelope, accel, gyro, quat).
+ * Frames are passed from the hub thread to the audio thread through
+ * lock-free ring buffers, placed on the audio timeline from their hardware
+ * timestamps (see SignalClock), and held or linearly interpolated between
+ * frames in the perform routine: signals are free of the jitter of the Max
+ * scheduler, without any message per frame.
+ *
+ * [mc.myo~] (or [myo~ @mc 1]) outputs each stream as a single multichannel
+ * signal instead (e.g. the 8 EMG channels on one patch cord): the channels
+ * of the outlets are the same, and so is the perform routine.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#if defined(WIN_VERSION)
+#define MAXAPI_USE_MSCRT
+#endif
+
+#include "ext.h"
+#include "ext_obex.h"
+#include "z_dsp.h"
+#include "envelope.hpp"
+#include "frames.hpp"
+#include "ringbuffer.hpp"
+#include "sharedhub.hpp"
+#include "timeline.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <myo/myo.hpp>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define atom_issym(a) ((a)->a_type == A_SYM)
+
+#define SIGNAL_RING_SIZE 1024  // frames between the hub and audio threads
+#define SIGNAL_QUEUE_SIZE 512  // frames waiting on the audio timeline
+#define SIGNAL_DELAY_DEFAULT 20.  // ms
+#define SIGNAL_DELAY_MAX 1000.    // ms
+
+typedef struct _myo_tilde t_myo_tilde;
+
+/// Frame of a signal stream, with at most 8 channels
+typedef TimedFrame<float, 8> SignalFrame;
+
+/// Streams output as signals
+enum SignalStreamType {
+    SignalEmg,       // raw EMG in [-1, 1]
+    SignalEnvelope,  // EMG envelope in [0, 1] (see EmgEnvelope)
+    SignalAccel,     // acceleration (g)
+    SignalGyro,      // angular velocity (deg/s)
+    SignalQuat,      // orientation (x, y, z, w)
+    NumSignalStreams
+};
+
+static const char *kSignalNames[NumSignalStreams] = {"emg", "envelope",
+                                                     "accel", "gyro", "quat"};
+static const int kSignalChannels[NumSignalStreams] = {8, 8, 3, 3, 4};
+static const uint64_t kSignalPeriods[NumSignalStreams] = {5000, 5000, 20000,
+                                                          20000, 20000};
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Myo Signal Listener
+#endif
+/**
+ * Listener of the device followed by a [myo~] object. Frames are pushed to
+ * the ring buffer of their stream on the hub thread; the perform routine
+ * pops them and places them on the audio timeline.
+ */
+class MaxMyoSignalListener : public myo::DeviceListener {
+  public:
+    MaxMyoSignalListener(t_myo_tilde *maxObject)
+        : device(NULL), restart(true), dropped(0), maxObject_(maxObject) {
+        for (int s = 0; s < NumSignalStreams; s++) {
+            rings[s].resize(SIGNAL_RING_SIZE);
+            signals[s].configure(kSignalChannels[s], SIGNAL_QUEUE_SIZE);
+            enabled[s] = false;
+            timestamps[s] = 0;
+        }
+    }
+
+    /// Streams output by the object (set at creation)
+    std::array<bool, NumSignalStreams> enabled;
+
+    /// Frames of each stream, from the hub thread to the audio thread
+    std::array<RingBuffer<SignalFrame>, NumSignalStreams> rings;
+
+    /// Frames of each stream on the audio timeline (audio thread)
+    std::array<SignalStream, NumSignalStreams> signals;
+
+    /// Offset of the clock of the device (audio thread)
+    SignalClock clock;
+
+    /// EMG envelope of the device (hub thread)
+    EmgEnvelope envelope;
+
+    /// Device followed by the object, and connected devices (hub thread, or
+    /// with a SharedHub::Lock)
+    myo::Myo *device;
+    std::vector<myo::Myo *> connected;
+
+    /// Requests the audio thread to drop the pending frames and to start a
+    /// new timeline
+    std::atomic<bool> restart;
+
+    /// Frames dropped because a ring buffer was full
+    std::atomic<uint64_t> dropped;
+
+    /// Follows the device selected by @device among the connected devices
+    /// (requires a SharedHub::Lock)
+    void bind();
+
+    /// Data streams consumed by the object (combination of
+    /// myo::Hub::EventMask)
+    unsigned int eventMask() const;
+
+    void onConnect(myo::Myo *myo, uint64_t timestamp,
+                   myo::FirmwareVersion firmwareVersion);
+    void onDisconnect(myo::Myo *myo, uint64_t timestamp);
+    void onEmgData(myo::Myo *myo, uint64_t timestamp, const int8_t *emg);
+    void onAccelerometerData(myo::Myo *myo, uint64_t timestamp,
+                             const myo::Vector3<float> &accel);
+    void onGyroscopeData(myo::Myo *myo, uint64_t timestamp,
+                         const myo::Vector3<float> &gyro);
+    void onOrientationData(myo::Myo *myo, uint64_t timestamp,
+                           const myo::Quaternion<float> &rotation);
+
+  protected:
+    /// Pushes a frame to the ring buffer of a stream
+    void push(int stream, uint64_t timestamp, float const *values);
+
+    /// Timestamp of the last frame of each stream (hub thread)
+    std::array<uint64_t, NumSignalStreams> timestamps;
+
+    t_myo_tilde *maxObject_;
+};
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Max Object Structure
+#endif
+struct _myo_tilde {
+    t_pxobject ob;  // MSP object header (must be first)
+
+    MaxMyoSignalListener *myoListener;
+    SharedHub *myoHub;
+    bool myo_connect_running;
+    bool listenerRunning;
+
+    // streams of the signal outlets, from left to right
+    int numStreams;
+    int streams[NumSignalStreams];
+    long numSignals;
+    long multichannel;  // one multichannel outlet per stream (at creation)
+
+    void *outlet_info;
+    t_clock *info_clock;
+
+    // audio thread
+    double sampleRate;
+    int64_t samples;  // samples since the start of the timeline
+
+    // attributes
+    t_symbol *deviceName;
+    double delay;         // ms
+    long interpolation;   // 0: hold, 1: linear
+    double envelopeDiffusion;
+    double envelopeJumpRate;
+};
+
+void *myo_tilde_new(t_symbol *s, long argc, t_atom *argv);
+void myo_tilde_free(t_myo_tilde *self);
+void myo_tilde_assist(t_myo_tilde *self, void *b, long m, long a, char *s);
+void myo_tilde_connect(t_myo_tilde *self, t_symbol *s, long argc,
+                       t_atom *argv);
+void myo_tilde_disconnect(t_myo_tilde *self);
+void myo_tilde_reset(t_myo_tilde *self);
+void myo_tilde_dropped(t_myo_tilde *self);
+void myo_tilde_sync(t_myo_tilde *self);
+long myo_tilde_multichanneloutputs(t_myo_tilde *self, long index);
+void myo_tilde_dsp64(t_myo_tilde *self, t_object *dsp64, short *count,
+                     double samplerate, long maxvectorsize, long flags);
+void myo_tilde_perform64(t_myo_tilde *self, t_object *dsp64, double **ins,
+                         long numins, double **outs, long numouts,
+                         long sampleframes, long flags, void *userparam);
+
+// Attribute accessors
+t_max_err myoTildeSetDeviceAttr(t_myo_tilde *self, void *attr, long ac,
+                                t_atom *av);
+t_max_err myoTildeSetMultichannelAttr(t_myo_tilde *self, void *attr, long ac,
+                                      t_atom *av);
+
+static t_symbol *sym_auto = gensym("auto");
+static t_symbol *sym_connected = gensym("connected");
+static t_symbol *sym_dropped = gensym("dropped");
+static t_symbol *sym_mc = gensym("@mc");
+static t_symbol *sym_mc_myo_tilde = gensym("mc.myo~");
+
+t_class *myo_tilde_class;
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Functions
+#endif
+// main method called only once in a Max session
+int C74_EXPORT main(void) {
+    t_class *c;
+
+    c = class_new("myo~", (method)myo_tilde_new, (method)myo_tilde_free,
+                  sizeof(t_myo_tilde), (method)NULL, A_GIMME, 0);
+
+    class_addmethod(c, (method)myo_tilde_dsp64, "dsp64", A_CANT, 0);
+    class_addmethod(c, (method)myo_tilde_multichanneloutputs,
+                    "multichanneloutputs", A_CANT, 0);
+    class_addmethod(c, (method)myo_tilde_connect, "connect", A_GIMME, 0);
+    class_addmethod(c, (method)myo_tilde_disconnect, "disconnect", 0);
+    class_addmethod(c, (method)myo_tilde_reset, "reset", 0);
+    class_addmethod(c, (method)myo_tilde_dropped, "dropped", 0);
+    class_addmethod(c, (method)myo_tilde_assist, "assist", A_CANT, 0);
+    class_dspinit(c);
+
+    // Device name
+    // ------------------------------
+    CLASS_ATTR_SYM(c, "device", 0, t_myo_tilde, deviceName);
+    CLASS_ATTR_ACCESSORS(c, "device", NULL, (method)myoTildeSetDeviceAttr);
+    CLASS_ATTR_LABEL(c, "device", 0, "Name of the myo device");
+
+    // Timeline
+    // ------------------------------
+    CLASS_ATTR_DOUBLE(c, "delay", 0, t_myo_tilde, delay);
+    CLASS_ATTR_FILTER_CLIP(c, "delay", 0., SIGNAL_DELAY_MAX);
+    CLASS_ATTR_LABEL(c, "delay", 0, "Delay of the Signals (ms)");
+
+    CLASS_ATTR_LONG(c, "interp", 0, t_myo_tilde, interpolation);
+    CLASS_ATTR_FILTER_MIN(c, "interp", 0);
+    CLASS_ATTR_FILTER_MAX(c, "interp", 1);
+    CLASS_ATTR_LABEL(c, "interp", 0, "Interpolation (0: hold, 1: linear)");
+
+    // Outlets
+    // ------------------------------
+    CLASS_ATTR_LONG(c, "mc", 0, t_myo_tilde, multichannel);
+    CLASS_ATTR_ACCESSORS(c, "mc", NULL, (method)myoTildeSetMultichannelAttr);
+    CLASS_ATTR_LABEL(c, "mc", 0, "Multichannel Outlets (at creation)");
+
+    // EMG envelope
+    // ------------------------------
+    CLASS_ATTR_DOUBLE(c, "diffusion", 0, t_myo_tilde, envelopeDiffusion);
+    CLASS_ATTR_FILTER_CLIP(c, "diffusion", 0., 0.5);
+    CLASS_ATTR_LABEL(c, "diffusion", 0, "EMG Envelope Diffusion Rate");
+
+    CLASS_ATTR_DOUBLE(c, "jumprate", 0, t_myo_tilde, envelopeJumpRate);
+    CLASS_ATTR_FILTER_CLIP(c, "jumprate", 0., 1.);
+    CLASS_ATTR_LABEL(c, "jumprate", 0, "EMG Envelope Jump Rate");
+
+    class_register(CLASS_BOX, c);
+    class_alias(c, sym_mc_myo_tilde);
+    myo_tilde_class = c;
+
+    return 0;
+}
+
+/**
+ * Constructor: [myo~ <streams>] creates the signal outlets of the given
+ * streams (emg, envelope, accel, gyro, quat; emg by default), from left to
+ * right, and an info outlet on the right. [mc.myo~] and @mc 1 create a
+ * multichannel outlet per stream: the outlets are created before the
+ * attributes are processed, so @mc is read from the arguments here.
+ */
+void *myo_tilde_new(t_symbol *s, long argc, t_atom *argv) {
+    t_myo_tilde *self;
+
+    self = (t_myo_tilde *)object_alloc(myo_tilde_class);
+
+    long ac = attr_args_offset((short)argc, argv);
+
+    if (self) {
+        dsp_setup((t_pxobject *)self, 1);
+        self->ob.z_misc |= Z_NO_INPLACE;
+
+        self->myoListener = new MaxMyoSignalListener(self);
+        self->myoHub = NULL;
+        self->listenerRunning = false;
+        self->numStreams = 0;
+        self->numSignals = 0;
+        self->sampleRate = 44100.;
+        self->samples = 0;
+        self->deviceName = sym_auto;
+        self->delay = SIGNAL_DELAY_DEFAULT;
+        self->interpolation = 1;
+        self->envelopeDiffusion = 0.1;
+        self->envelopeJumpRate = 1e-10;
+        self->multichannel = (s == sym_mc_myo_tilde);
+        for (long i = ac; i + 1 < argc; i++)
+            if (atom_issym(argv + i) && atom_getsym(argv + i) == sym_mc)
+                self->multichannel = atom_getlong(argv + i + 1) != 0;
+
+        for (long i = 0; i < ac; i++) {
+            t_symbol *name = atom_issym(argv + i) ? atom_getsym(argv + i)
+                                                  : gensym("");
+            int stream = 0;
+            while (stream < NumSignalStreams &&
+                   std::string(kSignalNames[stream]) != name->s_name)
+                stream++;
+            if (stream == NumSignalStreams) {
+                object_error((t_object *)self,
+                             "unknown stream %s (emg, envelope, accel, "
+                             "gyro or quat)",
+                             name->s_name);
+                continue;
+            }
+            if (self->myoListener->enabled[stream]) continue;
+            self->myoListener->enabled[stream] = true;
+            self->streams[self->numStreams++] = stream;
+            self->numSignals += kSignalChannels[stream];
+        }
+        if (self->numStreams == 0) {
+            self->myoListener->enabled[SignalEmg] = true;
+            self->streams[self->numStreams++] = SignalEmg;
+            self->numSignals = kSignalChannels[SignalEmg];
+        }
+
+        // outlets are created from right to left
+        self->outlet_info = outlet_new(self, NULL);
+        if (self->multichannel) {
+            for (int i = 0; i < self->numStreams; i++)
+                outlet_new(self, "multichannelsignal");
+        } else {
+            for (long i = 0; i < self->numSignals; i++)
+                outlet_new(self, "signal");
+        }
+        self->info_clock = clock_new(self, (method)myo_tilde_sync);
+
+        try {
+            // the hub and its event thread are shared by the [myo~] objects
+            self->myoHub = SharedHub::acquire();
+            self->myo_connect_running = true;
+        } catch (const std::exception &e) {
+            object_error((t_object *)self, e.what());
+            self->myo_connect_running = false;
+        }
+
+        // process attributes
+        attr_args_process(self, (short)argc, argv);
+    }
+    return (self);
+}
+
+/**
+ * Destructor
+ */
+void myo_tilde_free(t_myo_tilde *self) {
+    dsp_free((t_pxobject *)self);
+    myo_tilde_disconnect(self);
+
+    if (self->info_clock) {
+        clock_unset(self->info_clock);
+        object_free(self->info_clock);
+    }
+
+    if (self->myoListener) delete self->myoListener;
+    if (self->myoHub) SharedHub::release(self->myoHub);
+}
+
+/**
+ * inlet/outlet hover info
+ */
+void myo_tilde_assist(t_myo_tilde *self, void *b, long m, long a, char *s) {
+    if (m == ASSIST_INLET) {
+        sprintf(s, "connect, disconnect, reset");
+        return;
+    }
+    if (self->multichannel) {
+        if (a < self->numStreams)
+            sprintf(s, "(multichannel signal) %s (%d channels)",
+                    kSignalNames[self->streams[a]],
+                    kSignalChannels[self->streams[a]]);
+        else
+            sprintf(s, "info");
+        return;
+    }
+    for (int i = 0; i < self->numStreams; i++) {
+        int stream = self->streams[i];
+        if (a < kSignalChannels[stream]) {
+            sprintf(s, "(signal) %s %ld", kSignalNames[stream], a + 1);
+            return;
+        }
+        a -= kSignalChannels[stream];
+    }
+    sprintf(s, "info");
+}
+
+/**
+ * [connect]
+ * subscribes to the shared hub (starts the hub thread if needed)
+ */
+void myo_tilde_connect(t_myo_tilde *self, t_symbol *s, long argc,
+                       t_atom *argv) {
+    if (self->listenerRunning || !self->myo_connect_running) return;
+    std::string error = self->myoHub->error();
+    if (!error.empty()) object_error((t_object *)self, error.c_str());
+    self->listenerRunning = true;
+    {
+        SharedHub::Lock lock(*self->myoHub);
+        self->myoHub->setEventMask(self->myoListener,
+                                   self->myoListener->eventMask());
+    }
+    self->myoHub->subscribe(self->myoListener);
+}
+
+/**
+ * [disconnect]
+ * unsubscribes from the shared hub: the signals hold their last value
+ */
+void myo_tilde_disconnect(t_myo_tilde *self) {
+    if (!self->myo_connect_running || !self->listenerRunning) return;
+    self->myoHub->unsubscribe(self->myoListener);
+    self->listenerRunning = false;
+    {
+        SharedHub::Lock lock(*self->myoHub);
+        self->myoListener->device = NULL;
+        self->myoListener->connected.clear();
+    }
+    clock_delay(self->info_clock, 0);
+}
+
+/**
+ * [reset]
+ * drops the pending frames and starts a new timeline (e.g. after a long
+ * interruption of the audio thread)
+ */
+void myo_tilde_reset(t_myo_tilde *self) { self->myoListener->restart = true; }
+
+/**
+ * [dropped]
+ * outputs the number of frames dropped because the audio thread did not
+ * consume them (e.g. while the DSP is off)
+ */
+void myo_tilde_dropped(t_myo_tilde *self) {
+    t_atom value_out[2];
+    atom_setsym(value_out, sym_dropped);
+    atom_setlong(value_out + 1,
+                 static_cast<t_atom_long>(self->myoListener->dropped.load()));
+    outlet_list(self->outlet_info, NULL, 2, value_out);
+}
+
+/**
+ * outputs the name of the followed device from the info outlet (connected 0
+ * if none), from the clock set by the hub thread on connection events
+ */
+void myo_tilde_sync(t_myo_tilde *self) {
+    std::string name;
+    if (self->myo_connect_running) {
+        SharedHub::Lock lock(*self->myoHub);
+        if (self->myoListener->device)
+            name = self->myoListener->device->getName();
+    }
+    t_atom deviceInfo[2];
+    atom_setsym(deviceInfo, sym_connected);
+    if (!name.empty())
+        atom_setsym(deviceInfo + 1, gensym(name.c_str()));
+    else
+        atom_setlong(deviceInfo + 1, 0);
+    outlet_list(self->outlet_info, NULL, 2, deviceInfo);
+}
+
+/**
+ * [device <name>]
+ * follows the device of the given name, or the first connected device (auto)
+ */
+t_max_err myoTildeSetDeviceAttr(t_myo_tilde *self, void *attr, long ac,
+                                t_atom *av) {
+    if (ac < 1 || !atom_issym(av)) return MAX_ERR_NONE;
+    self->deviceName = atom_getsym(av);
+    if (self->myo_connect_running && self->listenerRunning) {
+        SharedHub::Lock lock(*self->myoHub);
+        self->myoListener->bind();
+    }
+    return MAX_ERR_NONE;
+}
+
+/**
+ * [mc <0/1>]
+ * the outlets are created with the object: @mc can only be set as argument
+ */
+t_max_err myoTildeSetMultichannelAttr(t_myo_tilde *self, void *attr, long ac,
+                                      t_atom *av) {
+    if (ac < 1) return MAX_ERR_NONE;
+    if ((atom_getlong(av) != 0) != (self->multichannel != 0))
+        object_error((t_object *)self,
+                     "mc can only be set at creation (mc.myo~ or @mc 1)");
+    return MAX_ERR_NONE;
+}
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Signal Processing
+#endif
+/**
+ * number of channels of a multichannel outlet (the channels of its stream)
+ */
+long myo_tilde_multichanneloutputs(t_myo_tilde *self, long index) {
+    if (!self->multichannel || index < 0 || index >= self->numStreams)
+        return 1;
+    return kSignalChannels[self->streams[index]];
+}
+
+/**
+ * adds the perform routine to the DSP chain, and starts a new timeline
+ */
+void myo_tilde_dsp64(t_myo_tilde *self, t_object *dsp64, short *count,
+                     double samplerate, long maxvectorsize, long flags) {
+    self->sampleRate = samplerate;
+    self->myoListener->restart = true;
+    object_method(dsp64, gensym("dsp_add64"), self, myo_tilde_perform64, 0,
+                  NULL);
+}
+
+/**
+ * places the frames received since the last vector on the audio timeline,
+ * and renders the signals of the vector. Frames received during a vector
+ * are given the time of the next vector as arrival time. The channels of
+ * the streams are consecutive in outs, with or without multichannel outlets.
+ */
+void myo_tilde_perform64(t_myo_tilde *self, t_object *dsp64, double **ins,
+                         long numins, double **outs, long numouts,
+                         long sampleframes, long flags, void *userparam) {
+    MaxMyoSignalListener *listener = self->myoListener;
+    SignalFrame frame;
+    if (listener->restart.exchange(false)) {
+        for (int s = 0; s < NumSignalStreams; s++) {
+            while (listener->rings[s].pop(frame)) continue;
+            listener->signals[s].reset();
+        }
+        listener->clock.reset();
+        self->samples = 0;
+    }
+
+    double period = 1e6 / self->sampleRate;
+    double start = self->samples * period;
+    double delay = self->delay * 1e3;
+    bool linear = self->interpolation != 0;
+    double **out = outs;
+    for (int i = 0; i < self->numStreams; i++) {
+        int stream = self->streams[i];
+        SignalStream &signal = listener->signals[stream];
+        while (listener->rings[stream].pop(frame))
+            signal.push(listener->clock.place(frame.timestamp, start) + delay,
+                        frame.values.data());
+        signal.render(start, period, sampleframes, linear, out);
+        out += kSignalChannels[stream];
+    }
+    self->samples += sampleframes;
+}
+
+#if defined(MAC_VERSION)
+#pragma mark -
+#pragma mark Myo Signal Listener: Methods
+#endif
+void MaxMyoSignalListener::bind() {
+    myo::Myo *selected = NULL;
+    for (std::size_t i = 0; i < connected.size() && !selected; i++) {
+        if (maxObject_->deviceName == sym_auto ||
+            connected[i]->getName() == maxObject_->deviceName->s_name)
+            selected = connected[i];
+    }
+    if (selected == device) return;
+    device = selected;
+    envelope.reset();
+    timestamps.fill(0);
+    restart = true;
+    std::vector<myo::Myo *> routed;
+    if (device) routed.push_back(device);
+    maxObject_->myoHub->route(this, routed);
+    clock_delay(maxObject_->info_clock, 0);
+}
+
+unsigned int MaxMyoSignalListener::eventMask() const {
+    unsigned int mask = 0;
+    if (enabled[SignalEmg] || enabled[SignalEnvelope])
+        mask |= myo::Hub::eventMaskEmg;
+    if (enabled[SignalAccel]) mask |= myo::Hub::eventMaskAccelerometer;
+    if (enabled[SignalGyro]) mask |= myo::Hub::eventMaskGyroscope;
+    if (enabled[SignalQuat]) mask |= myo::Hub::eventMaskOrientation;
+    return mask;
+}
+
+void MaxMyoSignalListener::onConnect(myo::Myo *myo, uint64_t timestamp,
+                                     myo::FirmwareVersion firmwareVersion) {
+    if (std::find(connected.begin(), connected.end(), myo) == connected.end())
+        connected.push_back(myo);
+    bind();
+}
+
+void MaxMyoSignalListener::onDisconnect(myo::Myo *myo, uint64_t timestamp) {
+    connected.erase(std::remove(connected.begin(), connected.end(), myo),
+                    connected.end());
+    bind();
+}
+
+void MaxMyoSignalListener::onEmgData(myo::Myo *myo, uint64_t timestamp,
+                                     const int8_t *emg) {
+    if (myo != device) return;
+    float values[8];
+    if (enabled[SignalEmg]) {
+        for (int c = 0; c < 8; c++) values[c] = emg[c] / 127.f;
+        push(SignalEmg, timestamp, values);
+    }
+    if (enabled[SignalEnvelope]) {
+        envelope.setRates(static_cast<float>(maxObject_->envelopeDiffusion),
+                          static_cast<float>(maxObject_->envelopeJumpRate));
+        envelope.update(emg, values);
+        push(SignalEnvelope, timestamp, values);
+    }
+}
+
+void MaxMyoSignalListener::onAccelerometerData(
+    myo::Myo *myo, uint64_t timestamp, const myo::Vector3<float> &accel) {
+    if (myo != device) return;
+    float values[3] = {accel.x(), accel.y(), accel.z()};
+    push(SignalAccel, timestamp, values);
+}
+
+void MaxMyoSignalListener::onGyroscopeData(myo::Myo *myo, uint64_t timestamp,
+                                           const myo::Vector3<float> &gyro) {
+    if (myo != device) return;
+    float values[3] = {gyro.x(), gyro.y(), gyro.z()};
+    push(SignalGyro, timestamp, values);
+}
+
+void MaxMyoSignalListener::onOrientationData(
+    myo::Myo *myo, uint64_t timestamp, const myo::Quaternion<float> &rotation) {
+    if (myo != device) return;
+    float values[4] = {rotation.x(), rotation.y(), rotation.z(),
+                       rotation.w()};
+    push(SignalQuat, timestamp, values);
+}
+
+void MaxMyoSignalListener::push(int stream, uint64_t timestamp,
+                                float const *values) {
+    if (!enabled[stream]) return;
+    // the samples of a packet share its timestamp (e.g. two EMG samples):
+    // they are placed one period apart, as by the Resampler
+    uint64_t period = kSignalPeriods[stream];
+    if (timestamp <= timestamps[stream] &&
+        timestamps[stream] - timestamp < 10 * period)
+        timestamp = timestamps[stream] + period;
+    timestamps[stream] = timestamp;
+    SignalFrame frame;
+    frame.timestamp = timestamp;
+    frame.device = 0;
+    frame.values.fill(0.f);
+    std::copy(values, values + kSignalChannels[stream], frame.values.begin());
+    if (!rings[stream].push(frame)) dropped++;
+}
@@ -0,0 +1,84 @@
+/**
+ *
+ * @file orientation.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Euler angles, rotation matrix and relative orientation of a Myo
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_ORIENTATION_HPP
+#define MAXMYO_ORIENTATION_HPP
+
+#include <cmath>
+#include <myo/cxx/Quaternion.hpp>
+
+/// Quaternion of the values of an orientation frame (x, y, z, w)
+inline myo::Quaternion<float> toQuaternion(float const *values) {
+    return myo::Quaternion<float>(values[0], values[1], values[2], values[3]);
+}
+
+/// Orientation relative to a reference orientation: the rotation from the
+/// reference to the orientation, in the frame of the reference
+inline myo::Quaternion<float> relativeOrientation(
+    myo::Quaternion<float> const &reference,
+    myo::Quaternion<float> const &orientation) {
+    return reference.conjugate() * orientation;
+}
+
+/**
+ * Rotates a vector by an orientation, from the frame of the armband to the
+ * world frame. Same result as myo::rotate (q v q*), expanded as
+ * v + 2 w (u x v) + 2 u x (u x v) with u the vector part of q: 15
+ * multiplications instead of the two quaternion products, and no branches.
+ */
+inline void rotateVector(myo::Quaternion<float> const &q, float const *v,
+                         float *out) {
+    float x = q.x(), y = q.y(), z = q.z(), w = q.w();
+    float tx = 2.f * (y * v[2] - z * v[1]);
+    float ty = 2.f * (z * v[0] - x * v[2]);
+    float tz = 2.f * (x * v[1] - y * v[0]);
+    out[0] = v[0] + w * tx + (y * tz - z * ty);
+    out[1] = v[1] + w * ty + (z * tx - x * tz);
+    out[2] = v[2] + w * tz + (x * ty - y * tx);
+}
+
+/**
+ * Yaw, pitch and roll of an orientation in degrees (Tait-Bryan angles about
+ * z, y and x, as in the samples of the Myo SDK). Pitch is in [-90, 90], yaw
+ * and roll in [-180, 180].
+ */
+inline void eulerAngles(myo::Quaternion<float> const &q, float *ypr) {
+    const float degrees = 57.29577951308232f;
+    float x = q.x(), y = q.y(), z = q.z(), w = q.w();
+    float sin_pitch = 2.f * (w * y - z * x);
+    sin_pitch = sin_pitch > 1.f ? 1.f : (sin_pitch < -1.f ? -1.f : sin_pitch);
+    ypr[0] = degrees *
+             std::atan2(2.f * (w * z + x * y), 1.f - 2.f * (y * y + z * z));
+    ypr[1] = degrees * std::asin(sin_pitch);
+    ypr[2] = degrees *
+             std::atan2(2.f * (w * x + y * z), 1.f - 2.f * (x * x + y * y));
+}
+
+/// Rotation matrix of an orientation (3 x 3, row-major): rotates vectors
+/// from the frame of the armband to the world frame
+inline void rotationMatrix(myo::Quaternion<float> const &q, float *m) {
+    float x = q.x(), y = q.y(), z = q.z(), w = q.w();
+    m[0] = 1.f - 2.f * (y * y + z * z);
+    m[1] = 2.f * (x * y - z * w);
+    m[2] = 2.f * (x * z + y * w);
+    m[3] = 2.f * (x * y + z * w);
+    m[4] = 1.f - 2.f * (x * x + z * z);
+    m[5] = 2.f * (y * z - x * w);
+    m[6] = 2.f * (x * z - y * w);
+    m[7] = 2.f * (y * z + x * w);
+    m[8] = 1.f - 2.f * (x * x + y * y);
+}
+
+#endif
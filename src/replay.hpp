@@ -0,0 +1,118 @@
+/**
+ *
+ * @file replay.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Replay of recorded Myo sessions
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_REPLAY_HPP
+#define MAXMYO_REPLAY_HPP
+
+#include "session.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Plays a session file on a dedicated thread, paced by the hardware
+ * timestamps of the records (scaled by the speed factor), or as fast as
+ * possible if the speed is 0.
+ */
+class SessionPlayer {
+  public:
+    /// Receives the records of the session, on the player thread
+    class Listener {
+      public:
+        virtual ~Listener() {}
+
+        virtual void onRecord(SessionRecord const &record) = 0;
+
+        /// Called after the last record, unless the player was stopped
+        virtual void onEnd() {}
+    };
+
+    SessionPlayer() : listener_(NULL), speed_(1.), stop_(false) {}
+
+    ~SessionPlayer() { stop(); }
+
+    /// Starts playing a session file. Returns false if the file cannot be
+    /// opened or is not a session file.
+    bool start(std::string const &path, Listener *listener, double speed) {
+        stop();
+        if (!reader_.open(path)) return false;
+        listener_ = listener;
+        speed_ = speed < 0. ? 0. : speed;
+        stop_ = false;
+        thread_ = std::thread(&SessionPlayer::run, this);
+        return true;
+    }
+
+    /// Stops playing and waits for the player thread
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        if (thread_.joinable()) thread_.join();
+        reader_.close();
+    }
+
+    bool isPlaying() const { return thread_.joinable(); }
+
+  private:
+    SessionPlayer(SessionPlayer const &);
+    SessionPlayer &operator=(SessionPlayer const &);
+
+    typedef std::chrono::steady_clock Clock;
+
+    /// Player thread: reads and sends the records until the end of the file
+    void run() {
+        SessionRecord record;
+        bool first = true;
+        uint64_t origin = 0;
+        Clock::time_point start = Clock::now();
+        while (reader_.read(record)) {
+            if (first) origin = record.timestamp;
+            first = false;
+            if (speed_ > 0. && record.timestamp > origin) {
+                Clock::time_point target =
+                    start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double, std::micro>(
+                                    static_cast<double>(record.timestamp -
+                                                        origin) /
+                                    speed_));
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (condition_.wait_until(lock, target,
+                                          [this] { return stop_.load(); }))
+                    return;
+            } else if (stop_) {
+                return;
+            }
+            listener_->onRecord(record);
+        }
+        listener_->onEnd();
+    }
+
+    SessionReader reader_;
+    Listener *listener_;
+    double speed_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<bool> stop_;  // set with mutex_ locked
+};
+
+#endif
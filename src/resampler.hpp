@@ -0,0 +1,184 @@
+/**
+ *
+ * @file resampler.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Reconstruction of uniformly sampled streams from bursty frames
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_RESAMPLER_HPP
+#define MAXMYO_RESAMPLER_HPP
+
+#include "frames.hpp"
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+/// Linear interpolation of the values of two frames (t in [0, 1])
+template <typename T, std::size_t N>
+void interpolate(TimedFrame<T, N> const &a, TimedFrame<T, N> const &b,
+                 float t, TimedFrame<T, N> &out) {
+    for (std::size_t i = 0; i < N; i++) {
+        float value = a.values[i] + t * (b.values[i] - a.values[i]);
+        // round integer samples (e.g. raw EMG) to the nearest value
+        out.values[i] = static_cast<T>(
+            std::is_integral<T>::value ? std::floor(value + 0.5f) : value);
+    }
+}
+
+/// Spherical linear interpolation of two orientations (t in [0, 1])
+inline void interpolate(QuaternionFrame const &a, QuaternionFrame const &b,
+                        float t, QuaternionFrame &out) {
+    float dot = 0.f;
+    for (int i = 0; i < 4; i++) dot += a.values[i] * b.values[i];
+    // q and -q are the same rotation: take the shortest path
+    float sign = dot < 0.f ? -1.f : 1.f;
+    dot *= sign;
+    float wa = 1.f - t;
+    float wb = t;
+    if (dot < 0.9995f) {
+        float theta = std::acos(dot);
+        float s = std::sin(theta);
+        wa = std::sin((1.f - t) * theta) / s;
+        wb = std::sin(t * theta) / s;
+    }
+    float norm = 0.f;
+    for (int i = 0; i < 4; i++) {
+        out.values[i] = wa * a.values[i] + wb * sign * b.values[i];
+        norm += out.values[i] * out.values[i];
+    }
+    // nearly parallel orientations are interpolated linearly: normalize
+    norm = std::sqrt(norm);
+    if (norm > 0.f)
+        for (int i = 0; i < 4; i++) out.values[i] /= norm;
+}
+
+/**
+ * Reconstructs a uniformly sampled stream from frames delivered in bursts.
+ * The Myo sends its samples in packets (e.g. two EMG samples with the same
+ * timestamp), and the link batches packets: frames whose timestamp does not
+ * advance past the previous frame are placed one period after it. Output frames are
+ * interpolated on a regular grid of timestamps, from the first frame: a frame
+ * is output as soon as the input frame that follows its timestamp is
+ * received, so the added latency is at most the interval between two input
+ * frames. After a gap longer than max_gap (lost link, disconnection), the
+ * grid restarts at the next frame instead of interpolating over the gap.
+ */
+template <typename Frame>
+class Resampler {
+  public:
+    explicit Resampler(uint64_t period_us = 5000, uint64_t max_gap_us = 50000)
+        : period_(period_us), max_gap_(max_gap_us) {
+        reset();
+    }
+
+    /// Restarts the grid at the next frame
+    void reset() {
+        started_ = false;
+        last_raw_ = 0;
+        last_time_ = 0;
+        next_ = 0;
+    }
+
+    /// Adds an input frame, and calls output(frame) for each frame of the
+    /// grid up to its time
+    template <typename Output>
+    void push(Frame const &frame, Output output) {
+        uint64_t time = frame.timestamp;
+        if (started_) {
+            if (time < last_raw_) return;  // out of order
+            // continues a burst
+            if (time <= last_time_) time = last_time_ + period_;
+        }
+        last_raw_ = frame.timestamp;
+
+        if (!started_ || time - last_time_ > max_gap_) {
+            started_ = true;
+            last_ = frame;
+            last_time_ = time;
+            last_.timestamp = time;
+            next_ = time + period_;
+            output(last_);
+            return;
+        }
+
+        Frame out = frame;
+        float interval = static_cast<float>(time - last_time_);
+        for (; next_ <= time; next_ += period_) {
+            out.timestamp = next_;
+            interpolate(last_, frame,
+                        static_cast<float>(next_ - last_time_) / interval,
+                        out);
+            output(out);
+        }
+        last_ = frame;
+        last_time_ = time;
+    }
+
+  private:
+    uint64_t period_;
+    uint64_t max_gap_;
+    bool started_;
+    Frame last_;          // last input frame
+    uint64_t last_raw_;   // hardware timestamp of the last input frame
+    uint64_t last_time_;  // time of the last input frame (after spreading)
+    uint64_t next_;       // timestamp of the next output frame
+};
+
+/**
+ * Last two frames of a stream, to estimate its value at the time of another
+ * stream without waiting for the next frame: the value is interpolated
+ * between the two frames, or held from the nearest one outside of them.
+ */
+template <typename Frame>
+class FrameHistory {
+  public:
+    FrameHistory() : size_(0) {}
+
+    void reset() { size_ = 0; }
+
+    void push(Frame const &frame) {
+        previous_ = latest_;
+        latest_ = frame;
+        if (size_ < 2) size_++;
+    }
+
+    /// Latest frame (false if no frame was pushed)
+    bool latest(Frame &out) const {
+        if (size_ == 0) return false;
+        out = latest_;
+        return true;
+    }
+
+    /// Estimates the frame at the given time (false if no frame was pushed)
+    bool at(uint64_t timestamp, Frame &out) const {
+        if (size_ == 0) return false;
+        if (size_ == 1 || timestamp >= latest_.timestamp) {
+            out = latest_;
+        } else if (timestamp <= previous_.timestamp) {
+            out = previous_;
+        } else {
+            out = latest_;
+            interpolate(previous_, latest_,
+                        static_cast<float>(timestamp - previous_.timestamp) /
+                            (latest_.timestamp - previous_.timestamp),
+                        out);
+        }
+        out.timestamp = timestamp;
+        return true;
+    }
+
+  private:
+    int size_;
+    Frame previous_;
+    Frame latest_;
+};
+
+#endif
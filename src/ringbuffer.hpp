@@ -0,0 +1,142 @@
+/**
+ *
+ * @file ringbuffer.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Lock-free single-producer/single-consumer ring buffer and latest value
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_RINGBUFFER_HPP
+#define MAXMYO_RINGBUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Fixed-capacity ring buffer for exactly one producer thread and one consumer
+ * thread. Neither side ever blocks: push() fails when the buffer is full and
+ * pop() fails when it is empty. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class RingBuffer {
+  public:
+    explicit RingBuffer(std::size_t capacity = 64)
+        : write_index_(0), read_index_(0) {
+        resize(capacity);
+    }
+
+    /// Change the capacity, discarding pending values. This is not
+    /// thread-safe: both the producer and the consumer must be idle.
+    void resize(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buffer_.assign(size, T());
+        mask_ = size - 1;
+        write_index_.store(0, std::memory_order_relaxed);
+        read_index_.store(0, std::memory_order_relaxed);
+    }
+
+    /// Producer side: append a value, returns false if the buffer is full.
+    bool push(T const &value) {
+        std::size_t const w = write_index_.load(std::memory_order_relaxed);
+        if (w - read_index_.load(std::memory_order_acquire) > mask_)
+            return false;
+        buffer_[w & mask_] = value;
+        write_index_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side: remove the oldest value, returns false if empty.
+    bool pop(T &value) {
+        std::size_t const r = read_index_.load(std::memory_order_relaxed);
+        if (r == write_index_.load(std::memory_order_acquire)) return false;
+        value = buffer_[r & mask_];
+        read_index_.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side: drop every pending value, keeping only the most recent
+    /// one in value. Returns false if the buffer was empty.
+    bool popLatest(T &value) {
+        std::size_t const r = read_index_.load(std::memory_order_relaxed);
+        std::size_t const w = write_index_.load(std::memory_order_acquire);
+        if (r == w) return false;
+        value = buffer_[(w - 1) & mask_];
+        read_index_.store(w, std::memory_order_release);
+        return true;
+    }
+
+    /// Number of pending values (approximate if called concurrently).
+    std::size_t size() const {
+        return write_index_.load(std::memory_order_acquire) -
+               read_index_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+  private:
+    RingBuffer(RingBuffer const &);
+    RingBuffer &operator=(RingBuffer const &);
+
+    std::vector<T> buffer_;
+    std::size_t mask_;
+
+    // Producer and consumer indices live on separate cache lines so that the
+    // two threads do not invalidate each other's cache on every access.
+    char padding_head_[64];
+    std::atomic<std::size_t> write_index_;
+    char padding_middle_[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> read_index_;
+};
+
+/**
+ * Latest value written by exactly one producer thread and read by exactly
+ * one consumer thread (triple buffering). Neither side ever blocks: write()
+ * replaces the value that was not read yet, and read() returns the most
+ * recent value written since the last read, however long ago it was called.
+ */
+template <typename T>
+class LatestValue {
+  public:
+    LatestValue() : back_(0), middle_(1), front_(2) {}
+
+    /// Producer side: publish a value, replacing the unread one.
+    void write(T const &value) {
+        buffer_[back_] = value;
+        back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+                kIndex;
+    }
+
+    /// Consumer side: get the value written since the last read, returns
+    /// false if there is none.
+    bool read(T &value) {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+        value = buffer_[front_];
+        return true;
+    }
+
+  private:
+    LatestValue(LatestValue const &);
+    LatestValue &operator=(LatestValue const &);
+
+    static const int kIndex = 3;  // slot of the middle value
+    static const int kFresh = 4;  // set when the middle value was not read
+
+    T buffer_[3];
+    int back_;                  // slot written by the producer
+    std::atomic<int> middle_;   // slot exchanged by both sides, and kFresh
+    int front_;                 // slot read by the consumer
+};
+
+#endif
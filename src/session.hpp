@@ -0,0 +1,489 @@
+/**
+ *
+ * @file session.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Binary session files: recording and reading of Myo sessions
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_SESSION_HPP
+#define MAXMYO_SESSION_HPP
+
+#include "frames.hpp"
+#include "ringbuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Session file format (all values little-endian):
+ *
+ *   header  : "MYOS" | uint16 version | uint16 reserved | uint64 start time
+ *             (microseconds since the Unix epoch)
+ *   records : uint8 type | uint8 device | uint16 payload size |
+ *             uint64 hardware timestamp (us) | payload
+ *
+ * Payloads:
+ *   Emg        8 x int8 (raw)
+ *   Accel/Gyro 3 x float32
+ *   Quat       4 x float32 (x, y, z, w)
+ *   Pose       uint16 pose type
+ *   ArmSync    uint8 arm | uint8 x direction | uint8 warmup state |
+ *              float32 rotation on arm
+ *   Rssi       int8
+ *   Battery    uint8
+ *   Connect    device name (not null-terminated)
+ *   ArmUnsync, Disconnect: empty
+ *
+ * Readers skip records of unknown type using the payload size.
+ */
+
+/**
+ * Record of a session file, as decoded by SessionReader
+ */
+struct SessionRecord {
+    enum Type {
+        Emg = 1,
+        Accel,
+        Gyro,
+        Quat,
+        Pose,
+        ArmSync,
+        ArmUnsync,
+        Rssi,
+        Battery,
+        Connect,
+        Disconnect
+    };
+
+    Type type;
+    uint8_t device;
+    uint64_t timestamp;
+
+    /// Raw EMG values (Emg)
+    int8_t emg[8];
+
+    /// Accel/Gyro (x, y, z), Quat (x, y, z, w), rotation on arm (ArmSync)
+    float values[4];
+
+    /// Pose type, RSSI or battery level in info[0]. For arm synchronization:
+    /// arm, x direction and warmup state.
+    int info[3];
+
+    /// Device name (Connect)
+    std::string name;
+};
+
+namespace session {
+
+static const char kMagic[4] = {'M', 'Y', 'O', 'S'};
+static const uint16_t kVersion = 1;
+static const std::size_t kHeaderSize = 16;
+static const std::size_t kRecordHeaderSize = 12;
+
+inline void putU16(char *p, uint16_t v) {
+    p[0] = static_cast<char>(v & 0xff);
+    p[1] = static_cast<char>(v >> 8);
+}
+
+inline void putU32(char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+inline void putU64(char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+inline void putF32(char *p, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    putU32(p, bits);
+}
+
+inline uint16_t getU16(unsigned char const *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getU32(unsigned char const *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+inline uint64_t getU64(unsigned char const *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+inline float getF32(unsigned char const *p) {
+    uint32_t bits = getU32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+}  // namespace session
+
+/**
+ * Append-only session recorder.
+ *
+ * Records are encoded by the producer (the hub thread) into preallocated
+ * chunks, and full chunks are written to disk by a dedicated writer thread.
+ * Chunks are exchanged through lock-free rings, so that recording never
+ * blocks the producer: if the writer falls behind and no free chunk is
+ * available, records are dropped and counted.
+ *
+ * The write methods and close() must not be called concurrently.
+ */
+class SessionWriter {
+  public:
+    SessionWriter(std::size_t chunkSize = 1 << 16, std::size_t numChunks = 16)
+        : chunks_(numChunks),
+          free_(numChunks),
+          full_(numChunks),
+          current_(NULL),
+          file_(NULL),
+          running_(false),
+          dropped_(0),
+          records_(0) {
+        for (std::size_t i = 0; i < chunks_.size(); i++) {
+            chunks_[i].data.resize(chunkSize);
+            chunks_[i].size = 0;
+        }
+    }
+
+    ~SessionWriter() { close(); }
+
+    /// Creates the file, writes the header and starts the writer thread.
+    /// Returns false if the file cannot be created.
+    bool open(std::string const &path) {
+        close();
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) return false;
+        char header[session::kHeaderSize];
+        std::memcpy(header, session::kMagic, 4);
+        session::putU16(header + 4, session::kVersion);
+        session::putU16(header + 6, 0);
+        session::putU64(header + 8,
+                        static_cast<uint64_t>(
+                            std::chrono::duration_cast<
+                                std::chrono::microseconds>(
+                                std::chrono::system_clock::now()
+                                    .time_since_epoch())
+                                .count()));
+        std::fwrite(header, 1, sizeof(header), file_);
+        Chunk *chunk;
+        while (free_.pop(chunk)) {
+        }
+        while (full_.pop(chunk)) {
+        }
+        for (std::size_t i = 1; i < chunks_.size(); i++) {
+            chunks_[i].size = 0;
+            free_.push(&chunks_[i]);
+        }
+        current_ = &chunks_[0];
+        current_->size = 0;
+        dropped_ = 0;
+        records_ = 0;
+        running_ = true;
+        thread_ = std::thread(&SessionWriter::run, this);
+        return true;
+    }
+
+    /// Writes the pending records and closes the file
+    void close() {
+        if (!file_) return;
+        if (current_ && current_->size > 0) full_.push(current_);
+        current_ = NULL;
+        running_ = false;
+        if (thread_.joinable()) thread_.join();
+        std::fclose(file_);
+        file_ = NULL;
+    }
+
+    bool isOpen() const { return file_ != NULL; }
+
+    /// Number of records dropped because the writer fell behind
+    unsigned long dropped() const { return dropped_; }
+
+    /// Number of records written
+    unsigned long records() const { return records_; }
+
+    void write(EmgFrame const &frame) {
+        char *p = reserve(SessionRecord::Emg, frame.device, frame.timestamp, 8);
+        if (!p) return;
+        for (int i = 0; i < 8; i++) p[i] = static_cast<char>(frame.values[i]);
+    }
+
+    void writeAccel(Vector3Frame const &frame) {
+        writeVector(SessionRecord::Accel, frame);
+    }
+
+    void writeGyro(Vector3Frame const &frame) {
+        writeVector(SessionRecord::Gyro, frame);
+    }
+
+    void write(QuaternionFrame const &frame) {
+        char *p =
+            reserve(SessionRecord::Quat, frame.device, frame.timestamp, 16);
+        if (!p) return;
+        for (int i = 0; i < 4; i++) session::putF32(p + 4 * i, frame.values[i]);
+    }
+
+    /// Writes an info event (the name is only written for connections)
+    void write(InfoEvent const &event, std::string const &name = "") {
+        char *p;
+        switch (event.type) {
+            case InfoEvent::Connect:
+                p = reserve(SessionRecord::Connect, event.device,
+                            event.timestamp, name.size());
+                if (p && !name.empty()) std::memcpy(p, name.data(), name.size());
+                break;
+
+            case InfoEvent::Disconnect:
+                reserve(SessionRecord::Disconnect, event.device,
+                        event.timestamp, 0);
+                break;
+
+            case InfoEvent::ArmSync:
+                p = reserve(SessionRecord::ArmSync, event.device,
+                            event.timestamp, 7);
+                if (!p) return;
+                for (int i = 0; i < 3; i++)
+                    p[i] = static_cast<char>(event.values[i]);
+                session::putF32(p + 3, event.rotation);
+                break;
+
+            case InfoEvent::ArmUnsync:
+                reserve(SessionRecord::ArmUnsync, event.device,
+                        event.timestamp, 0);
+                break;
+
+            case InfoEvent::Rssi:
+                p = reserve(SessionRecord::Rssi, event.device, event.timestamp,
+                            1);
+                if (p) p[0] = static_cast<char>(event.values[0]);
+                break;
+
+            case InfoEvent::Battery:
+                p = reserve(SessionRecord::Battery, event.device,
+                            event.timestamp, 1);
+                if (p) p[0] = static_cast<char>(event.values[0]);
+                break;
+
+            case InfoEvent::Pose:
+                p = reserve(SessionRecord::Pose, event.device, event.timestamp,
+                            2);
+                if (p)
+                    session::putU16(p, static_cast<uint16_t>(event.values[0]));
+                break;
+        }
+    }
+
+  private:
+    struct Chunk {
+        std::vector<char> data;
+        std::size_t size;
+    };
+
+    SessionWriter(SessionWriter const &);
+    SessionWriter &operator=(SessionWriter const &);
+
+    void writeVector(SessionRecord::Type type, Vector3Frame const &frame) {
+        char *p = reserve(type, frame.device, frame.timestamp, 12);
+        if (!p) return;
+        for (int i = 0; i < 3; i++) session::putF32(p + 4 * i, frame.values[i]);
+    }
+
+    /// Producer side: writes a record header and returns the location of its
+    /// payload, or NULL if the record is dropped
+    char *reserve(SessionRecord::Type type, uint8_t device, uint64_t timestamp,
+                  std::size_t payloadSize) {
+        if (!current_) return NULL;
+        std::size_t size = session::kRecordHeaderSize + payloadSize;
+        if (payloadSize > 0xffff || size > current_->data.size()) {
+            dropped_++;
+            return NULL;
+        }
+        if (current_->size + size > current_->data.size()) {
+            Chunk *next;
+            if (!free_.pop(next)) {
+                dropped_++;
+                return NULL;
+            }
+            full_.push(current_);
+            current_ = next;
+            current_->size = 0;
+        }
+        char *p = &current_->data[current_->size];
+        p[0] = static_cast<char>(type);
+        p[1] = static_cast<char>(device);
+        session::putU16(p + 2, static_cast<uint16_t>(payloadSize));
+        session::putU64(p + 4, timestamp);
+        current_->size += size;
+        records_++;
+        return p + session::kRecordHeaderSize;
+    }
+
+    /// Writer thread: writes full chunks until closed
+    void run() {
+        for (;;) {
+            Chunk *chunk;
+            if (full_.pop(chunk)) {
+                std::fwrite(&chunk->data[0], 1, chunk->size, file_);
+                chunk->size = 0;
+                free_.push(chunk);
+            } else if (!running_) {
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+        std::fflush(file_);
+    }
+
+    std::vector<Chunk> chunks_;
+    RingBuffer<Chunk *> free_;  // written by the writer thread
+    RingBuffer<Chunk *> full_;  // written by the producer
+    Chunk *current_;            // chunk being filled by the producer
+
+    FILE *file_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned long> dropped_;
+    std::atomic<unsigned long> records_;
+};
+
+/**
+ * Sequential reader of session files
+ */
+class SessionReader {
+  public:
+    SessionReader() : file_(NULL), startTime_(0) {}
+
+    ~SessionReader() { close(); }
+
+    /// Opens a session file and reads its header. Returns false if the file
+    /// cannot be opened or is not a session file of a supported version.
+    bool open(std::string const &path) {
+        close();
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_) return false;
+        unsigned char header[session::kHeaderSize];
+        if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+            std::memcmp(header, session::kMagic, 4) != 0 ||
+            session::getU16(header + 4) > session::kVersion) {
+            close();
+            return false;
+        }
+        startTime_ = session::getU64(header + 8);
+        return true;
+    }
+
+    void close() {
+        if (file_) std::fclose(file_);
+        file_ = NULL;
+    }
+
+    /// Start time of the recording (microseconds since the Unix epoch)
+    uint64_t startTime() const { return startTime_; }
+
+    /// Reads the next record. Returns false at the end of the file (a
+    /// truncated last record is ignored).
+    bool read(SessionRecord &record) {
+        if (!file_) return false;
+        for (;;) {
+            unsigned char header[session::kRecordHeaderSize];
+            if (std::fread(header, 1, sizeof(header), file_) != sizeof(header))
+                return false;
+            std::size_t size = session::getU16(header + 2);
+            payload_.resize(size);
+            if (size > 0 &&
+                std::fread(&payload_[0], 1, size, file_) != size)
+                return false;
+            record.type = static_cast<SessionRecord::Type>(header[0]);
+            record.device = header[1];
+            record.timestamp = session::getU64(header + 4);
+            if (decode(record, size)) return true;
+        }
+    }
+
+  private:
+    SessionReader(SessionReader const &);
+    SessionReader &operator=(SessionReader const &);
+
+    /// Decodes the payload, returns false for unknown or malformed records
+    bool decode(SessionRecord &record, std::size_t size) {
+        unsigned char const *p = size > 0 ? &payload_[0] : NULL;
+        record.name.clear();
+        switch (record.type) {
+            case SessionRecord::Emg:
+                if (size < 8) return false;
+                for (int i = 0; i < 8; i++)
+                    record.emg[i] = static_cast<int8_t>(p[i]);
+                return true;
+
+            case SessionRecord::Accel:
+            case SessionRecord::Gyro:
+                if (size < 12) return false;
+                for (int i = 0; i < 3; i++)
+                    record.values[i] = session::getF32(p + 4 * i);
+                return true;
+
+            case SessionRecord::Quat:
+                if (size < 16) return false;
+                for (int i = 0; i < 4; i++)
+                    record.values[i] = session::getF32(p + 4 * i);
+                return true;
+
+            case SessionRecord::Pose:
+                if (size < 2) return false;
+                record.info[0] = session::getU16(p);
+                return true;
+
+            case SessionRecord::ArmSync:
+                if (size < 7) return false;
+                for (int i = 0; i < 3; i++) record.info[i] = p[i];
+                record.values[0] = session::getF32(p + 3);
+                return true;
+
+            case SessionRecord::Rssi:
+                if (size < 1) return false;
+                record.info[0] = static_cast<int8_t>(p[0]);
+                return true;
+
+            case SessionRecord::Battery:
+                if (size < 1) return false;
+                record.info[0] = p[0];
+                return true;
+
+            case SessionRecord::Connect:
+                if (size > 0)
+                    record.name.assign(reinterpret_cast<char const *>(p), size);
+                return true;
+
+            case SessionRecord::ArmUnsync:
+            case SessionRecord::Disconnect:
+                return true;
+        }
+        return false;
+    }
+
+    FILE *file_;
+    uint64_t startTime_;
+    std::vector<unsigned char> payload_;
+};
+
+#endif
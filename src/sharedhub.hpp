@@ -0,0 +1,432 @@
+/**
+ *
+ * @file sharedhub.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Process-wide Myo hub shared by all [myo] objects
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_SHAREDHUB_HPP
+#define MAXMYO_SHAREDHUB_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include "stats.hpp"
+#include <chrono>
+#include <myo/myo.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Single myo::Hub and event thread shared by every object of the process.
+ *
+ * Objects register their listener with subscribe() and bind it to the device
+ * they follow with route(). Connection events are forwarded to every
+ * subscriber, while data events are only forwarded to the listeners routed to
+ * the device that produced them, so that an event costs nothing to the
+ * objects following another armband.
+ *
+ * Each listener also selects the data streams it consumes with
+ * setEventMask(). The hub only decodes the streams consumed by at least one
+ * routed listener, and only enables EMG streaming on the devices that have an
+ * EMG consumer.
+ *
+ * The event thread runs while there is at least one subscriber, and holds
+ * the hub mutex while running the libmyo event loop: the routing tables can
+ * only be modified with a SharedHub::Lock, or from a listener callback. The
+ * event loop runs in slices of slice() milliseconds, but a slice is
+ * interrupted after the current event as soon as a Lock is waiting, so that
+ * control operations do not wait for the end of the slice.
+ */
+class SharedHub : public myo::DeviceListener {
+  public:
+    /// Scoped lock of the hub mutex for control operations, interrupting the
+    /// event loop while waiting for the mutex. Can be taken from a listener
+    /// callback (the mutex is recursive).
+    class Lock {
+      public:
+        explicit Lock(SharedHub &hub) : hub_(hub) {
+            hub_.waiting_++;
+            hub_.mutex_.lock();
+            hub_.waiting_--;
+        }
+
+        ~Lock() { hub_.mutex_.unlock(); }
+
+      private:
+        Lock(Lock const &);
+        Lock &operator=(Lock const &);
+
+        SharedHub &hub_;
+    };
+
+    /// Returns the process-wide hub, creating it on first use. Throws the
+    /// exceptions of myo::Hub's constructor if the hub cannot be initialized.
+    static SharedHub *acquire() {
+        std::lock_guard<std::mutex> lock(instanceMutex());
+        if (!instance()) instance() = new SharedHub();
+        instance()->references_++;
+        return instance();
+    }
+
+    /// Releases a reference to the hub, destroyed with the last reference.
+    static void release(SharedHub *hub) {
+        std::lock_guard<std::mutex> lock(instanceMutex());
+        if (!hub || hub != instance()) return;
+        if (--hub->references_ > 0) return;
+        hub->stop();
+        hub->hub_.setLockingPolicy(myo::Hub::lockingPolicyStandard);
+        delete hub;
+        instance() = NULL;
+    }
+
+    /// Registers a listener and starts the event thread if needed. The
+    /// listener immediately receives onConnect() for every connected device.
+    void subscribe(myo::DeviceListener *listener) {
+        std::lock_guard<std::mutex> control(control_mutex_);
+        {
+            Lock lock(*this);
+            if (std::find(subscribers_.begin(), subscribers_.end(),
+                          listener) != subscribers_.end())
+                return;
+            subscribers_.push_back(listener);
+            for (Connections::iterator it = connections_.begin();
+                 it != connections_.end(); ++it) {
+                listener->onConnect(it->first, it->second.timestamp,
+                                    it->second.firmwareVersion);
+            }
+        }
+        if (!running_) start();
+    }
+
+    /// Unregisters a listener and stops the event thread with the last one.
+    void unsubscribe(myo::DeviceListener *listener) {
+        std::lock_guard<std::mutex> control(control_mutex_);
+        bool empty;
+        {
+            Lock lock(*this);
+            route(listener, std::vector<myo::Myo *>());
+            masks_.erase(listener);
+            subscribers_.erase(std::remove(subscribers_.begin(),
+                                           subscribers_.end(), listener),
+                               subscribers_.end());
+            empty = subscribers_.empty();
+        }
+        if (empty) stop();
+    }
+
+    /// Forwards the data events of the given devices to the listener
+    /// (replacing its previous routes). Requires a Lock.
+    void route(myo::DeviceListener *listener,
+               std::vector<myo::Myo *> const &devices) {
+        for (Routes::iterator it = routes_.begin(); it != routes_.end();
+             ++it) {
+            it->second.erase(
+                std::remove_if(it->second.begin(), it->second.end(),
+                               RouteTo(listener)),
+                it->second.end());
+        }
+        Masks::const_iterator mask = masks_.find(listener);
+        Route route = {listener, mask != masks_.end()
+                                     ? mask->second
+                                     : (unsigned int)myo::Hub::eventMaskAll};
+        for (std::size_t i = 0; i < devices.size(); i++)
+            routes_[devices[i]].push_back(route);
+        updateStreams();
+    }
+
+    /// Sets the data streams (combination of myo::Hub::EventMask values)
+    /// forwarded to the listener. Requires a Lock.
+    void setEventMask(myo::DeviceListener *listener, unsigned int mask) {
+        masks_[listener] = mask;
+        for (Routes::iterator it = routes_.begin(); it != routes_.end();
+             ++it) {
+            for (std::size_t i = 0; i < it->second.size(); i++) {
+                if (it->second[i].listener == listener)
+                    it->second[i].mask = mask;
+            }
+        }
+        updateStreams();
+    }
+
+    /// Sets the locking policy of all connected devices
+    void setLockingPolicy(myo::Hub::LockingPolicy policy) {
+        Lock lock(*this);
+        hub_.setLockingPolicy(policy);
+    }
+
+    /// Sets the duration of the slices of the event loop (ms). This only
+    /// bounds the latency of control operations while no event is received.
+    /// libmyo runs for whole milliseconds: 1 ms is the shortest slice.
+    void setSlice(unsigned int slice_ms) { slice_ms_ = slice_ms ? slice_ms : 1; }
+
+    /// Duration of the slices of the event loop (ms)
+    unsigned int slice() const { return slice_ms_; }
+
+    /// Number of slices of the event loop run since the hub was created
+    uint64_t slices() const { return slices_.get(); }
+
+    /// Number of slices that lasted more than 1 ms longer than slice(), i.e.
+    /// during which callbacks blocked the event loop
+    uint64_t overruns() const { return overruns_.get(); }
+
+    /// Message of the last exception caught in the event thread (if any)
+    std::string error() {
+        Lock lock(*this);
+        return error_;
+    }
+
+    void onPair(myo::Myo *myo, uint64_t timestamp,
+                myo::FirmwareVersion firmwareVersion) {
+        for (std::size_t i = 0; i < subscribers_.size(); i++)
+            subscribers_[i]->onPair(myo, timestamp, firmwareVersion);
+    }
+
+    void onUnpair(myo::Myo *myo, uint64_t timestamp) {
+        for (std::size_t i = 0; i < subscribers_.size(); i++)
+            subscribers_[i]->onUnpair(myo, timestamp);
+    }
+
+    void onConnect(myo::Myo *myo, uint64_t timestamp,
+                   myo::FirmwareVersion firmwareVersion) {
+        Connection connection = {timestamp, firmwareVersion, -1};
+        connections_[myo] = connection;
+        for (std::size_t i = 0; i < subscribers_.size(); i++)
+            subscribers_[i]->onConnect(myo, timestamp, firmwareVersion);
+        updateStreams();
+    }
+
+    void onDisconnect(myo::Myo *myo, uint64_t timestamp) {
+        connections_.erase(myo);
+        for (std::size_t i = 0; i < subscribers_.size(); i++)
+            subscribers_[i]->onDisconnect(myo, timestamp);
+    }
+
+    void onArmSync(myo::Myo *myo, uint64_t timestamp, myo::Arm arm,
+                   myo::XDirection xDirection, float rotation,
+                   myo::WarmupState warmupState) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++)
+            it->second[i].listener->onArmSync(myo, timestamp, arm, xDirection, rotation,
+                                     warmupState);
+    }
+
+    void onArmUnsync(myo::Myo *myo, uint64_t timestamp) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++)
+            it->second[i].listener->onArmUnsync(myo, timestamp);
+    }
+
+    void onPose(myo::Myo *myo, uint64_t timestamp, myo::Pose pose) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++) {
+            if (it->second[i].mask & myo::Hub::eventMaskPose)
+                it->second[i].listener->onPose(myo, timestamp, pose);
+        }
+    }
+
+    void onOrientationData(myo::Myo *myo, uint64_t timestamp,
+                           const myo::Quaternion<float> &rotation) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++) {
+            if (it->second[i].mask & myo::Hub::eventMaskOrientation)
+                it->second[i].listener->onOrientationData(myo, timestamp, rotation);
+        }
+    }
+
+    void onAccelerometerData(myo::Myo *myo, uint64_t timestamp,
+                             const myo::Vector3<float> &accel) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++) {
+            if (it->second[i].mask & myo::Hub::eventMaskAccelerometer)
+                it->second[i].listener->onAccelerometerData(myo, timestamp, accel);
+        }
+    }
+
+    void onGyroscopeData(myo::Myo *myo, uint64_t timestamp,
+                         const myo::Vector3<float> &gyro) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++) {
+            if (it->second[i].mask & myo::Hub::eventMaskGyroscope)
+                it->second[i].listener->onGyroscopeData(myo, timestamp, gyro);
+        }
+    }
+
+    void onRssi(myo::Myo *myo, uint64_t timestamp, int8_t rssi) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++)
+            it->second[i].listener->onRssi(myo, timestamp, rssi);
+    }
+
+    void onBatteryLevelReceived(myo::Myo *myo, uint64_t timestamp,
+                                uint8_t level) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++)
+            it->second[i].listener->onBatteryLevelReceived(myo, timestamp, level);
+    }
+
+    void onEmgData(myo::Myo *myo, uint64_t timestamp, const int8_t *emg) {
+        Routes::iterator it = routes_.find(myo);
+        if (it == routes_.end()) return;
+        for (std::size_t i = 0; i < it->second.size(); i++) {
+            if (it->second[i].mask & myo::Hub::eventMaskEmg)
+                it->second[i].listener->onEmgData(myo, timestamp, emg);
+        }
+    }
+
+  private:
+    struct Connection {
+        uint64_t timestamp;
+        myo::FirmwareVersion firmwareVersion;
+        int streamEmg;  // EMG streaming state set on the device (-1: unknown)
+    };
+
+    struct Route {
+        myo::DeviceListener *listener;
+        unsigned int mask;
+    };
+
+    struct RouteTo {
+        explicit RouteTo(myo::DeviceListener *l) : listener(l) {}
+        bool operator()(Route const &route) const {
+            return route.listener == listener;
+        }
+        myo::DeviceListener *listener;
+    };
+
+    typedef std::map<myo::Myo *, Connection> Connections;
+    typedef std::map<myo::Myo *, std::vector<Route> > Routes;
+    typedef std::map<myo::DeviceListener *, unsigned int> Masks;
+
+    SharedHub()
+        : hub_("com.julesfrancoise.maxmyo"),
+          references_(0),
+          slice_ms_(1),
+          waiting_(0),
+          running_(false),
+          cancel_(false) {
+        hub_.addListener(this);
+    }
+
+    ~SharedHub() { hub_.removeListener(this); }
+
+    SharedHub(SharedHub const &);
+    SharedHub &operator=(SharedHub const &);
+
+    static SharedHub *&instance() {
+        static SharedHub *hub = NULL;
+        return hub;
+    }
+
+    static std::mutex &instanceMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    void start() {
+        if (thread_.joinable()) thread_.join();
+        cancel_ = false;
+        running_ = true;
+        thread_ = std::thread(&SharedHub::run, this);
+    }
+
+    void stop() {
+        cancel_ = true;
+        waiting_++;  // interrupts the current slice
+        if (thread_.joinable()) thread_.join();
+        waiting_--;
+        running_ = false;
+    }
+
+    /// Only decodes the streams consumed by a routed listener, and enables EMG
+    /// streaming on the connected devices that have an EMG consumer
+    void updateStreams() {
+        unsigned int mask = 0;
+        for (Routes::iterator it = routes_.begin(); it != routes_.end();
+             ++it) {
+            for (std::size_t i = 0; i < it->second.size(); i++)
+                mask |= it->second[i].mask;
+        }
+        hub_.setEventMask(mask);
+        for (Connections::iterator it = connections_.begin();
+             it != connections_.end(); ++it) {
+            int streamEmg = 0;
+            Routes::iterator route = routes_.find(it->first);
+            if (route != routes_.end()) {
+                for (std::size_t i = 0; i < route->second.size(); i++) {
+                    if (route->second[i].mask & myo::Hub::eventMaskEmg)
+                        streamEmg = 1;
+                }
+            }
+            if (streamEmg == it->second.streamEmg) continue;
+            it->second.streamEmg = streamEmg;
+            it->first->setStreamEmg(streamEmg ? myo::Myo::streamEmgEnabled
+                                              : myo::Myo::streamEmgDisabled);
+        }
+    }
+
+    /// Event thread: runs the Myo event loop until stopped
+    void run() {
+        while (!cancel_) {
+            // let waiting control operations take the mutex first
+            while (waiting_ > 0 && !cancel_) std::this_thread::yield();
+            std::lock_guard<std::recursive_mutex> lock(mutex_);
+            try {
+                // In each iteration of our main loop, we run the Myo event
+                // loop for a slice of time, or until a control operation
+                // waits for the mutex.
+                unsigned int slice_ms = slice_ms_;
+                std::chrono::steady_clock::time_point start =
+                    std::chrono::steady_clock::now();
+                hub_.run(slice_ms, waiting_);
+                slices_.add();
+                if (std::chrono::steady_clock::now() - start >
+                    std::chrono::milliseconds(slice_ms + 1))
+                    overruns_.add();
+            } catch (const std::exception &e) {
+                error_ = e.what();
+                break;
+            }
+        }
+        running_ = false;
+    }
+
+    myo::Hub hub_;
+    int references_;
+    std::atomic<unsigned int> slice_ms_;
+    std::atomic<int> waiting_;  // number of Locks waiting for the mutex
+    Counter slices_;
+    Counter overruns_;
+
+    std::thread thread_;
+    std::recursive_mutex mutex_;  // held by the event thread within hub_.run
+    std::mutex control_mutex_;    // serializes subscribe/unsubscribe
+    std::atomic<bool> running_;
+    std::atomic<bool> cancel_;
+    std::string error_;
+
+    std::vector<myo::DeviceListener *> subscribers_;
+    Routes routes_;
+    Masks masks_;
+    Connections connections_;
+};
+
+#endif
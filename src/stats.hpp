@@ -0,0 +1,173 @@
+/**
+ *
+ * @file stats.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Runtime statistics of the hub thread, cheap enough to stay enabled
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_STATS_HPP
+#define MAXMYO_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Counter updated by one thread and read (or reset) by another. Updates are
+ * relaxed atomic operations: no ordering with the data they count.
+ */
+class Counter {
+  public:
+    Counter() : value_(0) {}
+
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+    /// Keeps the maximum of the values (single updating thread)
+    void max(uint64_t value) {
+        if (value > value_.load(std::memory_order_relaxed))
+            value_.store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const { return value_.load(std::memory_order_relaxed); }
+
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+
+  private:
+    Counter(Counter const &);
+    Counter &operator=(Counter const &);
+
+    std::atomic<uint64_t> value_;
+};
+
+/**
+ * Measures the duration of a scope (e.g. a hub callback): accumulates the
+ * total, the maximum and the number of measures.
+ */
+class ScopeTimer {
+  public:
+    ScopeTimer(Counter &count, Counter &total_ns, Counter &max_ns)
+        : count_(count),
+          total_ns_(total_ns),
+          max_ns_(max_ns),
+          start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopeTimer() {
+        uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_)
+                .count());
+        count_.add();
+        total_ns_.add(ns);
+        max_ns_.max(ns);
+    }
+
+  private:
+    ScopeTimer(ScopeTimer const &);
+    ScopeTimer &operator=(ScopeTimer const &);
+
+    Counter &count_;
+    Counter &total_ns_;
+    Counter &max_ns_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Infers the samples of a periodic stream lost on the link from their
+ * hardware timestamps. Samples sharing a timestamp (e.g. EMG samples sent in
+ * pairs) count as received at that time, so the expected number of samples
+ * between two timestamps is their difference divided by the sample period.
+ */
+class LinkMonitor {
+  public:
+    explicit LinkMonitor(uint64_t period_us = 5000)
+        : period_(period_us), last_(0), received_(0) {}
+
+    /// Registers a sample, returns the number of samples missing before it
+    uint64_t received(uint64_t timestamp) {
+        if (timestamp == last_) {
+            received_++;
+            return 0;
+        }
+        uint64_t lost = 0;
+        if (last_ && timestamp > last_) {
+            uint64_t expected = (timestamp - last_ + period_ / 2) / period_;
+            if (expected > received_) lost = expected - received_;
+        }
+        last_ = timestamp;
+        received_ = 1;
+        return lost;
+    }
+
+    /// Forgets the last sample (e.g. on reconnection)
+    void reset() {
+        last_ = 0;
+        received_ = 0;
+    }
+
+  private:
+    uint64_t period_;
+    uint64_t last_;
+    uint64_t received_;  // samples received at the last timestamp
+};
+
+/// Statistics of a device listener, updated by the hub thread
+struct ListenerStats {
+    enum Stream { Emg, Accel, Gyro, Quat, Pose, Info, NumStreams };
+
+    /// Buffers between the hub thread and Max
+    enum Queue {
+        EmgQueue,
+        AccelQueue,
+        GyroQueue,
+        QuatQueue,
+        InfoQueue,
+        FusedQueue,
+        FeaturesQueue,
+        EnvelopeQueue,
+        GmmQueue,
+        HmmQueue,
+        GmrQueue,
+        NumQueues
+    };
+
+    /// Events received per type
+    Counter events[NumStreams];
+
+    /// EMG samples and IMU frames lost on the link (from the timestamps)
+    Counter emg_lost;
+    Counter imu_lost;
+
+    /// Duration of the callbacks (ns)
+    Counter callbacks;
+    Counter callback_total_ns;
+    Counter callback_max_ns;
+
+    /// Maximum number of frames or events waiting in each buffer
+    Counter queue_max[NumQueues];
+
+    /// Frames or events dropped because their buffer was full
+    Counter dropped[NumQueues];
+
+    void reset() {
+        for (int i = 0; i < NumStreams; i++) events[i].reset();
+        emg_lost.reset();
+        imu_lost.reset();
+        callbacks.reset();
+        callback_total_ns.reset();
+        callback_max_ns.reset();
+        for (int i = 0; i < NumQueues; i++) {
+            queue_max[i].reset();
+            dropped[i].reset();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ *
+ * @file timeline.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Placement of timestamped sensor frames on the audio timeline
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_TIMELINE_HPP
+#define MAXMYO_TIMELINE_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Offset between the hardware clock of a device and the audio clock (both in
+ * microseconds). Frames are handed to the audio thread at the start of a
+ * signal vector: the arrival time of a frame minus its timestamp is the
+ * offset plus the latency of the transport, which varies from frame to
+ * frame. The offset follows the earliest arrivals (the minimum latency), and
+ * slowly rises to follow the drift between the two clocks. Frames are
+ * played at their timestamp plus the offset plus a fixed delay, which must
+ * cover the jitter of the transport and of the signal vectors.
+ */
+class SignalClock {
+  public:
+    explicit SignalClock(double drift_rate = 1e-4)
+        : drift_rate_(drift_rate) {
+        reset();
+    }
+
+    /// Forgets the offset: the next frame starts a new timeline
+    void reset() {
+        started_ = false;
+        base_ = 0;
+        offset_ = 0.;
+    }
+
+    /// Updates the offset with a frame received at the given audio time,
+    /// and returns the time of the frame on the audio clock (without delay)
+    double place(uint64_t timestamp, double arrival) {
+        if (!started_) {
+            base_ = timestamp;
+            offset_ = arrival;
+            started_ = true;
+        }
+        // timestamps relative to the first frame keep the precision of doubles
+        double time =
+            static_cast<double>(static_cast<int64_t>(timestamp - base_));
+        double latency = arrival - time;
+        if (latency < offset_)
+            offset_ = latency;
+        else
+            offset_ += drift_rate_ * (latency - offset_);
+        return time + offset_;
+    }
+
+  private:
+    double drift_rate_;
+    bool started_;
+    uint64_t base_;  // timestamp of the first frame
+    double offset_;
+};
+
+/**
+ * Frames of a stream waiting to be played on the audio timeline, rendered as
+ * a signal per channel, held or linearly interpolated between consecutive
+ * frames. The queue is allocated by configure(): push() and render() are
+ * called on the audio thread and do not allocate.
+ */
+class SignalStream {
+  public:
+    static const int kMaxChannels = 8;
+
+    SignalStream() : channels_(0), size_(0), head_(0), started_(false) {}
+
+    /// Sets the number of channels and the capacity of the queue (frames),
+    /// and resets
+    void configure(int channels, int capacity) {
+        channels_ = channels < kMaxChannels ? channels : kMaxChannels;
+        times_.assign(capacity > 0 ? capacity : 1, 0.);
+        values_.assign(times_.size() * kMaxChannels, 0.f);
+        reset();
+    }
+
+    /// Clears the queue and outputs zeros until the next frame
+    void reset() {
+        size_ = 0;
+        head_ = 0;
+        started_ = false;
+        current_time_ = 0.;
+        for (int c = 0; c < kMaxChannels; c++) current_[c] = 0.f;
+    }
+
+    int channels() const { return channels_; }
+
+    /// Queues a frame to play at the given time (frames in order of time).
+    /// Returns false if the queue is full.
+    bool push(double time, float const *values) {
+        if (size_ == static_cast<int>(times_.size())) return false;
+        int slot = (head_ + size_) % static_cast<int>(times_.size());
+        times_[slot] = time;
+        for (int c = 0; c < channels_; c++)
+            values_[slot * kMaxChannels + c] = values[c];
+        size_++;
+        return true;
+    }
+
+    /// Writes a signal vector per channel, for the samples of the given
+    /// period starting at the given time (all in microseconds)
+    void render(double start, double period, long frames, bool linear,
+                double **outs) {
+        long n = 0;
+        while (n < frames) {
+            double t = start + n * period;
+            while (size_ > 0 && times_[head_] <= t) pop();
+            // samples until the next frame plays (or the end of the vector)
+            long end = frames;
+            if (size_ > 0) {
+                double next = (times_[head_] - start) / period;
+                if (next < end) end = static_cast<long>(next) + 1;
+            }
+            if (linear && started_ && size_ > 0) {
+                float const *target = &values_[head_ * kMaxChannels];
+                double duration = times_[head_] - current_time_;
+                for (int c = 0; c < channels_; c++) {
+                    double slope = (target[c] - current_[c]) / duration;
+                    double *out = outs[c];
+                    for (long i = n; i < end; i++)
+                        out[i] = current_[c] +
+                                 slope * (start + i * period - current_time_);
+                }
+            } else {
+                for (int c = 0; c < channels_; c++) {
+                    double *out = outs[c];
+                    double value = current_[c];
+                    for (long i = n; i < end; i++) out[i] = value;
+                }
+            }
+            n = end;
+        }
+    }
+
+  private:
+    /// Makes the next queued frame the current one
+    void pop() {
+        current_time_ = times_[head_];
+        for (int c = 0; c < channels_; c++)
+            current_[c] = values_[head_ * kMaxChannels + c];
+        head_ = (head_ + 1) % static_cast<int>(times_.size());
+        size_--;
+        started_ = true;
+    }
+
+    int channels_;
+    std::vector<double> times_;   // play times of the queued frames
+    std::vector<float> values_;   // kMaxChannels values per queued frame
+    int size_;                    // queued frames
+    int head_;                    // slot of the next frame
+    bool started_;                // a frame has been played
+    double current_time_;         // play time of the current frame
+    float current_[kMaxChannels];
+};
+
+#endif
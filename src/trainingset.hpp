@@ -0,0 +1,64 @@
+/**
+ *
+ * @file trainingset.hpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Labeled frames recorded to train the classifiers
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef MAXMYO_TRAININGSET_HPP
+#define MAXMYO_TRAININGSET_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * Training frames of a set of classes, recorded from a stream: the frames of
+ * each class are concatenated (dimension values per frame).
+ */
+struct TrainingSet {
+    TrainingSet() : dimension(0) {}
+
+    /// Index of a class (-1 if unknown)
+    int index(std::string const &label) const {
+        for (std::size_t c = 0; c < labels.size(); c++)
+            if (labels[c] == label) return static_cast<int>(c);
+        return -1;
+    }
+
+    /// Index of a class, added if needed
+    int add(std::string const &label) {
+        int c = index(label);
+        if (c >= 0) return c;
+        labels.push_back(label);
+        data.push_back(std::vector<float>());
+        return static_cast<int>(labels.size()) - 1;
+    }
+
+    /// Total number of frames
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (std::size_t c = 0; c < data.size() && dimension; c++)
+            n += data[c].size() / dimension;
+        return n;
+    }
+
+    void clear() {
+        dimension = 0;
+        labels.clear();
+        data.clear();
+    }
+
+    int dimension;
+    std::vector<std::string> labels;
+    std::vector<std::vector<float> > data;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ *
+ * @file myosession.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Prints the content of a Myo session file recorded by [myo]
+ *
+ * Standalone tool (no dependency on Max or the Myo SDK):
+ *   c++ -std=c++11 -I../src myosession.cpp -o myosession -lpthread
+ *
+ * Usage: myosession <file>
+ * Prints one record per line: time (ms since the first record), device
+ * index, record type and values.
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "session.hpp"
+#include <cstdio>
+
+static char const *typeName(SessionRecord::Type type) {
+    switch (type) {
+        case SessionRecord::Emg:
+            return "emg";
+        case SessionRecord::Accel:
+            return "accel";
+        case SessionRecord::Gyro:
+            return "gyro";
+        case SessionRecord::Quat:
+            return "quat";
+        case SessionRecord::Pose:
+            return "pose";
+        case SessionRecord::ArmSync:
+            return "armsync";
+        case SessionRecord::ArmUnsync:
+            return "armunsync";
+        case SessionRecord::Rssi:
+            return "rssi";
+        case SessionRecord::Battery:
+            return "battery";
+        case SessionRecord::Connect:
+            return "connect";
+        case SessionRecord::Disconnect:
+            return "disconnect";
+    }
+    return "unknown";
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <file>\n", argv[0]);
+        return 2;
+    }
+    SessionReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s: not a Myo session file\n", argv[1]);
+        return 1;
+    }
+    std::printf("# start %llu\n",
+                static_cast<unsigned long long>(reader.startTime()));
+
+    SessionRecord record;
+    bool first = true;
+    uint64_t origin = 0;
+    unsigned long count = 0;
+    while (reader.read(record)) {
+        if (first) origin = record.timestamp;
+        first = false;
+        double time =
+            static_cast<double>(static_cast<int64_t>(record.timestamp - origin)) /
+            1000.;
+        std::printf("%.3f %d %s", time, record.device, typeName(record.type));
+        switch (record.type) {
+            case SessionRecord::Emg:
+                for (int i = 0; i < 8; i++) std::printf(" %d", record.emg[i]);
+                break;
+
+            case SessionRecord::Accel:
+            case SessionRecord::Gyro:
+                for (int i = 0; i < 3; i++) std::printf(" %g", record.values[i]);
+                break;
+
+            case SessionRecord::Quat:
+                for (int i = 0; i < 4; i++) std::printf(" %g", record.values[i]);
+                break;
+
+            case SessionRecord::ArmSync:
+                std::printf(" %d %d %d %g", record.info[0], record.info[1],
+                            record.info[2], record.values[0]);
+                break;
+
+            case SessionRecord::Pose:
+            case SessionRecord::Rssi:
+            case SessionRecord::Battery:
+                std::printf(" %d", record.info[0]);
+                break;
+
+            case SessionRecord::Connect:
+                std::printf(" %s", record.name.c_str());
+                break;
+
+            case SessionRecord::ArmUnsync:
+            case SessionRecord::Disconnect:
+                break;
+        }
+        std::printf("\n");
+        count++;
+    }
+    std::fprintf(stderr, "%lu records\n", count);
+    return 0;
+}
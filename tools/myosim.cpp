@@ -0,0 +1,188 @@
+/**
+ *
+ * @file myosim.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Runs the shared hub and device listeners against the simulated libmyo
+ *
+ * Standalone tool (no dependency on Max or the Myo SDK library):
+ *   c++ -std=c++11 -I../src -I../lib/win/include -I../lib/sim \
+ *       myosim.cpp ../lib/sim/libmyo_sim.cpp -o myosim -lpthread
+ *
+ * Usage: myosim [seconds] [listeners]
+ * The traffic is configured with the MYO_SIM_* environment variables (see
+ * lib/sim/libmyo_sim.h). Prints, every second, the events received by the
+ * first listener for each device, and the EMG samples missing from the
+ * timestamps (lost on the simulated link or by the hub).
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "sharedhub.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static const int kMaxDevices = 16;
+
+/// Counts the events of every connected device
+class CountingListener : public myo::DeviceListener {
+  public:
+    struct Counters {
+        std::atomic<uint64_t> emg;
+        std::atomic<uint64_t> emg_missing;
+        std::atomic<uint64_t> imu;
+        std::atomic<uint64_t> poses;
+        std::atomic<uint64_t> connections;
+        std::atomic<uint64_t> disconnections;
+        uint64_t last_emg;  // hub thread only
+    };
+
+    explicit CountingListener(SharedHub *hub) : hub_(hub) {
+        for (int i = 0; i < kMaxDevices; i++) {
+            counters[i].emg = 0;
+            counters[i].emg_missing = 0;
+            counters[i].imu = 0;
+            counters[i].poses = 0;
+            counters[i].connections = 0;
+            counters[i].disconnections = 0;
+            counters[i].last_emg = 0;
+        }
+    }
+
+    void onConnect(myo::Myo *myo, uint64_t timestamp,
+                   myo::FirmwareVersion firmwareVersion) {
+        int index = indexOf(myo);
+        if (index < 0) return;
+        connected_[index] = true;
+        counters[index].connections++;
+        counters[index].last_emg = 0;
+        updateRoutes();
+    }
+
+    void onDisconnect(myo::Myo *myo, uint64_t timestamp) {
+        int index = indexOf(myo);
+        if (index < 0) return;
+        connected_[index] = false;
+        counters[index].disconnections++;
+        updateRoutes();
+    }
+
+    void onOrientationData(myo::Myo *myo, uint64_t timestamp,
+                           const myo::Quaternion<float> &rotation) {
+        int index = indexOf(myo);
+        if (index >= 0) counters[index].imu++;
+    }
+
+    void onPose(myo::Myo *myo, uint64_t timestamp, myo::Pose pose) {
+        int index = indexOf(myo);
+        if (index >= 0) counters[index].poses++;
+    }
+
+    void onEmgData(myo::Myo *myo, uint64_t timestamp, const int8_t *emg) {
+        int index = indexOf(myo);
+        if (index < 0) return;
+        Counters &c = counters[index];
+        c.emg++;
+        // samples come in pairs every 10 ms
+        if (c.last_emg && timestamp > c.last_emg + 10000)
+            c.emg_missing += 2 * ((timestamp - c.last_emg) / 10000 - 1);
+        c.last_emg = timestamp;
+    }
+
+    int devices() const { return static_cast<int>(devices_.size()); }
+
+    Counters counters[kMaxDevices];
+
+  private:
+    int indexOf(myo::Myo *myo) {
+        for (std::size_t i = 0; i < devices_.size(); i++) {
+            if (devices_[i] == myo) return static_cast<int>(i);
+        }
+        if (devices_.size() == kMaxDevices) return -1;
+        devices_.push_back(myo);
+        connected_.push_back(false);
+        return static_cast<int>(devices_.size()) - 1;
+    }
+
+    // called by the hub thread, which holds the hub lock
+    void updateRoutes() {
+        std::vector<myo::Myo *> routed;
+        for (std::size_t i = 0; i < devices_.size(); i++) {
+            if (connected_[i]) routed.push_back(devices_[i]);
+        }
+        hub_->route(this, routed);
+    }
+
+    SharedHub *hub_;
+    std::vector<myo::Myo *> devices_;
+    std::vector<bool> connected_;
+};
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    int count = argc > 2 ? std::atoi(argv[2]) : 1;
+    if (seconds < 1 || count < 1) {
+        std::fprintf(stderr, "usage: %s [seconds] [listeners]\n", argv[0]);
+        return 2;
+    }
+
+    SharedHub *hub = SharedHub::acquire();
+    std::vector<CountingListener *> listeners;
+    for (int i = 0; i < count; i++) {
+        CountingListener *listener = new CountingListener(hub);
+        {
+            SharedHub::Lock lock(*hub);
+            hub->setEventMask(listener, myo::Hub::eventMaskAll);
+        }
+        hub->subscribe(listener);
+        listeners.push_back(listener);
+    }
+
+    CountingListener &first = *listeners[0];
+    uint64_t previous[kMaxDevices][2] = {{0}};
+    for (int s = 1; s <= seconds; s++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::printf("%3d s", s);
+        for (int d = 0; d < first.devices(); d++) {
+            CountingListener::Counters &c = first.counters[d];
+            uint64_t emg = c.emg, imu = c.imu;
+            std::printf(" | %d: emg %llu imu %llu", d,
+                        static_cast<unsigned long long>(emg - previous[d][0]),
+                        static_cast<unsigned long long>(imu - previous[d][1]));
+            previous[d][0] = emg;
+            previous[d][1] = imu;
+        }
+        std::printf("\n");
+    }
+
+    for (int i = 0; i < count; i++) hub->unsubscribe(listeners[i]);
+    std::string error = hub->error();
+    SharedHub::release(hub);
+
+    std::printf("# device emg missing imu poses connections disconnections\n");
+    for (int d = 0; d < first.devices(); d++) {
+        CountingListener::Counters &c = first.counters[d];
+        std::printf("%d %llu %llu %llu %llu %llu %llu\n", d,
+                    static_cast<unsigned long long>(c.emg),
+                    static_cast<unsigned long long>(c.emg_missing),
+                    static_cast<unsigned long long>(c.imu),
+                    static_cast<unsigned long long>(c.poses),
+                    static_cast<unsigned long long>(c.connections),
+                    static_cast<unsigned long long>(c.disconnections));
+    }
+    for (int i = 0; i < count; i++) delete listeners[i];
+    if (!error.empty()) {
+        std::fprintf(stderr, "hub error: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,272 @@
+/**
+ *
+ * @file sessiontest.cpp
+ * @author Jules Françoise <jfrancoi@sfu.ca>
+ *
+ * @brief Round-trip test of the session file format
+ *
+ * Standalone tool (no dependency on Max or the Myo SDK):
+ *   c++ -std=c++11 -I../src sessiontest.cpp -o sessiontest -lpthread
+ *
+ * Usage: sessiontest [file]
+ * Writes every record type for two devices with SessionWriter, in small
+ * chunks so that the recording spans many chunk rollovers, reads the file
+ * back with SessionReader and compares each record with what was written.
+ * Exits with 1 on the first mismatch, 0 if the file matches (the file is then
+ * removed).
+ *
+ * Copyright (C) 2015 by Jules Françoise.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "session.hpp"
+#include <cstdio>
+
+static const std::size_t kChunkSize = 1024;
+static const std::size_t kNumChunks = 64;
+static const int kSteps = 600;  // EMG periods (5 ms) per device
+static const int kDevices = 2;
+
+/// Records written, as SessionReader should decode them
+static std::vector<SessionRecord> expected;
+
+static SessionRecord header(SessionRecord::Type type, uint8_t device,
+                            uint64_t timestamp) {
+    SessionRecord record = SessionRecord();
+    record.type = type;
+    record.device = device;
+    record.timestamp = timestamp;
+    return record;
+}
+
+static void writeEmg(SessionWriter &writer, EmgFrame const &frame) {
+    writer.write(frame);
+    SessionRecord record =
+        header(SessionRecord::Emg, frame.device, frame.timestamp);
+    for (int i = 0; i < 8; i++) record.emg[i] = frame.values[i];
+    expected.push_back(record);
+}
+
+static void writeVector(SessionWriter &writer, SessionRecord::Type type,
+                        Vector3Frame const &frame) {
+    if (type == SessionRecord::Accel)
+        writer.writeAccel(frame);
+    else
+        writer.writeGyro(frame);
+    SessionRecord record = header(type, frame.device, frame.timestamp);
+    for (int i = 0; i < 3; i++) record.values[i] = frame.values[i];
+    expected.push_back(record);
+}
+
+static void writeQuat(SessionWriter &writer, QuaternionFrame const &frame) {
+    writer.write(frame);
+    SessionRecord record =
+        header(SessionRecord::Quat, frame.device, frame.timestamp);
+    for (int i = 0; i < 4; i++) record.values[i] = frame.values[i];
+    expected.push_back(record);
+}
+
+static void writeEvent(SessionWriter &writer, InfoEvent const &event,
+                       std::string const &name) {
+    writer.write(event, name);
+    SessionRecord record = header(SessionRecord::Connect, event.device,
+                                  event.timestamp);
+    switch (event.type) {
+        case InfoEvent::Connect:
+            record.name = name;
+            break;
+
+        case InfoEvent::Disconnect:
+            record.type = SessionRecord::Disconnect;
+            break;
+
+        case InfoEvent::ArmSync:
+            record.type = SessionRecord::ArmSync;
+            for (int i = 0; i < 3; i++) record.info[i] = event.values[i];
+            record.values[0] = event.rotation;
+            break;
+
+        case InfoEvent::ArmUnsync:
+            record.type = SessionRecord::ArmUnsync;
+            break;
+
+        case InfoEvent::Rssi:
+            record.type = SessionRecord::Rssi;
+            record.info[0] = event.values[0];
+            break;
+
+        case InfoEvent::Battery:
+            record.type = SessionRecord::Battery;
+            record.info[0] = event.values[0];
+            break;
+
+        case InfoEvent::Pose:
+            record.type = SessionRecord::Pose;
+            record.info[0] = event.values[0];
+            break;
+    }
+    expected.push_back(record);
+}
+
+/// Compares the fields of a record that its type defines
+static bool same(SessionRecord const &a, SessionRecord const &b) {
+    if (a.type != b.type || a.device != b.device || a.timestamp != b.timestamp)
+        return false;
+    switch (a.type) {
+        case SessionRecord::Emg:
+            for (int i = 0; i < 8; i++) {
+                if (a.emg[i] != b.emg[i]) return false;
+            }
+            return true;
+
+        case SessionRecord::Accel:
+        case SessionRecord::Gyro:
+            for (int i = 0; i < 3; i++) {
+                if (a.values[i] != b.values[i]) return false;
+            }
+            return true;
+
+        case SessionRecord::Quat:
+            for (int i = 0; i < 4; i++) {
+                if (a.values[i] != b.values[i]) return false;
+            }
+            return true;
+
+        case SessionRecord::ArmSync:
+            return a.info[0] == b.info[0] && a.info[1] == b.info[1] &&
+                   a.info[2] == b.info[2] && a.values[0] == b.values[0];
+
+        case SessionRecord::Pose:
+        case SessionRecord::Rssi:
+        case SessionRecord::Battery:
+            return a.info[0] == b.info[0];
+
+        case SessionRecord::Connect:
+            return a.name == b.name;
+
+        case SessionRecord::ArmUnsync:
+        case SessionRecord::Disconnect:
+            return true;
+    }
+    return false;
+}
+
+/// Writes the session: EMG every 5 ms, IMU every 20 ms, and every info
+/// event type in turn every 250 ms, for each device
+static void writeSession(SessionWriter &writer) {
+    uint64_t origin = 1000000;
+    for (int t = 0; t < kSteps; t++) {
+        uint64_t timestamp = origin + 5000 * static_cast<uint64_t>(t);
+        for (int d = 0; d < kDevices; d++) {
+            uint8_t device = static_cast<uint8_t>(d);
+            EmgFrame emg = {timestamp, device, {{0}}};
+            for (int i = 0; i < 8; i++)
+                emg.values[i] = static_cast<int8_t>(t * 7 + i * 31 + d - 128);
+            writeEmg(writer, emg);
+            if (t % 4 == 0) {
+                Vector3Frame vector = {timestamp, device, {{0}}};
+                for (int i = 0; i < 3; i++)
+                    vector.values[i] = 0.001f * t - 0.5f * i + d;
+                writeVector(writer, SessionRecord::Accel, vector);
+                for (int i = 0; i < 3; i++) vector.values[i] *= -250.f;
+                writeVector(writer, SessionRecord::Gyro, vector);
+                QuaternionFrame quat = {timestamp, device, {{0}}};
+                for (int i = 0; i < 4; i++)
+                    quat.values[i] = 0.25f * i - 0.0007f * t * (d + 1);
+                writeQuat(writer, quat);
+            }
+            if (t % 50 == 0) {
+                InfoEvent event = InfoEvent();
+                event.type = static_cast<InfoEvent::Type>((t / 50 + d) % 7);
+                event.timestamp = timestamp;
+                event.device = device;
+                event.values[0] = event.type == InfoEvent::Rssi
+                                      ? -40 - t / 50
+                                      : (t / 50 + d) % 6;
+                event.values[1] = (t / 50) % 3;
+                event.values[2] = d;
+                event.rotation = 0.01f * t - 1.f;
+                writeEvent(writer, event, d ? "Myo B" : "Myo A");
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        std::fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+    std::string path = argc > 1 ? argv[1] : "sessiontest.myos";
+
+    // the chunks can hold the whole session: no record is dropped, even if
+    // the writer thread does not run before close()
+    SessionWriter writer(kChunkSize, kNumChunks);
+    if (!writer.open(path)) {
+        std::fprintf(stderr, "%s: cannot create the file\n", path.c_str());
+        return 1;
+    }
+    writeSession(writer);
+    writer.close();
+    if (writer.dropped() || writer.records() != expected.size()) {
+        std::fprintf(stderr,
+                     "%lu records written and %lu dropped, %lu expected\n",
+                     writer.records(), writer.dropped(),
+                     static_cast<unsigned long>(expected.size()));
+        return 1;
+    }
+
+    SessionReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "%s: not a Myo session file\n", path.c_str());
+        return 1;
+    }
+    SessionRecord record;
+    std::size_t count = 0;
+    unsigned long types = 0;
+    while (reader.read(record)) {
+        if (count >= expected.size()) {
+            std::fprintf(stderr, "unexpected record %lu\n",
+                         static_cast<unsigned long>(count));
+            return 1;
+        }
+        if (!same(record, expected[count])) {
+            std::fprintf(stderr,
+                         "record %lu differs (type %d device %d "
+                         "timestamp %llu)\n",
+                         static_cast<unsigned long>(count),
+                         expected[count].type, expected[count].device,
+                         static_cast<unsigned long long>(
+                             expected[count].timestamp));
+            return 1;
+        }
+        types |= 1ul << record.type;
+        count++;
+    }
+    reader.close();
+    if (count != expected.size()) {
+        std::fprintf(stderr, "%lu records read, %lu expected\n",
+                     static_cast<unsigned long>(count),
+                     static_cast<unsigned long>(expected.size()));
+        return 1;
+    }
+    if (types != ((1ul << (SessionRecord::Disconnect + 1)) - 2)) {
+        std::fprintf(stderr, "not every record type was written\n");
+        return 1;
+    }
+
+    FILE *file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    std::remove(path.c_str());
+    std::printf("%lu records of %d devices in %ld bytes (chunks of %lu "
+                "bytes): ok\n",
+                static_cast<unsigned long>(count), kDevices, size,
+                static_cast<unsigned long>(kChunkSize));
+    return 0;
+}